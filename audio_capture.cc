@@ -1,272 +1,2837 @@
 // audio_capture.cc
+// 所有平台共用的 AudioCapture：设备 IO 由 CaptureSource 后端负责（macOS 为 coreaudio_source.cc，
+// Windows 为 wasapi_source.cc，Linux 为 pipewire_source.cc），环形缓冲区、成块、处理链、分析、
+// 格式转换、写文件和投递都在这里。压缩编码和授权查询依赖 AudioToolbox/AVFoundation，只在 macOS 上提供
 #include <napi.h>
-#include <AudioToolbox/AudioToolbox.h>
-#include <CoreAudio/CoreAudio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <cstring>
+#include <functional>
+#include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include "background_worker.h"
+#include "capture_source.h"
+#include "capture_stats.h"
+#include "delivery_queue.h"
+#if defined(__APPLE__)
+#include "encoder.h"
+#include "permission.h"
+#endif
+#include "file_writer.h"
+#include "history_buffer.h"
+#include "input_stream.h"
+#include "loudness.h"
+#include "meter.h"
+#include "processors.h"
+#include "resampler.h"
+#include "ring_buffer.h"
+#include "sample_format.h"
+#include "silence_gate.h"
+#include "scheduler.h"
+#include "shared_memory.h"
+#include "stream_aligner.h"
+#include "thread_priority.h"
+#include "timestamps.h"
 
-class AudioCapture : public Napi::ObjectWrap<AudioCapture>
+// 每个 JS 环境一份：构造函数引用和所有实例共享的投递调度器
+struct AddonData
+{
+    Napi::FunctionReference constructor;
+    std::shared_ptr<DeliveryScheduler> scheduler = std::make_shared<DeliveryScheduler>();
+};
+
+class AudioCapture : public Napi::ObjectWrap<AudioCapture>, public DeliveryScheduler::Client
 {
 private:
-    AudioDeviceID outputDevice;
-    AudioUnit audioUnit;
-    Napi::ThreadSafeFunction tsfn;
-    bool isCapturing;
+    // 采集后端，prepare() 时在工作线程上打开
+    std::unique_ptr<CaptureSource> source = CreateCaptureSource();
+    CaptureSourceOptions sourceOptions;
+    // prepare() 之后设备和投递管线已就绪，start()/stop() 只启停设备 IO
+    bool isPrepared = false;
+    std::atomic<bool> isCapturing;
+    // 串行化 start()/stop() 和释放
+    std::mutex unitMutex;
+
+    // 准备/释放在工作线程上进行，期间拒绝新的 prepare()/start()
+    bool busy = false;
+    // 准备期间调用了 dispose()：准备完成后接着释放
+    bool disposeRequested = false;
+    std::vector<Napi::Promise::Deferred> disposeWaiters;
     Napi::Env env_;
 
-    static OSStatus AudioInputCallback(void *inRefCon,
-                                       AudioUnitRenderActionFlags *ioActionFlags,
-                                       const AudioTimeStamp *inTimeStamp,
-                                       UInt32 inBusNumber,
-                                       UInt32 inNumberFrames,
-                                       AudioBufferList *ioData)
+    // 环境退出时的清理钩子与工作线程上的准备/释放互斥，钩子运行后不再开始新的工作
+    std::mutex workMutex;
+    std::condition_variable workIdle;
+    bool working = false;
+    bool shuttingDown = false;
+
+    // 同一环境中的所有实例共用一个投递线程和一个 ThreadSafeFunction
+    std::shared_ptr<DeliveryScheduler> scheduler;
+    std::shared_ptr<DeliveryScheduler::Handle> handle = std::make_shared<DeliveryScheduler::Handle>();
+    Napi::FunctionReference dataCallback;
+
+    // 环形缓冲区在准备时一次性分配，IO 回调只写环，不加锁也不分配；
+    // 数据块的分配、处理和回调 JS 都由共享的投递线程负责
+    static constexpr uint32_t kChannels = CaptureSource::kChannels;
+    static constexpr uint32_t kMaxFramesPerSlice = 4096;
+    static constexpr uint32_t kDefaultRingFrames = 1 << 15;
+    static constexpr int64_t kNsPerMs = 1000000;
+#if defined(__APPLE__)
+    // 未指定 sampleRate/channels 时保持原来的行为，由 CoreAudio 转换为 44.1kHz
+    static constexpr uint32_t kSampleRate = 44100;
+    static constexpr uint32_t kOpusSampleRate = 48000;
+#endif
+    // 池中数据块的个数：队列上限之外再留给 JS 尚未回收的块；不限队列时按固定个数
+    static constexpr size_t kUnboundedQueueBlocks = 192;
+    static constexpr size_t kSpareBlocks = 64;
+
+    uint32_t maxFramesPerSlice = kMaxFramesPerSlice; // 不小于 kMaxFramesPerSlice 和设备的 IO 缓冲区
+    RingBuffer ring;
+    std::atomic<uint64_t> overflowFrames{0};
+    std::atomic<bool> deliveryRunning{false};
+    // startCapture() 在工作线程上就启动了设备，JS 线程建好环形缓冲区之前 IO 回调直接返回
+    std::atomic<bool> ringReady{false};
+
+    // 投递线程上的成块状态
+    bool batchPending = false;
+    std::chrono::steady_clock::time_point pendingSince;
+
+    // 每块数据的时间戳：IO 线程按周期记录锚点，投递线程按读出位置外推
+    TimestampTrack timestamps;
+    uint64_t capturedFrames = 0;    // IO 线程：已采集的总帧数（包括丢弃的）
+    uint64_t ringWrittenFrames = 0; // IO 线程：写入环形缓冲区的总帧数
+    uint64_t ringReadFrames = 0;    // 投递线程：从环形缓冲区读出的总帧数
+
+    // startCapture 选项
+    uint32_t ringFrames = kDefaultRingFrames;
+    size_t maxQueue = 0;
+    QueuePolicy queuePolicy = QueuePolicy::DropOldest;
+    uint32_t chunkFrames = 0;
+    uint32_t maxLatencyMs = 0;
+    uint32_t deviceSampleRate = 0; // 请求后端交出的采样率，0 表示设备（混音格式）的采样率
+
+    // 输出格式转换（f32/s16/s24，交错或平面），在投递线程上进行
+    SampleConverter converter;
+    std::vector<float> convertBuffer;
+
+    // 输出采样率和声道数，在投递线程上混音并重采样
+    double captureSampleRate = 0;            // 后端实际交出的采样率
+    uint32_t outputSampleRate = 0;             // 0 表示与采集采样率相同
+    uint32_t outputChannels = kChannels;
+    bool customFormat = false;
+    // 平面投递：每个声道一个 Float32Array，由投递线程从交错的环形缓冲区转换
+    bool planarDelivery = false;
+    Resampler resampler;
+    std::vector<float> resampleBuffer;
+
+    // 直接写文件：投递线程把处理后的采样交给独立的 I/O 线程
+    bool hasCallback = false;
+    bool hasFile = false;
+    FileWriterOptions fileOptions;
+    std::unique_ptr<FileWriter> fileWriter;
+    // 工作线程上打开的文件/编码器，准备完成后在 JS 线程接管，避免与 getStats 竞争
+    std::unique_ptr<FileWriter> preparedFile;
+    // 池的大小在 prepare 时确定，之后投递路径不再分配
+    uint32_t maxDeliverFrames = kMaxFramesPerSlice;
+    size_t poolBlockBytes = 0;
+    size_t poolBlocks = 0;
+
+    // 压缩编码（仅 macOS）：投递线程把处理后的采样交给编码线程，回调收到的是编码后的数据包
+    bool hasEncoder = false;
+#if defined(__APPLE__)
+    EncoderOptions encoderOptions;
+    std::unique_ptr<AudioEncoder> encoder;
+    std::unique_ptr<AudioEncoder> preparedEncoder;
+#endif
+
+    // 电平/频谱分析：投递线程按 rateHz 计算，JS 端只拿到最新一帧结果
+    static constexpr uint32_t kMaxMeterRateHz = 1000;
+    bool hasMeter = false;
+    uint32_t meterRateHz = 60;
+    uint32_t meterBands = 32;
+    uint32_t meterFftSize = 1024;
+    Napi::FunctionReference meterCallback;
+    LevelMeter meter;
+    std::mutex meterMutex;
+    std::vector<float> meterLatest;
+
+    // 静音门：投递线程按块判断是否有声，抑制或标记静音块
+    bool hasGate = false;
+    GateOptions gateOptions;
+    SilenceGate gate;
+    std::vector<float> preRollBuffer;
+
+    // 响度/削波统计：投递线程按处理链之后的采集数据增量计算，getLoudness 随时读取。
+    // 采集停止后仍保留，直到下一次 prepare
+    bool hasLoudness = false;
+    bool loudnessActive = false; // 本次采集是否在统计，只在 JS 线程访问
+    LoudnessMeter loudness;
+
+    // 原生处理链：setProcessors 或 processors 选项给出，跨多次采集保留。
+    // 链在 JS 线程上按采集采样率创建，加锁替换指针后由投递线程在读出环形缓冲区后原地处理
+    std::vector<ProcessorSpec> processorSpecs;
+    std::unique_ptr<ProcessorChain> processors;
+    std::mutex processorsMutex;
+
+    // 回溯缓冲区：投递线程把处理后的采集数据写入固定大小的历史，snapshot 在工作线程上取出。
+    // 采集停止后仍保留，直到下一次 prepare；进行中的 snapshot 共享持有
+    static constexpr double kMaxHistorySeconds = 600;
+    double historySeconds = 0;
+    SampleFormat historySample = SampleFormat::Float32;
+    std::shared_ptr<HistoryBuffer> history;
+    std::shared_ptr<HistoryBuffer> preparedHistory;
+
+    // 麦克风：独立的输入设备按主机时间对齐到主采集流，漂移由自适应重采样补偿。
+    // mix 模式叠加到两个声道，separate 模式输出 [系统音频, 麦克风] 两个单声道
+    enum class MicrophoneMode
+    {
+        Mix,
+        Separate,
+    };
+    static constexpr double kMicrophoneRingSeconds = 0.5;
+    static constexpr double kMicrophoneWaitMs = 100; // 主流积压超过这么久就不再等待麦克风
+    bool hasMicrophone = false;
+    std::string microphoneDevice; // 空字符串表示系统默认输入设备
+    MicrophoneMode microphoneMode = MicrophoneMode::Mix;
+    float microphoneGain = 1;
+    double microphoneOffsetMs = 0;
+    // 在工作线程上打开，准备完成后在 JS 线程接管；释放时只关闭，统计在下一次准备前仍可读取
+    std::unique_ptr<InputStream> microphone;
+    std::unique_ptr<InputStream> preparedMicrophone;
+    StreamAligner aligner; // 投递线程
+    std::vector<float> microphoneBuffer;
+
+    // 拉取模式：JS 线程直接作为环形缓冲区的消费者，
+    // 只有存在等待中的异步读取时才唤醒 JS 线程
+    bool pullMode = false;
+    std::atomic<bool> readWaiting{false};
+    std::deque<Napi::Promise::Deferred> pendingReads;
+
+    // 共享模式：环形缓冲区放在 SharedArrayBuffer 中，由 Worker 直接消费；
+    // 给出 sharedMemory 时放在命名共享内存中，由其他进程（如渲染进程）用 SharedMemoryReader 消费。
+    // 布局见 SharedRingLayout
+    static constexpr uint32_t kSharedHeaderInts = SharedRingLayout::kHeaderInts;
+    static constexpr uint32_t kSharedHeaderBytes = SharedRingLayout::kHeaderBytes;
+    static constexpr uint32_t kSharedWriteIndex = SharedRingLayout::kWriteIndex;
+    static constexpr uint32_t kSharedCapacityIndex = SharedRingLayout::kCapacityIndex;
+    static constexpr uint32_t kSharedChannelsIndex = SharedRingLayout::kChannelsIndex;
+    static constexpr uint32_t kSharedSampleRateIndex = SharedRingLayout::kSampleRateIndex;
+    static constexpr uint32_t kSharedReadIndex = SharedRingLayout::kReadIndex;
+    bool sharedMode = false;
+    Napi::ObjectReference sharedRing;
+    std::string sharedMemoryName;
+    std::unique_ptr<SharedMemorySegment> sharedMemory;
+
+    // 投递到 JS 线程的有界队列，由回调 lambda 共享持有
+    std::shared_ptr<DeliveryQueue> queue = std::make_shared<DeliveryQueue>();
+    // 数据块池，JS 持有的 ArrayBuffer 可能比本对象活得更久，因此共享持有
+    std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>();
+    // 健康状况统计，同样被投递回调共享持有
+    std::shared_ptr<CaptureStats> health = std::make_shared<CaptureStats>();
+
+    // 后端 IO 线程：只写入环形缓冲区和时间戳锚点，不分配内存
+    static void SourceCallback(void *context, const float *samples, uint32_t frames, const CaptureSourceTime &time)
+    {
+        AudioCapture *capture = static_cast<AudioCapture *>(context);
+        CaptureStats &health = *capture->health;
+        uint64_t start = time.cycleStartNs != 0 ? time.cycleStartNs : HostTimeNs();
+        health.RecordCycle(time.sampleTimeValid, time.sampleTime, time.hostTimeNs, frames);
+        capture->HandleSourceInput(samples, frames, time);
+        health.renderTime.Record(HostTimeNs() - start);
+    }
+
+    // 平面数据：在同一个 ArrayBuffer 上为每个声道建立一个 Float32Array 视图
+    static Napi::Array ChannelArrays(Napi::Env env, Napi::ArrayBuffer buffer, uint32_t channels, uint32_t frames)
+    {
+        Napi::Array arrays = Napi::Array::New(env, channels);
+        for (uint32_t ch = 0; ch < channels; ch++)
+        {
+            arrays.Set(ch, Napi::Float32Array::New(env, frames, buffer, static_cast<size_t>(ch) * frames * sizeof(float)));
+        }
+        return arrays;
+    }
+
+    // 把池中的数据块直接包装成外部 ArrayBuffer，在 finalizer 中归还给池。
+    // 不允许外部缓冲区的运行时（如启用了内存沙箱的 Electron）退回到复制一次。
+    static Napi::Value WrapAudioData(Napi::Env env, BufferPool::Handle audioData)
+    {
+        AudioData *block = audioData.get();
+        napi_value result;
+        napi_status status = napi_create_external_arraybuffer(
+            env,
+            block->data.get(),
+            block->size,
+            [](napi_env, void *, void *hint)
+            {
+                BufferPool::Recycler()(static_cast<AudioData *>(hint));
+            },
+            block,
+            &result);
+
+        if (status == napi_ok)
+        {
+            audioData.release();
+            return Napi::Value(env, result);
+        }
+
+        auto arrayBuffer = Napi::ArrayBuffer::New(env, block->size);
+        memcpy(arrayBuffer.Data(), block->data.get(), block->size);
+        return arrayBuffer;
+    }
+
+    void Deliver(BufferPool::Handle audioData)
+    {
+        audioData->enqueuedAt = HostTimeNs();
+        // 队列从空变为非空时才唤醒 JS 线程，JS 线程一次取空队列
+        if (!queue->Push(std::move(audioData)))
+        {
+            return;
+        }
+
+        napi_status status = scheduler->Post(handle, DeliveryScheduler::kWorkData);
+        health->RecordCallStatus(status);
+        if (status != napi_ok)
+        {
+            queue->Unschedule();
+        }
+    }
+
+    // JS 线程：取空数据队列。第二个参数：编码数据包为 { pts, hostTime, frames }，
+    // PCM 数据块为 { frame, frames, sampleTime, hostTime }，hostTime 与 process.hrtime.bigint() 同一时钟
+    void DrainQueue(Napi::Env env)
+    {
+        if (dataCallback.IsEmpty())
+        {
+            queue->Clear();
+            return;
+        }
+
+        Napi::Function jsCallback = dataCallback.Value();
+        while (auto audioData = queue->Pop())
+        {
+            health->deliveryLatency.Record(HostTimeNs() - audioData->enqueuedAt);
+            Napi::Object chunkInfo = Napi::Object::New(env);
+            if (audioData->encoded)
+            {
+                chunkInfo.Set("pts", Napi::Number::New(env, static_cast<double>(audioData->pts)));
+                chunkInfo.Set("hostTime", Napi::Number::New(env, static_cast<double>(audioData->time.hostTimeNs)));
+            }
+            else
+            {
+                chunkInfo.Set("frame", Napi::Number::New(env, static_cast<double>(audioData->time.frame)));
+                chunkInfo.Set("sampleTime", Napi::Number::New(env, audioData->time.sampleTime));
+                chunkInfo.Set("hostTime", Napi::Number::New(env, static_cast<double>(audioData->time.hostTimeNs)));
+                if (audioData->gated)
+                {
+                    chunkInfo.Set("active", Napi::Boolean::New(env, audioData->active));
+                }
+            }
+            chunkInfo.Set("frames", Napi::Number::New(env, audioData->frames));
+            uint32_t planarChannels = audioData->planarChannels;
+            uint32_t frames = audioData->frames;
+            Napi::Value buffer = WrapAudioData(env, std::move(audioData));
+            if (planarChannels > 0)
+            {
+                buffer = ChannelArrays(env, buffer.As<Napi::ArrayBuffer>(), planarChannels, frames);
+            }
+            jsCallback.Call({buffer, chunkInfo});
+
+            if (env.IsExceptionPending())
+            {
+                queue->Unschedule();
+                break;
+            }
+        }
+    }
+
+    // JS 线程：处理调度器转交的待办
+    void OnJsThread(Napi::Env env, uint32_t work) override
+    {
+        if (work & DeliveryScheduler::kWorkData)
+        {
+            DrainQueue(env);
+        }
+        if ((work & DeliveryScheduler::kWorkReaders) && !env.IsExceptionPending())
+        {
+            ResolvePendingReads(env);
+        }
+        if ((work & DeliveryScheduler::kWorkMeter) && !env.IsExceptionPending())
+        {
+            DeliverMeter(env);
+        }
+    }
+
+    // 投递线程：保存最新的分析结果，JS 还没取走上一帧时不再排队
+    void EmitMeter(const float *levels, size_t length)
+    {
+        {
+            std::lock_guard<std::mutex> lock(meterMutex);
+            meterLatest.assign(levels, levels + length);
+        }
+        health->RecordCallStatus(scheduler->Post(handle, DeliveryScheduler::kWorkMeter));
+    }
+
+    void DeliverMeter(Napi::Env env)
+    {
+        if (meterCallback.IsEmpty())
+        {
+            return;
+        }
+        Napi::Float32Array levels;
+        {
+            std::lock_guard<std::mutex> lock(meterMutex);
+            levels = Napi::Float32Array::New(env, meterLatest.size());
+            memcpy(levels.Data(), meterLatest.data(), meterLatest.size() * sizeof(float));
+        }
+        meterCallback.Value().Call({levels});
+    }
+
+    void MeterFrames(const float *samples, uint32_t frames)
+    {
+        if (hasMeter)
+        {
+            meter.Process(samples, frames, [this](const float *levels, size_t length)
+                          { EmitMeter(levels, length); });
+        }
+    }
+
+    // 投递线程：按采集格式原地运行处理链。JS 线程只在替换链时短暂持锁
+    void ProcessFrames(float *samples, uint32_t frames)
+    {
+        std::lock_guard<std::mutex> lock(processorsMutex);
+        if (processors)
+        {
+            processors->Process(samples, frames);
+        }
+    }
+
+    // 投递线程：把与这一块对齐的麦克风数据混入采集数据，time 为这一块首帧的时间
+    void MixMicrophone(float *samples, uint32_t frames, const ChunkTime &time)
+    {
+        if (!microphone)
+        {
+            return;
+        }
+        // 在 PrepareUnit 中按单次投递的最大帧数分配，超出时只是兜底
+        if (microphoneBuffer.size() < frames * kChannels)
+        {
+            microphoneBuffer.resize(frames * kChannels);
+        }
+        float *mic = microphoneBuffer.data();
+        aligner.Render(microphone->Ring(), microphone->Timestamps(), time.hostTimeNs, frames, mic);
+        if (microphoneMode == MicrophoneMode::Mix)
+        {
+            for (uint32_t i = 0; i < frames * kChannels; i++)
+            {
+                samples[i] += microphoneGain * mic[i];
+            }
+            return;
+        }
+        for (uint32_t i = 0; i < frames; i++)
+        {
+            samples[i * 2] = 0.5f * (samples[i * 2] + samples[i * 2 + 1]);
+            samples[i * 2 + 1] = 0.5f * microphoneGain * (mic[i * 2] + mic[i * 2 + 1]);
+        }
+    }
+
+    // 投递线程：麦克风是否已经覆盖环形缓冲区中的 frames 帧。主流积压过多时不再等待，缺少的部分填零
+    bool MicrophoneCovers(uint32_t frames)
+    {
+        if (frames >= captureSampleRate * kMicrophoneWaitMs / 1000)
+        {
+            return true;
+        }
+        return aligner.Covers(microphone->Ring(), microphone->Timestamps(), RingFrameTime(ringReadFrames).hostTimeNs, frames);
+    }
+
+    // 麦克风的 IO 线程：新数据到达后唤醒投递线程
+    static void MicrophoneNotify(void *context)
+    {
+        AudioCapture *self = static_cast<AudioCapture *>(context);
+        if (self->deliveryRunning.load(std::memory_order_relaxed))
+        {
+            self->scheduler->Signal();
+        }
+    }
+
+    // 编码线程：把数据包复制到池中的数据块并投递
+    void DeliverPacket(const uint8_t *data, size_t size, int64_t pts, uint32_t frames, uint64_t hostTimeNs)
+    {
+        BufferPool::Handle audioData = pool->Acquire(size);
+        if (!audioData)
+        {
+            return;
+        }
+        memcpy(audioData->data.get(), data, size);
+        audioData->encoded = true;
+        audioData->pts = pts;
+        audioData->frames = frames;
+        audioData->time.hostTimeNs = hostTimeNs;
+        Deliver(std::move(audioData));
+    }
+
+    // 实时线程：只写入环形缓冲区，不分配内存
+    void HandleSourceInput(const float *samples, uint32_t frames, const CaptureSourceTime &sourceTime)
+    {
+        if (!ringReady.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        if (sourceTime.status != 0)
+        {
+            health->renderErrors.fetch_add(1, std::memory_order_relaxed);
+            health->lastRenderError.store(sourceTime.status, std::memory_order_relaxed);
+            capturedFrames += frames;
+            return;
+        }
+
+        uint32_t written = ring.Write(samples, frames);
+        if (written < frames)
+        {
+            overflowFrames.fetch_add(frames - written, std::memory_order_relaxed);
+        }
+        if (written > 0 && !sharedMode)
+        {
+            TimestampTrack::Anchor anchor;
+            anchor.ringFrame = ringWrittenFrames;
+            anchor.time.frame = capturedFrames;
+            anchor.time.sampleTime = sourceTime.sampleTimeValid ? sourceTime.sampleTime : 0;
+            anchor.time.hostTimeNs = sourceTime.hostTimeNs;
+            timestamps.Push(anchor);
+        }
+        ringWrittenFrames += written;
+        capturedFrames += frames;
+        if (deliveryRunning.load(std::memory_order_relaxed))
+        {
+            scheduler->Signal();
+        }
+    }
+
+    bool NeedsProcessing() const
+    {
+        return outputChannels != kChannels || !resampler.IsPassthrough();
+    }
+
+    // 查不到锚点时（消费者落后太多）退回到只有帧序号
+    ChunkTime RingFrameTime(uint64_t ringFrame) const
+    {
+        ChunkTime time;
+        if (!timestamps.Lookup(ringFrame, time))
+        {
+            time.frame = ringFrame;
+        }
+        return time;
+    }
+
+    void DeliverFromRing(uint32_t frames)
+    {
+        // 每块不超过池中数据块的容量，积压的数据分成多块投递
+        while (frames > maxDeliverFrames)
+        {
+            DeliverFromRing(maxDeliverFrames);
+            frames -= maxDeliverFrames;
+        }
+
+        uint64_t firstFrame = ringReadFrames;
+        ChunkTime time = RingFrameTime(firstFrame);
+        ringReadFrames += frames;
+
+        bool processing = NeedsProcessing();
+        if (!processing && converter.Format().IsNativeLayout() && !fileWriter && !hasEncoder && hasCallback && !hasGate)
+        {
+            // 直接读入池中的数据块。池耗尽时该块计为丢弃，分析仍照常进行
+            BufferPool::Handle audioData = pool->Acquire(frames * kChannels * sizeof(float));
+            if (!audioData && convertBuffer.size() < frames * kChannels)
+            {
+                convertBuffer.resize(frames * kChannels);
+            }
+            float *samples = audioData ? reinterpret_cast<float *>(audioData->data.get()) : convertBuffer.data();
+            ring.Read(samples, frames);
+            MixMicrophone(samples, frames, time);
+            ProcessFrames(samples, frames);
+            if (history)
+            {
+                history->Write(samples, frames, time);
+            }
+            if (hasLoudness)
+            {
+                loudness.Process(samples, frames);
+            }
+            MeterFrames(samples, frames);
+            if (audioData)
+            {
+                audioData->frames = frames;
+                audioData->time = time;
+                Deliver(std::move(audioData));
+            }
+            return;
+        }
+
+        // 在投递线程上转换格式，JS 直接拿到目标格式的数据
+        if (convertBuffer.size() < frames * kChannels)
+        {
+            convertBuffer.resize(frames * kChannels);
+        }
+        ring.Read(convertBuffer.data(), frames);
+        MixMicrophone(convertBuffer.data(), frames, time);
+        ProcessFrames(convertBuffer.data(), frames);
+        if (history)
+        {
+            history->Write(convertBuffer.data(), frames, time);
+        }
+        if (hasLoudness)
+        {
+            loudness.Process(convertBuffer.data(), frames);
+        }
+
+        // 分析在处理链之后、下混和重采样之前进行，按采集格式计算
+        MeterFrames(convertBuffer.data(), frames);
+        if (!hasCallback && !fileWriter)
+        {
+            return;
+        }
+
+        // 静音门同样按采集格式判断。suppress 模式下静音块不交给回调/文件/编码器，
+        // 门打开时先补发 pre-roll；被抑制的区间表现为 info.frame 的跳变
+        bool active = true;
+        if (hasGate)
+        {
+            SilenceGate::State state = gate.Process(convertBuffer.data(), frames);
+            active = state != SilenceGate::State::Closed;
+            if (gate.Mode() == GateMode::Suppress)
+            {
+                if (!active)
+                {
+                    gate.Suppress(convertBuffer.data(), frames);
+                    return;
+                }
+                if (state == SilenceGate::State::Opening)
+                {
+                    uint32_t preRoll = gate.TakePreRoll(preRollBuffer);
+                    if (preRoll > 0)
+                    {
+                        DeliverSamples(preRollBuffer.data(), preRoll, RingFrameTime(firstFrame - preRoll), true);
+                    }
+                }
+            }
+        }
+        DeliverSamples(convertBuffer.data(), frames, time, active);
+    }
+
+    // 投递线程：下混、重采样后交给文件/编码器/回调。samples 为采集格式，下混时原地改写
+    void DeliverSamples(float *input, uint32_t frames, const ChunkTime &time, bool active)
+    {
+        const float *samples = input;
+        size_t outputFrames = frames;
+        if (NeedsProcessing())
+        {
+            // 立体声下混为单声道
+            if (outputChannels == 1)
+            {
+                for (uint32_t i = 0; i < frames; i++)
+                {
+                    input[i] = 0.5f * (input[i * 2] + input[i * 2 + 1]);
+                }
+            }
+
+            resampleBuffer.clear();
+            outputFrames = resampler.Process(input, frames, resampleBuffer);
+            samples = resampleBuffer.data();
+            if (outputFrames == 0)
+            {
+                return;
+            }
+        }
+
+        if (fileWriter)
+        {
+            fileWriter->Write(samples, outputFrames);
+        }
+
+#if defined(__APPLE__)
+        if (encoder)
+        {
+            encoder->Write(samples, outputFrames, time);
+            return;
+        }
+#endif
+
+        if (!hasCallback)
+        {
+            return;
+        }
+
+        BufferPool::Handle audioData = pool->Acquire(converter.OutputBytes(outputFrames, outputChannels));
+        if (!audioData)
+        {
+            return;
+        }
+        audioData->frames = static_cast<uint32_t>(outputFrames);
+        audioData->time = time;
+        audioData->gated = hasGate;
+        audioData->active = active;
+        audioData->planarChannels = planarDelivery ? outputChannels : 0;
+        converter.Convert(samples, outputFrames, outputChannels, audioData->data.get());
+        Deliver(std::move(audioData));
+    }
+
+    // 投递线程：把环形缓冲区中的数据取出并交给 JS。
+    // 设置了 chunkFrames 时按固定帧数成块投递；设置了 maxLatencyMs 时，
+    // 不足一块的数据最多等待这么久就投递。返回距离下次必须处理还有多久。
+    int64_t ServiceDelivery() override
+    {
+        using Clock = std::chrono::steady_clock;
+        const int64_t idleNs = 100 * kNsPerMs;
+        const auto maxLatency = std::chrono::milliseconds(maxLatencyMs);
+
+        uint32_t frames = ring.AvailableRead();
+        if (frames == 0)
+        {
+            batchPending = false;
+            return idleNs;
+        }
+
+        if (pullMode)
+        {
+            if (frames >= PullChunkFrames() && readWaiting.exchange(false))
+            {
+                NotifyReaders();
+            }
+            return idleNs;
+        }
+
+        // 等麦克风的数据到达后再投递，两路数据才能按时间对齐
+        if (microphone && !MicrophoneCovers(frames))
+        {
+            return 2 * kNsPerMs;
+        }
+
+        if (chunkFrames == 0 && maxLatencyMs == 0)
+        {
+            DeliverFromRing(frames);
+            return idleNs;
+        }
+
+        if (!batchPending)
+        {
+            pendingSince = Clock::now();
+            batchPending = true;
+        }
+
+        bool delivered = false;
+        if (chunkFrames > 0)
+        {
+            while (frames >= chunkFrames)
+            {
+                DeliverFromRing(chunkFrames);
+                frames -= chunkFrames;
+                delivered = true;
+            }
+        }
+
+        if (frames > 0 && maxLatencyMs > 0 && Clock::now() - pendingSince >= maxLatency)
+        {
+            DeliverFromRing(frames);
+            frames = 0;
+            delivered = true;
+        }
+
+        // 剩余不足一块的数据从现在开始计时
+        batchPending = frames > 0;
+        if (batchPending && delivered)
+        {
+            pendingSince = Clock::now();
+        }
+        if (batchPending && maxLatencyMs > 0)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(pendingSince + maxLatency - Clock::now()).count();
+            return remaining > 0 ? std::min<int64_t>(remaining, idleNs) : 0;
+        }
+        return idleNs;
+    }
+
+    // 异步读取至少等待的帧数
+    uint32_t PullChunkFrames() const
+    {
+        return chunkFrames > 0 ? chunkFrames : 1;
+    }
+
+    void NotifyReaders()
+    {
+        napi_status status = scheduler->Post(handle, DeliveryScheduler::kWorkReaders);
+        health->RecordCallStatus(status);
+        if (status != napi_ok)
+        {
+            readWaiting.store(true, std::memory_order_release);
+        }
+    }
+
+    // JS 线程：取出一块数据，设置了 chunkFrames 时每块不超过 chunkFrames 帧
+    Napi::Value ReadChunk(Napi::Env env)
+    {
+        uint32_t frames = ring.AvailableRead();
+        if (chunkFrames > 0 && frames > chunkFrames)
+        {
+            frames = chunkFrames;
+        }
+        Napi::Float32Array chunk = Napi::Float32Array::New(env, frames * kChannels);
+        ring.Read(chunk.Data(), frames);
+        return chunk;
+    }
+
+    static Napi::Object IteratorResult(Napi::Env env, Napi::Value value, bool done)
+    {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("value", value);
+        result.Set("done", Napi::Boolean::New(env, done));
+        return result;
+    }
+
+    void ResolvePendingReads(Napi::Env env)
+    {
+        while (!pendingReads.empty() && ring.AvailableRead() >= PullChunkFrames())
+        {
+            Napi::Promise::Deferred deferred = pendingReads.front();
+            pendingReads.pop_front();
+            deferred.Resolve(IteratorResult(env, ReadChunk(env), false));
+        }
+
+        if (!pendingReads.empty())
+        {
+            if (isPrepared)
+            {
+                readWaiting.store(true, std::memory_order_release);
+                return;
+            }
+
+            // 采集已释放：先交出剩余的数据，然后结束迭代
+            while (!pendingReads.empty())
+            {
+                Napi::Promise::Deferred deferred = pendingReads.front();
+                pendingReads.pop_front();
+                if (ring.AvailableRead() > 0)
+                {
+                    deferred.Resolve(IteratorResult(env, ReadChunk(env), false));
+                }
+                else
+                {
+                    deferred.Resolve(IteratorResult(env, env.Undefined(), true));
+                }
+            }
+        }
+    }
+
+    Napi::Value NextChunk(Napi::Env env)
+    {
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+        if (!pullMode)
+        {
+            deferred.Reject(Napi::Error::New(env, "Async iteration requires pull mode").Value());
+            return deferred.Promise();
+        }
+
+        pendingReads.push_back(deferred);
+        ResolvePendingReads(env);
+        return deferred.Promise();
+    }
+
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports)
+    {
+        Napi::Function func = DefineClass(env, "AudioCapture", {InstanceMethod("requestPermission", &AudioCapture::RequestPermission), InstanceMethod("startCapture", &AudioCapture::StartCapture), InstanceMethod("stopCapture", &AudioCapture::StopCapture), InstanceMethod("prepare", &AudioCapture::Prepare), InstanceMethod("start", &AudioCapture::Start), InstanceMethod("stop", &AudioCapture::Stop), InstanceMethod("dispose", &AudioCapture::Dispose), InstanceMethod("getStats", &AudioCapture::GetStats), InstanceMethod("getLatency", &AudioCapture::GetLatency), InstanceMethod("read", &AudioCapture::Read), InstanceMethod("getSharedBuffer", &AudioCapture::GetSharedBuffer), InstanceMethod("getEncoderConfig", &AudioCapture::GetEncoderConfig), InstanceMethod("setProcessors", &AudioCapture::SetProcessors), InstanceMethod("snapshot", &AudioCapture::Snapshot), InstanceMethod("getLoudness", &AudioCapture::GetLoudness), InstanceMethod(Napi::Symbol::WellKnown(env, "asyncIterator"), &AudioCapture::AsyncIterator), StaticMethod("enumerateDevices", &AudioCapture::EnumerateDevices)});
+
+        AddonData *data = new AddonData();
+        data->constructor = Napi::Persistent(func);
+        env.SetInstanceData(data);
+
+        exports.Set("AudioCapture", func);
+        exports.Set("enumerateDevices", Napi::Function::New(env, EnumerateDevices));
+        exports.Set("SharedMemoryReader", SharedMemoryReader::Define(env));
+        return exports;
+    }
+
+    AudioCapture(const Napi::CallbackInfo &info)
+        : Napi::ObjectWrap<AudioCapture>(info),
+          isCapturing(false),
+          env_(info.Env())
+    {
+        scheduler = info.Env().GetInstanceData<AddonData>()->scheduler;
+        handle->client = this;
+        napi_add_env_cleanup_hook(env_, EnvCleanup, this);
+    }
+
+    // 环境退出（进程退出、Worker 终止）时运行，早于 ObjectWrap 的析构。此时不再有 GC，
+    // 可以同步等待进行中的工作并释放采集设备，Promise 不再兑现
+    static void EnvCleanup(void *arg)
+    {
+        AudioCapture *self = static_cast<AudioCapture *>(arg);
+        {
+            std::unique_lock<std::mutex> lock(self->workMutex);
+            self->workIdle.wait(lock, [self]()
+                                { return !self->working; });
+            self->shuttingDown = true;
+        }
+        if (self->isPrepared)
+        {
+            self->ReleaseUnit();
+            self->isPrepared = false;
+        }
+        else
+        {
+            // 准备已在工作线程上完成但来不及在 JS 线程接管
+            self->DiscardPrepared();
+        }
+    }
+
+    // 工作线程：执行准备/释放，环境退出后直接放弃
+    std::string RunWork(const std::function<std::string()> &work)
+    {
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            if (shuttingDown)
+            {
+                return "Environment is shutting down";
+            }
+            working = true;
+        }
+        std::string error = work();
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            working = false;
+        }
+        workIdle.notify_all();
+        return error;
+    }
+
+    // 返回 [{ id, uid, name, manufacturer, inputChannels, outputChannels, sampleRate,
+    //        isDefaultInput, isDefaultOutput }]，id 可直接作为 device 选项。
+    // macOS 上 id 为 AudioDeviceID 数字，其他平台为后端的设备 id 字符串
+    static Napi::Value EnumerateDevices(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        std::vector<CaptureDeviceInfo> devices = ListCaptureDevices();
+        Napi::Array result = Napi::Array::New(env, devices.size());
+        for (size_t i = 0; i < devices.size(); i++)
+        {
+            const CaptureDeviceInfo &info = devices[i];
+            Napi::Object device = Napi::Object::New(env);
+#if defined(__APPLE__)
+            device.Set("id", Napi::Number::New(env, std::stod(info.id)));
+#else
+            device.Set("id", Napi::String::New(env, info.id));
+#endif
+            device.Set("uid", Napi::String::New(env, info.uid));
+            device.Set("name", Napi::String::New(env, info.name));
+            device.Set("manufacturer", Napi::String::New(env, info.manufacturer));
+            device.Set("inputChannels", Napi::Number::New(env, info.inputChannels));
+            device.Set("outputChannels", Napi::Number::New(env, info.outputChannels));
+            device.Set("sampleRate", Napi::Number::New(env, info.sampleRate));
+            device.Set("isDefaultInput", Napi::Boolean::New(env, info.isDefaultInput));
+            device.Set("isDefaultOutput", Napi::Boolean::New(env, info.isDefaultOutput));
+            result.Set(static_cast<uint32_t>(i), device);
+        }
+        return result;
+    }
+
+    // 返回 Promise<boolean>：在工作线程上查询音频输入的 TCC 授权，尚未决定时弹出系统提示。
+    // tap 后端的系统音频录制授权没有公开的查询接口，会在第一次创建 tap 时由系统提示。
+    // 其他平台没有采集授权，总是 true
+    Napi::Value RequestPermission(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+#if !defined(__APPLE__)
+        deferred.Resolve(Napi::Boolean::New(env, true));
+#else
+        auto status = std::make_shared<PermissionStatus>(PermissionStatus::NotDetermined);
+        BackgroundWorker::Run(
+            env, info.This().As<Napi::Object>(),
+            [status]()
+            {
+                *status = RequestAudioInputPermission();
+                return std::string();
+            },
+            [deferred, status](Napi::Env env, const std::string &)
+            { deferred.Resolve(Napi::Boolean::New(env, *status == PermissionStatus::Authorized)); });
+#endif
+        return deferred.Promise();
+    }
+
+    // 读取非负整数选项，类型或范围错误时抛出异常并返回 false
+    static bool ReadUint32Option(Napi::Env env, Napi::Object options, const char *name, uint32_t minValue, uint32_t &value)
+    {
+        if (!options.Has(name))
+        {
+            return true;
+        }
+
+        Napi::Value option = options.Get(name);
+        if (!option.IsNumber() || option.As<Napi::Number>().DoubleValue() < minValue ||
+            option.As<Napi::Number>().DoubleValue() > UINT32_MAX)
+        {
+            Napi::Error::New(env, std::string(name) + " must be a number >= " + std::to_string(minValue)).ThrowAsJavaScriptException();
+            return false;
+        }
+
+        value = option.As<Napi::Number>().Uint32Value();
+        return true;
+    }
+
+    // file: 路径字符串，或 { path, container: 'wav'|'caf', sampleFormat: 's16'|'s24'|'f32',
+    //        fsync: 'none'|'header'|'always', headerIntervalMs }
+    bool ParseFileOption(Napi::Env env, Napi::Value value)
+    {
+        if (value.IsUndefined() || value.IsNull())
+        {
+            return true;
+        }
+
+        if (value.IsString())
+        {
+            fileOptions.path = value.As<Napi::String>().Utf8Value();
+        }
+        else if (value.IsObject())
+        {
+            Napi::Object file = value.As<Napi::Object>();
+            if (!file.Get("path").IsString())
+            {
+                Napi::TypeError::New(env, "file.path must be a string").ThrowAsJavaScriptException();
+                return false;
+            }
+            fileOptions.path = file.Get("path").As<Napi::String>().Utf8Value();
+
+            if (file.Has("container") &&
+                (!file.Get("container").IsString() ||
+                 !ParseFileContainer(file.Get("container").As<Napi::String>().Utf8Value(), fileOptions.container)))
+            {
+                Napi::Error::New(env, "file.container must be 'wav' or 'caf'").ThrowAsJavaScriptException();
+                return false;
+            }
+            if (file.Has("sampleFormat"))
+            {
+                OutputFormat format;
+                if (!file.Get("sampleFormat").IsString() ||
+                    !ParseOutputFormat(file.Get("sampleFormat").As<Napi::String>().Utf8Value(), format) || format.planar)
+                {
+                    Napi::Error::New(env, "file.sampleFormat must be 's16', 's24' or 'f32'").ThrowAsJavaScriptException();
+                    return false;
+                }
+                fileOptions.sample = format.sample;
+            }
+            if (file.Has("fsync") &&
+                (!file.Get("fsync").IsString() ||
+                 !ParseSyncPolicy(file.Get("fsync").As<Napi::String>().Utf8Value(), fileOptions.sync)))
+            {
+                Napi::Error::New(env, "file.fsync must be 'none', 'header' or 'always'").ThrowAsJavaScriptException();
+                return false;
+            }
+            if (!ReadUint32Option(env, file, "headerIntervalMs", 0, fileOptions.headerIntervalMs))
+            {
+                return false;
+            }
+            if (file.Has("container"))
+            {
+                hasFile = true;
+                return true;
+            }
+        }
+        else
+        {
+            Napi::TypeError::New(env, "file must be a path or an object").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        // 未指定容器时按扩展名判断
+        const std::string &path = fileOptions.path;
+        if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".caf") == 0)
+        {
+            fileOptions.container = FileContainer::Caf;
+        }
+        hasFile = true;
+        return true;
+    }
+
+    // encoder: 'aac' | 'opus' 或 { codec, bitrate, adts }，只在 macOS 上提供。opus 未指定 sampleRate 时输出 48 kHz
+    bool ParseEncoderOption(Napi::Env env, Napi::Value value)
+    {
+#if !defined(__APPLE__)
+        (void)value;
+        Napi::Error::New(env, "encoder is only supported on macOS").ThrowAsJavaScriptException();
+        return false;
+#else
+        encoderOptions = EncoderOptions();
+        Napi::Value codec = value;
+        if (value.IsObject() && !value.IsString())
+        {
+            Napi::Object object = value.As<Napi::Object>();
+            codec = object.Has("codec") ? object.Get("codec") : Napi::String::New(env, "aac");
+            if (!ReadUint32Option(env, object, "bitrate", 8000, encoderOptions.bitrate))
+            {
+                return false;
+            }
+            if (object.Has("adts"))
+            {
+                encoderOptions.adts = object.Get("adts").ToBoolean().Value();
+            }
+        }
+
+        if (!codec.IsString() || !ParseCodec(codec.As<Napi::String>().Utf8Value(), encoderOptions.codec))
+        {
+            Napi::Error::New(env, "encoder codec must be 'aac' or 'opus'").ThrowAsJavaScriptException();
+            return false;
+        }
+        hasEncoder = true;
+        return true;
+#endif
+    }
+
+    // meter: 回调函数，或 { callback, rateHz, bands, fftSize }
+    bool ParseMeterOption(Napi::Env env, Napi::Value value)
+    {
+        meterRateHz = 60;
+        meterBands = 32;
+        meterFftSize = 1024;
+        Napi::Value callback = value;
+        if (value.IsObject() && !value.IsFunction())
+        {
+            Napi::Object object = value.As<Napi::Object>();
+            callback = object.Get("callback");
+            if (!ReadUint32Option(env, object, "rateHz", 1, meterRateHz) ||
+                !ReadUint32Option(env, object, "bands", 0, meterBands) ||
+                !ReadUint32Option(env, object, "fftSize", 64, meterFftSize))
+            {
+                return false;
+            }
+            if (meterRateHz > kMaxMeterRateHz || meterFftSize > 16384 || (meterFftSize & (meterFftSize - 1)) != 0)
+            {
+                Napi::Error::New(env, "meter.rateHz must be <= 1000 and meter.fftSize a power of two <= 16384").ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+
+        if (!callback.IsFunction())
+        {
+            Napi::TypeError::New(env, "meter requires a callback function").ThrowAsJavaScriptException();
+            return false;
+        }
+        meterCallback = Napi::Persistent(callback.As<Napi::Function>());
+        hasMeter = true;
+        return true;
+    }
+
+    // device / microphone.device：enumerateDevices 返回的 id（macOS 为 AudioDeviceID 数字）或 uid 字符串，
+    // 由后端在打开时查找
+    static bool ParseDeviceId(Napi::Env env, Napi::Value value, const char *name, std::string &device)
+    {
+        device.clear();
+        if (value.IsNumber())
+        {
+            device = std::to_string(value.As<Napi::Number>().Uint32Value());
+        }
+        else if (value.IsString())
+        {
+            device = value.As<Napi::String>().Utf8Value();
+        }
+        else if (!value.IsUndefined() && !value.IsNull())
+        {
+            Napi::TypeError::New(env, std::string(name) + " must be a device id or UID").ThrowAsJavaScriptException();
+            return false;
+        }
+        return true;
+    }
+
+    // tap: { processes: [pid], exclude, mute }，指定后使用 tap 后端（仅 macOS）
+    bool ParseTapOption(Napi::Env env, Napi::Value value)
+    {
+        if (!value.IsObject())
+        {
+            Napi::TypeError::New(env, "tap must be an object").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::Object tap = value.As<Napi::Object>();
+        if (tap.Has("processes"))
+        {
+            Napi::Value processes = tap.Get("processes");
+            if (!processes.IsArray())
+            {
+                Napi::TypeError::New(env, "tap.processes must be an array of process ids").ThrowAsJavaScriptException();
+                return false;
+            }
+            Napi::Array list = processes.As<Napi::Array>();
+            for (uint32_t i = 0; i < list.Length(); i++)
+            {
+                Napi::Value pid = list.Get(i);
+                if (!pid.IsNumber())
+                {
+                    Napi::TypeError::New(env, "tap.processes must be an array of process ids").ThrowAsJavaScriptException();
+                    return false;
+                }
+                sourceOptions.tapProcesses.push_back(pid.As<Napi::Number>().Int32Value());
+            }
+        }
+        // 默认：给了进程列表时只捕获这些进程，否则捕获全部
+        sourceOptions.tapExclude = sourceOptions.tapProcesses.empty();
+        if (tap.Has("exclude"))
+        {
+            sourceOptions.tapExclude = tap.Get("exclude").ToBoolean().Value();
+        }
+        if (tap.Has("mute"))
+        {
+            sourceOptions.tapMute = tap.Get("mute").ToBoolean().Value();
+        }
+        sourceOptions.tap = true;
+        return true;
+    }
+
+    // gate: true 或 { thresholdDb, hangoverMs, preRollMs, mode: 'suppress' | 'flag' }
+    bool ParseGateOption(Napi::Env env, Napi::Value value)
+    {
+        gateOptions = GateOptions();
+        if (value.IsBoolean())
+        {
+            hasGate = value.As<Napi::Boolean>().Value();
+            return true;
+        }
+        if (!value.IsObject())
+        {
+            Napi::TypeError::New(env, "gate must be a boolean or an object").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::Object gate = value.As<Napi::Object>();
+        if (gate.Has("thresholdDb"))
+        {
+            Napi::Value threshold = gate.Get("thresholdDb");
+            if (!threshold.IsNumber() || threshold.As<Napi::Number>().DoubleValue() > 0)
+            {
+                Napi::Error::New(env, "gate.thresholdDb must be a number <= 0").ThrowAsJavaScriptException();
+                return false;
+            }
+            gateOptions.thresholdDb = threshold.As<Napi::Number>().DoubleValue();
+        }
+        if (!ReadUint32Option(env, gate, "hangoverMs", 0, gateOptions.hangoverMs) ||
+            !ReadUint32Option(env, gate, "preRollMs", 0, gateOptions.preRollMs))
+        {
+            return false;
+        }
+        if (gateOptions.preRollMs > 10000)
+        {
+            Napi::Error::New(env, "gate.preRollMs must be <= 10000").ThrowAsJavaScriptException();
+            return false;
+        }
+        if (gate.Has("mode"))
+        {
+            if (!gate.Get("mode").IsString() || !ParseGateMode(gate.Get("mode").As<Napi::String>().Utf8Value(), gateOptions.mode))
+            {
+                Napi::Error::New(env, "gate.mode must be 'suppress' or 'flag'").ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+        hasGate = true;
+        return true;
+    }
+
+    // 读取 [minValue, maxValue] 范围内的数值选项，类型或范围错误时抛出异常并返回 false
+    static bool ReadNumberOption(Napi::Env env, Napi::Object options, const char *name, double minValue, double maxValue, double &value)
+    {
+        if (!options.Has(name))
+        {
+            return true;
+        }
+
+        Napi::Value option = options.Get(name);
+        if (!option.IsNumber() || !(option.As<Napi::Number>().DoubleValue() >= minValue) ||
+            option.As<Napi::Number>().DoubleValue() > maxValue)
+        {
+            char message[128];
+            snprintf(message, sizeof(message), "%s must be a number between %g and %g", name, minValue, maxValue);
+            Napi::Error::New(env, message).ThrowAsJavaScriptException();
+            return false;
+        }
+
+        value = option.As<Napi::Number>().DoubleValue();
+        return true;
+    }
+
+    // processors: [{ type: 'gain', gainDb }
+    //              | { type: 'lowpass'|'highpass'|'bandpass'|'notch'|'peaking'|'lowshelf'|'highshelf', frequency, q, gainDb }
+    //              | { type: 'agc', targetDb, maxGainDb, attackMs, releaseMs }
+    //              | { type: 'noiseSuppression', reductionDb }]
+    static bool ParseProcessors(Napi::Env env, Napi::Value value, std::vector<ProcessorSpec> &specs)
+    {
+        static constexpr uint32_t kMaxProcessors = 16;
+        specs.clear();
+        if (value.IsUndefined() || value.IsNull())
+        {
+            return true;
+        }
+        if (!value.IsArray() || value.As<Napi::Array>().Length() > kMaxProcessors)
+        {
+            Napi::TypeError::New(env, "processors must be an array of at most 16 entries").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::Array array = value.As<Napi::Array>();
+        for (uint32_t i = 0; i < array.Length(); i++)
+        {
+            Napi::Value item = array.Get(i);
+            if (!item.IsObject() || !item.As<Napi::Object>().Get("type").IsString())
+            {
+                Napi::TypeError::New(env, "each processor must be an object with a type").ThrowAsJavaScriptException();
+                return false;
+            }
+
+            Napi::Object object = item.As<Napi::Object>();
+            std::string type = object.Get("type").As<Napi::String>().Utf8Value();
+            ProcessorSpec spec;
+            bool valid = true;
+            if (type == "gain")
+            {
+                spec.type = ProcessorType::Gain;
+                valid = ReadNumberOption(env, object, "gainDb", -60, 60, spec.gainDb);
+            }
+            else if (ParseBiquadType(type, spec.filter))
+            {
+                spec.type = ProcessorType::Biquad;
+                valid = ReadNumberOption(env, object, "frequency", 1, 96000, spec.frequency) &&
+                        ReadNumberOption(env, object, "q", 0.01, 100, spec.q) &&
+                        ReadNumberOption(env, object, "gainDb", -30, 30, spec.gainDb);
+            }
+            else if (type == "agc")
+            {
+                spec.type = ProcessorType::Agc;
+                valid = ReadNumberOption(env, object, "targetDb", -60, 0, spec.targetDb) &&
+                        ReadNumberOption(env, object, "maxGainDb", 0, 60, spec.maxGainDb) &&
+                        ReadNumberOption(env, object, "attackMs", 0, 10000, spec.attackMs) &&
+                        ReadNumberOption(env, object, "releaseMs", 0, 60000, spec.releaseMs);
+            }
+            else if (type == "noiseSuppression")
+            {
+                spec.type = ProcessorType::NoiseSuppressor;
+                valid = ReadNumberOption(env, object, "reductionDb", 0, 60, spec.reductionDb);
+            }
+            else
+            {
+                Napi::Error::New(env, "unknown processor type: " + type).ThrowAsJavaScriptException();
+                return false;
+            }
+
+            if (!valid)
+            {
+                return false;
+            }
+            specs.push_back(spec);
+        }
+        return true;
+    }
+
+    // JS 线程：按当前的 processorSpecs 创建处理链并替换，旧链在锁外销毁
+    void InstallProcessors()
+    {
+        std::unique_ptr<ProcessorChain> chain;
+        if (!processorSpecs.empty())
+        {
+            chain = ProcessorChain::Create(processorSpecs, captureSampleRate, kChannels, maxDeliverFrames);
+        }
+        std::lock_guard<std::mutex> lock(processorsMutex);
+        processors.swap(chain);
+    }
+
+    // history: 秒数，或 { seconds, format: 'f32' | 's16' }
+    bool ParseHistoryOption(Napi::Env env, Napi::Value value)
+    {
+        if (value.IsUndefined() || value.IsNull())
+        {
+            return true;
+        }
+
+        Napi::Value seconds = value;
+        if (value.IsObject())
+        {
+            Napi::Object object = value.As<Napi::Object>();
+            seconds = object.Get("seconds");
+            if (object.Has("format"))
+            {
+                OutputFormat format;
+                if (!object.Get("format").IsString() || !ParseOutputFormat(object.Get("format").As<Napi::String>().Utf8Value(), format) ||
+                    format.planar || format.sample == SampleFormat::Int24)
+                {
+                    Napi::Error::New(env, "history.format must be 'f32' or 's16'").ThrowAsJavaScriptException();
+                    return false;
+                }
+                historySample = format.sample;
+            }
+        }
+        if (!seconds.IsNumber() || !(seconds.As<Napi::Number>().DoubleValue() > 0) ||
+            seconds.As<Napi::Number>().DoubleValue() > kMaxHistorySeconds)
+        {
+            Napi::Error::New(env, "history.seconds must be a number between 0 and 600").ThrowAsJavaScriptException();
+            return false;
+        }
+        historySeconds = seconds.As<Napi::Number>().DoubleValue();
+        return true;
+    }
+
+    // microphone: true（系统默认输入设备）或 { device, mode: 'mix' | 'separate', gainDb, offsetMs }。
+    // device 与采集设备的 device 选项相同；offsetMs 为正时麦克风相对系统音频再延后
+    bool ParseMicrophoneOption(Napi::Env env, Napi::Value value)
+    {
+        if (value.IsBoolean())
+        {
+            hasMicrophone = value.As<Napi::Boolean>().Value();
+            return true;
+        }
+        if (value.IsUndefined() || value.IsNull())
+        {
+            return true;
+        }
+        if (!value.IsObject())
+        {
+            Napi::TypeError::New(env, "microphone must be a boolean or an object").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::Object object = value.As<Napi::Object>();
+        if (!ParseDeviceId(env, object.Get("device"), "microphone.device", microphoneDevice))
+        {
+            return false;
+        }
+
+        if (object.Has("mode"))
+        {
+            std::string mode = object.Get("mode").IsString() ? object.Get("mode").As<Napi::String>().Utf8Value() : "";
+            if (mode == "mix")
+            {
+                microphoneMode = MicrophoneMode::Mix;
+            }
+            else if (mode == "separate")
+            {
+                microphoneMode = MicrophoneMode::Separate;
+            }
+            else
+            {
+                Napi::Error::New(env, "microphone.mode must be 'mix' or 'separate'").ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+
+        double gainDb = 0;
+        if (!ReadNumberOption(env, object, "gainDb", -60, 30, gainDb) ||
+            !ReadNumberOption(env, object, "offsetMs", -500, 500, microphoneOffsetMs))
+        {
+            return false;
+        }
+        microphoneGain = static_cast<float>(std::pow(10.0, gainDb / 20));
+        hasMicrophone = true;
+        return true;
+    }
+
+    // 解析 startCapture 选项：
+    // { device, backend, tap, deviceSampleRate, bufferFrames, ring, ringFrames, maxQueue, queuePolicy, chunkFrames, maxLatencyMs, pull, shared,
+    //   outputFormat, sampleRate, channels, file, encoder, meter, gate, processors, history, loudness, microphone }
+    // processors 未给出时沿用之前 setProcessors 设置的处理链
+    bool ParseOptions(Napi::Env env, Napi::Value value)
+    {
+        pullMode = false;
+        sharedMode = false;
+        sharedMemoryName.clear();
+        ringFrames = kDefaultRingFrames;
+        maxQueue = 0;
+        queuePolicy = QueuePolicy::DropOldest;
+        chunkFrames = 0;
+        maxLatencyMs = 0;
+        sourceOptions = CaptureSourceOptions();
+        deviceSampleRate = 0;
+
+        converter.SetFormat(OutputFormat());
+        planarDelivery = false;
+        outputSampleRate = 0;
+        outputChannels = kChannels;
+        customFormat = false;
+        hasFile = false;
+        fileOptions = FileWriterOptions();
+        hasEncoder = false;
+        hasMeter = false;
+        meterCallback.Reset();
+        hasGate = false;
+        gateOptions = GateOptions();
+        historySeconds = 0;
+        historySample = SampleFormat::Float32;
+        hasLoudness = false;
+        hasMicrophone = false;
+        microphoneDevice.clear();
+        microphoneMode = MicrophoneMode::Mix;
+        microphoneGain = 1;
+        microphoneOffsetMs = 0;
+
+        if (value.IsUndefined() || value.IsNull())
+        {
+            return true;
+        }
+
+        if (!value.IsObject())
+        {
+            Napi::TypeError::New(env, "options must be an object").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::Object options = value.As<Napi::Object>();
+        if (!ParseDeviceId(env, options.Get("device"), "device", sourceOptions.device))
+        {
+            return false;
+        }
+        if (options.Has("tap") && !ParseTapOption(env, options.Get("tap")))
+        {
+            return false;
+        }
+        if (options.Has("backend"))
+        {
+            std::string name = options.Get("backend").IsString() ? options.Get("backend").As<Napi::String>().Utf8Value() : "";
+            if (name == "tap")
+            {
+                sourceOptions.tap = true;
+            }
+            else if (name != "hal" || sourceOptions.tap)
+            {
+                Napi::Error::New(env, "backend must be 'hal' or 'tap' (tap options require the tap backend)").ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+#if !defined(__APPLE__)
+        if (sourceOptions.tap)
+        {
+            Napi::Error::New(env, "The tap backend is only supported on macOS").ThrowAsJavaScriptException();
+            return false;
+        }
+#endif
+        // deviceSampleRate：请求后端以该采样率交出数据（由系统转换），0 表示设备（混音格式）的采样率
+        if (!ReadUint32Option(env, options, "deviceSampleRate", 0, deviceSampleRate) ||
+            !ReadUint32Option(env, options, "bufferFrames", 0, sourceOptions.bufferFrames))
+        {
+            return false;
+        }
+        if (deviceSampleRate > 384000)
+        {
+            Napi::Error::New(env, "deviceSampleRate must be <= 384000").ThrowAsJavaScriptException();
+            return false;
+        }
+        // ring 选项保留兼容，现在总是经过环形缓冲区
+        if (!ReadUint32Option(env, options, "ringFrames", kMaxFramesPerSlice, ringFrames))
+        {
+            return false;
+        }
+
+        uint32_t depth = 0;
+        if (!ReadUint32Option(env, options, "maxQueue", 0, depth))
+        {
+            return false;
+        }
+        maxQueue = depth;
+
+        if (options.Has("queuePolicy"))
+        {
+            if (!options.Get("queuePolicy").IsString() ||
+                !ParseQueuePolicy(options.Get("queuePolicy").As<Napi::String>().Utf8Value(), queuePolicy))
+            {
+                Napi::Error::New(env, "queuePolicy must be 'drop-newest', 'drop-oldest' or 'coalesce'").ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+
+        if (!ReadUint32Option(env, options, "chunkFrames", 0, chunkFrames) ||
+            !ReadUint32Option(env, options, "maxLatencyMs", 0, maxLatencyMs))
+        {
+            return false;
+        }
+
+        if (options.Has("pull"))
+        {
+            pullMode = options.Get("pull").ToBoolean().Value();
+        }
+        if (options.Has("shared"))
+        {
+            sharedMode = options.Get("shared").ToBoolean().Value();
+        }
+        if (options.Has("sharedMemory") && !ParseSharedMemoryOption(env, options.Get("sharedMemory")))
+        {
+            return false;
+        }
+        if (pullMode && sharedMode)
+        {
+            Napi::Error::New(env, "pull and shared modes are mutually exclusive").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        OutputFormat outputFormat;
+        if (options.Has("outputFormat"))
+        {
+            if (!options.Get("outputFormat").IsString() ||
+                !ParseOutputFormat(options.Get("outputFormat").As<Napi::String>().Utf8Value(), outputFormat))
+            {
+                Napi::Error::New(env, "outputFormat must be 'f32', 's16' or 's24', optionally with '-planar'").ThrowAsJavaScriptException();
+                return false;
+            }
+            if (!outputFormat.IsNativeLayout() && (pullMode || sharedMode))
+            {
+                Napi::Error::New(env, "outputFormat is only supported for callback delivery").ThrowAsJavaScriptException();
+                return false;
+            }
+            if (outputFormat.planar && queuePolicy == QueuePolicy::Coalesce)
+            {
+                Napi::Error::New(env, "planar outputFormat cannot be coalesced").ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+
+        // planar: true 时每块交给 JS 一个数组，每个声道一个 Float32Array
+        if (options.Has("planar") && options.Get("planar").ToBoolean().Value())
+        {
+            if (outputFormat.sample != SampleFormat::Float32 || pullMode || sharedMode)
+            {
+                Napi::Error::New(env, "planar delivery requires f32 samples and callback delivery").ThrowAsJavaScriptException();
+                return false;
+            }
+            if (queuePolicy == QueuePolicy::Coalesce)
+            {
+                Napi::Error::New(env, "planar outputFormat cannot be coalesced").ThrowAsJavaScriptException();
+                return false;
+            }
+            outputFormat.planar = true;
+            planarDelivery = true;
+        }
+        converter.SetFormat(outputFormat);
+
+        if (!ReadUint32Option(env, options, "sampleRate", 8000, outputSampleRate) ||
+            !ReadUint32Option(env, options, "channels", 1, outputChannels))
+        {
+            return false;
+        }
+        if (outputSampleRate > 384000 || outputChannels > kChannels)
+        {
+            Napi::Error::New(env, "sampleRate must be <= 384000 and channels must be 1 or 2").ThrowAsJavaScriptException();
+            return false;
+        }
+        customFormat = options.Has("sampleRate") || options.Has("channels");
+        if (customFormat && (pullMode || sharedMode))
+        {
+            Napi::Error::New(env, "sampleRate/channels are only supported for callback delivery").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        if (options.Has("file") && !ParseFileOption(env, options.Get("file")))
+        {
+            return false;
+        }
+        if (hasFile && (pullMode || sharedMode))
+        {
+            Napi::Error::New(env, "file is only supported for callback delivery").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        if (options.Has("encoder") && !ParseEncoderOption(env, options.Get("encoder")))
+        {
+            return false;
+        }
+        if (hasEncoder)
+        {
+            if (pullMode || sharedMode)
+            {
+                Napi::Error::New(env, "encoder is only supported for callback delivery").ThrowAsJavaScriptException();
+                return false;
+            }
+            if (!outputFormat.IsNativeLayout())
+            {
+                Napi::Error::New(env, "encoder cannot be combined with outputFormat").ThrowAsJavaScriptException();
+                return false;
+            }
+            if (queuePolicy == QueuePolicy::Coalesce)
+            {
+                Napi::Error::New(env, "encoded packets cannot be coalesced").ThrowAsJavaScriptException();
+                return false;
+            }
+#if defined(__APPLE__)
+            // Opus 只支持 8/12/16/24/48 kHz：未指定 sampleRate 时由重采样器转换为 48 kHz
+            if (encoderOptions.codec == Codec::Opus)
+            {
+                if (outputSampleRate == 0)
+                {
+                    outputSampleRate = kOpusSampleRate;
+                }
+                else if (outputSampleRate != 8000 && outputSampleRate != 12000 && outputSampleRate != 16000 &&
+                         outputSampleRate != 24000 && outputSampleRate != 48000)
+                {
+                    Napi::Error::New(env, "encoder 'opus' requires sampleRate 8000, 12000, 16000, 24000 or 48000").ThrowAsJavaScriptException();
+                    return false;
+                }
+            }
+#endif
+        }
+
+        if (options.Has("meter") && !ParseMeterOption(env, options.Get("meter")))
+        {
+            return false;
+        }
+        if (options.Has("gate") && !ParseGateOption(env, options.Get("gate")))
+        {
+            return false;
+        }
+        if (hasGate && (pullMode || sharedMode))
+        {
+            Napi::Error::New(env, "gate is only supported for callback and file delivery").ThrowAsJavaScriptException();
+            return false;
+        }
+        if (hasMeter && (pullMode || sharedMode))
+        {
+            Napi::Error::New(env, "meter is only supported for callback delivery").ThrowAsJavaScriptException();
+            return false;
+        }
+        if (options.Has("processors") && !ParseProcessors(env, options.Get("processors"), processorSpecs))
+        {
+            return false;
+        }
+        if (!processorSpecs.empty() && (pullMode || sharedMode))
+        {
+            Napi::Error::New(env, "processors are only supported for callback and file delivery").ThrowAsJavaScriptException();
+            return false;
+        }
+        if (options.Has("history") && !ParseHistoryOption(env, options.Get("history")))
+        {
+            return false;
+        }
+        if (historySeconds > 0 && (pullMode || sharedMode))
+        {
+            Napi::Error::New(env, "history is only supported for callback and file delivery").ThrowAsJavaScriptException();
+            return false;
+        }
+        if (options.Has("loudness"))
+        {
+            hasLoudness = options.Get("loudness").ToBoolean().Value();
+        }
+        if (hasLoudness && (pullMode || sharedMode))
+        {
+            Napi::Error::New(env, "loudness is only supported for callback and file delivery").ThrowAsJavaScriptException();
+            return false;
+        }
+        if (options.Has("microphone") && !ParseMicrophoneOption(env, options.Get("microphone")))
+        {
+            return false;
+        }
+        if (hasMicrophone && (pullMode || sharedMode))
+        {
+            Napi::Error::New(env, "microphone is only supported for callback and file delivery").ThrowAsJavaScriptException();
+            return false;
+        }
+        return true;
+    }
+
+    // sharedMemory: true（自动命名）或以 / 开头、不超过 30 个字符的共享内存名
+    bool ParseSharedMemoryOption(Napi::Env env, Napi::Value value)
+    {
+        static std::atomic<uint32_t> segmentCounter{0};
+        if (value.IsBoolean())
+        {
+            if (value.As<Napi::Boolean>().Value())
+            {
+                sharedMemoryName = "/audiocap." + std::to_string(SharedMemorySegment::ProcessId()) + "." + std::to_string(segmentCounter.fetch_add(1));
+            }
+        }
+        else if (value.IsString())
+        {
+            sharedMemoryName = value.As<Napi::String>().Utf8Value();
+            if (sharedMemoryName.size() < 2 || sharedMemoryName.size() > 30 || sharedMemoryName[0] != '/' ||
+                sharedMemoryName.find('/', 1) != std::string::npos)
+            {
+                Napi::Error::New(env, "sharedMemory must start with '/', contain no other '/' and be at most 30 characters").ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+        else if (!value.IsUndefined() && !value.IsNull())
+        {
+            Napi::TypeError::New(env, "sharedMemory must be a boolean or a string").ThrowAsJavaScriptException();
+            return false;
+        }
+        if (!sharedMemoryName.empty())
+        {
+            sharedMode = true;
+        }
+        return true;
+    }
+
+    // 在命名共享内存中建立环形缓冲区并让 ring 指向它
+    bool CreateSharedMemoryRing(Napi::Env env)
+    {
+        uint32_t capacity = RingBuffer::RoundCapacity(ringFrames);
+        auto segment = std::make_unique<SharedMemorySegment>();
+        int error = segment->Create(sharedMemoryName, SharedRingLayout::Bytes(capacity, kChannels));
+        if (error != 0)
+        {
+            Napi::Error::New(env, "Failed to create shared memory " + sharedMemoryName + ": " + strerror(error)).ThrowAsJavaScriptException();
+            return false;
+        }
+
+        int32_t *headerData = segment->Header();
+        headerData[kSharedCapacityIndex] = static_cast<int32_t>(capacity);
+        headerData[kSharedChannelsIndex] = static_cast<int32_t>(kChannels);
+        headerData[kSharedSampleRateIndex] = static_cast<int32_t>(captureSampleRate);
+        ring.Attach(segment->Samples(), capacity, kChannels,
+                    reinterpret_cast<std::atomic<uint32_t> *>(headerData + kSharedWriteIndex),
+                    reinterpret_cast<std::atomic<uint32_t> *>(headerData + kSharedReadIndex));
+        reinterpret_cast<std::atomic<int32_t> *>(headerData + SharedRingLayout::kStateIndex)->store(1, std::memory_order_relaxed);
+        reinterpret_cast<std::atomic<int32_t> *>(headerData + SharedRingLayout::kMagicIndex)->store(SharedRingLayout::kMagic, std::memory_order_release);
+
+        Napi::Object shared = Napi::Object::New(env);
+        shared.Set("name", Napi::String::New(env, sharedMemoryName));
+        shared.Set("capacity", Napi::Number::New(env, capacity));
+        shared.Set("channels", Napi::Number::New(env, kChannels));
+        shared.Set("sampleRate", Napi::Number::New(env, captureSampleRate));
+        sharedRing = Napi::Persistent(shared);
+        sharedMemory = std::move(segment);
+        return true;
+    }
+
+    // 在 SharedArrayBuffer 中建立环形缓冲区并让 ring 指向它
+    bool CreateSharedRing(Napi::Env env)
+    {
+        if (!sharedMemoryName.empty())
+        {
+            return CreateSharedMemoryRing(env);
+        }
+
+        Napi::Value sharedArrayBuffer = env.Global().Get("SharedArrayBuffer");
+        if (!sharedArrayBuffer.IsFunction())
+        {
+            Napi::Error::New(env, "SharedArrayBuffer is not available").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        uint32_t capacity = RingBuffer::RoundCapacity(ringFrames);
+        size_t sampleCount = static_cast<size_t>(capacity) * kChannels;
+        Napi::Object buffer = sharedArrayBuffer.As<Napi::Function>().New(
+            {Napi::Number::New(env, static_cast<double>(kSharedHeaderBytes + sampleCount * sizeof(float)))});
+        Napi::Object header = env.Global().Get("Int32Array").As<Napi::Function>().New(
+            {buffer, Napi::Number::New(env, 0), Napi::Number::New(env, kSharedHeaderInts)});
+        Napi::Object samples = env.Global().Get("Float32Array").As<Napi::Function>().New(
+            {buffer, Napi::Number::New(env, kSharedHeaderBytes), Napi::Number::New(env, static_cast<double>(sampleCount))});
+        if (env.IsExceptionPending())
+        {
+            return false;
+        }
+
+        int32_t *headerData = Napi::Int32Array(env, header).Data();
+        float *sampleData = Napi::Float32Array(env, samples).Data();
+        if (!headerData || !sampleData)
+        {
+            Napi::Error::New(env, "SharedArrayBuffer views are not supported by this runtime").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        headerData[kSharedCapacityIndex] = static_cast<int32_t>(capacity);
+        headerData[kSharedChannelsIndex] = static_cast<int32_t>(kChannels);
+        headerData[kSharedSampleRateIndex] = static_cast<int32_t>(captureSampleRate);
+        ring.Attach(sampleData, capacity, kChannels,
+                    reinterpret_cast<std::atomic<uint32_t> *>(headerData + kSharedWriteIndex),
+                    reinterpret_cast<std::atomic<uint32_t> *>(headerData + kSharedReadIndex));
+
+        Napi::Object shared = Napi::Object::New(env);
+        shared.Set("buffer", buffer);
+        shared.Set("header", header);
+        shared.Set("samples", samples);
+        shared.Set("writeIndex", Napi::Number::New(env, kSharedWriteIndex));
+        shared.Set("readIndex", Napi::Number::New(env, kSharedReadIndex));
+        shared.Set("capacity", Napi::Number::New(env, capacity));
+        shared.Set("channels", Napi::Number::New(env, kChannels));
+        shared.Set("sampleRate", Napi::Number::New(env, captureSampleRate));
+        sharedRing = Napi::Persistent(shared);
+        return true;
+    }
+
+    // 解析 prepare/startCapture 的参数：(callback[, options]) 或拉取模式下的 ({ pull: true, ... })。
+    // 只在 JS 线程上运行，失败时留下待处理的异常
+    bool ParseStartArguments(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        Napi::Function callback;
+        Napi::Value optionsValue = env.Undefined();
+        if (info.Length() > 0 && info[0].IsFunction())
+        {
+            callback = info[0].As<Napi::Function>();
+            if (info.Length() > 1)
+            {
+                optionsValue = info[1];
+            }
+        }
+        else if (info.Length() > 0 && info[0].IsObject())
+        {
+            optionsValue = info[0];
+        }
+
+        if (!ParseOptions(env, optionsValue))
+        {
+            return false;
+        }
+
+        hasCallback = !callback.IsEmpty();
+        if (!pullMode && !sharedMode && !hasFile && !hasMeter && !hasCallback)
+        {
+            Napi::Error::New(env, "Callback function required").ThrowAsJavaScriptException();
+            return false;
+        }
+        if (hasEncoder && !hasCallback)
+        {
+            Napi::Error::New(env, "encoder requires a callback").ThrowAsJavaScriptException();
+            return false;
+        }
+        if (sharedMode && sharedMemoryName.empty() && !env.Global().Get("SharedArrayBuffer").IsFunction())
+        {
+            Napi::Error::New(env, "SharedArrayBuffer is not available").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        // 拉取/共享/纯写文件/纯分析模式没有数据回调，共享的 ThreadSafeFunction 只用来唤醒等待中的异步读取
+        if (hasCallback)
+        {
+            dataCallback = Napi::Persistent(callback);
+        }
+        else
+        {
+            dataCallback.Reset();
+        }
+        return true;
+    }
+
+    // 工作线程：释放准备到一半的资源
+    void DiscardPrepared()
+    {
+        source->Close();
+        preparedHistory.reset();
+        preparedMicrophone.reset();
+        if (preparedFile)
+        {
+            preparedFile->Close();
+            preparedFile.reset();
+        }
+#if defined(__APPLE__)
+        if (preparedEncoder)
+        {
+            preparedEncoder->Close();
+            preparedEncoder.reset();
+        }
+#endif
+    }
+
+    // 工作线程：打开采集后端（设备、tap），创建文件/编码器，不启动 IO。
+    // 只访问 JS 线程在准备期间不会触碰的状态；失败时释放已创建的资源并返回错误信息
+    std::string PrepareUnit(bool startAfter)
+    {
+        // macOS 上指定了 sampleRate/channels 时按设备实际采样率采集，由本地重采样器和混音转换，
+        // 否则保持原来的行为，由 CoreAudio 隐式转换为 44.1kHz
+        sourceOptions.sampleRate = deviceSampleRate;
+#if defined(__APPLE__)
+        if (sourceOptions.sampleRate == 0 && !customFormat)
+        {
+            sourceOptions.sampleRate = kSampleRate;
+        }
+#endif
+
+        // JS 线程接管前 IO 回调不写环形缓冲区
+        ringReady.store(false, std::memory_order_relaxed);
+        std::string sourceError = source->Open(sourceOptions, SourceCallback, this);
+        if (!sourceError.empty())
+        {
+            return sourceError;
+        }
+        captureSampleRate = source->SampleRate();
+        double deviceRate = source->DeviceSampleRate() > 0 ? source->DeviceSampleRate() : captureSampleRate;
+
+        // IO 回调的时间戳以设备采样率计；先调用一次 HostTimeNs，避免在实时线程上初始化时基
+        health->Reset(deviceRate);
+        HostTimeNs();
+        timestamps.Reset(captureSampleRate, deviceRate);
+        capturedFrames = 0;
+        ringWrittenFrames = 0;
+        ringReadFrames = 0;
+
+        uint32_t targetRate = outputSampleRate > 0 ? outputSampleRate : static_cast<uint32_t>(captureSampleRate);
+        if (!resampler.Configure(static_cast<uint32_t>(captureSampleRate), targetRate, outputChannels))
+        {
+            DiscardPrepared();
+            return "Unsupported sample rate conversion";
+        }
+
+        // chunkFrames 以输出帧计，换算成采集端帧数
+        if (chunkFrames > 0 && targetRate != static_cast<uint32_t>(captureSampleRate))
+        {
+            chunkFrames = static_cast<uint32_t>(std::ceil(chunkFrames * captureSampleRate / targetRate));
+        }
+
+        if (hasFile)
+        {
+            preparedFile = std::make_unique<FileWriter>();
+            int error = preparedFile->Open(fileOptions, targetRate, outputChannels);
+            if (error != 0)
+            {
+                preparedFile.reset();
+                DiscardPrepared();
+                return "Failed to open " + fileOptions.path + ": " + strerror(error);
+            }
+        }
+
+        // 历史可能有数百 MB，在工作线程上分配
+        if (historySeconds > 0)
+        {
+            preparedHistory = std::make_shared<HistoryBuffer>(historySeconds, static_cast<uint32_t>(captureSampleRate), kChannels, historySample);
+        }
+
+        if (hasMicrophone)
+        {
+            preparedMicrophone = std::make_unique<InputStream>();
+            std::string micError = preparedMicrophone->Open(microphoneDevice, kMicrophoneRingSeconds, MicrophoneNotify, this);
+            if (!micError.empty())
+            {
+                DiscardPrepared();
+                return micError;
+            }
+        }
+
+#if defined(__APPLE__)
+        if (hasEncoder)
+        {
+            preparedEncoder = std::make_unique<AudioEncoder>();
+            OSStatus encoderStatus = preparedEncoder->Open(encoderOptions, targetRate, outputChannels,
+                                                           [this](const uint8_t *data, size_t size, int64_t pts, uint32_t frames, uint64_t hostTimeNs)
+                                                           {
+                                                               DeliverPacket(data, size, pts, frames, hostTimeNs);
+                                                           });
+            if (encoderStatus != noErr)
+            {
+                preparedEncoder.reset();
+                DiscardPrepared();
+                return "Failed to create encoder (OSStatus " + std::to_string(encoderStatus) + ")";
+            }
+        }
+#endif
+
+        // 环形缓冲区至少能容纳两块数据或最大延迟对应的帧数
+        uint32_t latencyFrames = static_cast<uint32_t>(maxLatencyMs * captureSampleRate / 1000);
+        uint32_t batchFrames = chunkFrames > latencyFrames ? chunkFrames : latencyFrames;
+        // 大缓冲区（批量录制）时一个 IO 周期可能超过 kMaxFramesPerSlice，环形缓冲区也要相应加大
+        maxFramesPerSlice = std::max({kMaxFramesPerSlice, sourceOptions.bufferFrames, source->BufferFrames()});
+        if (ringFrames < batchFrames * 2 + maxFramesPerSlice * 2)
+        {
+            ringFrames = batchFrames * 2 + maxFramesPerSlice * 2;
+        }
+
+        if (hasGate)
+        {
+            gate.Configure(gateOptions, static_cast<uint32_t>(captureSampleRate), kChannels);
+        }
+
+        if (hasMeter)
+        {
+            meter.Configure(static_cast<uint32_t>(captureSampleRate), kChannels, meterRateHz, meterBands, meterFftSize);
+        }
+
+        if (hasLoudness)
+        {
+            loudness.Configure(captureSampleRate, kChannels);
+        }
+
+        // 池中数据块按单次投递的最大帧数定长分配：一块数据、一个 IO 周期或静音门的 pre-roll，
+        // 重采样可能多出几帧
+        maxDeliverFrames = batchFrames > maxFramesPerSlice ? batchFrames : maxFramesPerSlice;
+        if (hasGate && gateOptions.mode == GateMode::Suppress)
+        {
+            uint32_t preRollFrames = static_cast<uint32_t>(static_cast<uint64_t>(gateOptions.preRollMs) * static_cast<uint64_t>(captureSampleRate) / 1000);
+            maxDeliverFrames = preRollFrames > maxDeliverFrames ? preRollFrames : maxDeliverFrames;
+        }
+        // 麦克风的对齐缓冲区同样按单次投递的最大帧数分配，投递线程上不再分配
+        if (hasMicrophone)
+        {
+            microphoneBuffer.assign(static_cast<size_t>(maxDeliverFrames) * kChannels, 0.0f);
+        }
+        uint32_t outputFrames = static_cast<uint32_t>(static_cast<double>(maxDeliverFrames) * targetRate / captureSampleRate) + 16;
+        poolBlockBytes = converter.OutputBytes(outputFrames, outputChannels);
+        size_t nativeBytes = static_cast<size_t>(maxDeliverFrames) * kChannels * sizeof(float);
+        if (nativeBytes > poolBlockBytes)
+        {
+            poolBlockBytes = nativeBytes;
+        }
+#if defined(__APPLE__)
+        if (preparedEncoder && preparedEncoder->MaxPacketBytes() > poolBlockBytes)
+        {
+            poolBlockBytes = preparedEncoder->MaxPacketBytes();
+        }
+#endif
+        poolBlocks = (maxQueue > 0 ? maxQueue : kUnboundedQueueBlocks) + kSpareBlocks;
+
+        // startCapture()：启动也可能阻塞较久，同样留在工作线程上
+        if (startAfter)
+        {
+            std::string startError = StartDevices(preparedMicrophone.get());
+            if (!startError.empty())
+            {
+                DiscardPrepared();
+                return startError;
+            }
+        }
+        return std::string();
+    }
+
+    // JS 线程：准备完成。接管文件/编码器、建立环形缓冲区和投递
+    void FinishPrepare(Napi::Env env, Napi::Promise::Deferred deferred, bool startAfter, const std::string &error)
+    {
+        busy = false;
+        if (!error.empty())
+        {
+            dataCallback.Reset();
+            deferred.Reject(Napi::Error::New(env, error).Value());
+            ResolveDisposeWaiters(env);
+            return;
+        }
+
+        // startCapture() 的采集已在工作线程上启动，之后的失败路径都要停止它
+        if (startAfter)
+        {
+            std::lock_guard<std::mutex> lock(unitMutex);
+            isCapturing = true;
+        }
+        fileWriter = std::move(preparedFile);
+#if defined(__APPLE__)
+        encoder = std::move(preparedEncoder);
+#endif
+        history = std::move(preparedHistory);
+        loudnessActive = hasLoudness;
+        microphone = std::move(preparedMicrophone);
+        if (microphone)
+        {
+            aligner.Configure(captureSampleRate, microphone->SampleRate(), microphone->Ring().Capacity(), microphoneOffsetMs);
+        }
+        if (pool->BlockCount() != poolBlocks || pool->BlockBytes() < poolBlockBytes)
+        {
+            // 仍被 JS 持有的旧数据块让旧池继续存活，归还时回到旧池
+            pool = std::make_shared<BufferPool>(poolBlocks, poolBlockBytes);
+        }
+        queue->Configure(maxQueue, queuePolicy);
+
+        overflowFrames.store(0, std::memory_order_relaxed);
+        if (sharedMode)
+        {
+            // 由 Worker 或其他进程消费，不需要投递线程
+            if (!CreateSharedRing(env))
+            {
+                Napi::Error exception = env.GetAndClearPendingException();
+                ReleaseUnit();
+                deferred.Reject(exception.Value());
+                ResolveDisposeWaiters(env);
+                return;
+            }
+        }
+        else
+        {
+            sharedRing.Reset();
+            ring.Allocate(ringFrames, kChannels);
+            batchPending = false;
+            InstallProcessors();
+            scheduler->StartServicing(this);
+            deliveryRunning.store(true, std::memory_order_release);
+            UpdateRealtime();
+        }
+        ringReady.store(true, std::memory_order_release);
+
+        scheduler->Activate(env);
+        isPrepared = true;
+        // 准备好期间持有 JS 对象，正在采集的实例不会被 GC 回收，析构时也就不需要释放管线
+        Ref();
+
+        // 未指定设备时跟随系统默认设备，准备好但未启动时也要跟随
+        source->FollowDevice(DeviceChanged);
+
+        // 准备期间已调用过 dispose()
+        if (disposeRequested)
+        {
+            deferred.Resolve(env.Undefined());
+            BeginDispose(env);
+            return;
+        }
+
+        deferred.Resolve(env.Undefined());
+    }
+
+    // prepare(...) / startCapture(...)：参数在 JS 线程上解析，打开设备等准备工作在工作线程上进行
+    Napi::Value BeginPrepare(const Napi::CallbackInfo &info, bool startAfter)
     {
-        AudioCapture *capture = static_cast<AudioCapture *>(inRefCon);
-        return capture->HandleAudioInput(ioActionFlags, inTimeStamp, inBusNumber, inNumberFrames);
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+        if (busy || isPrepared)
+        {
+            deferred.Reject(Napi::Error::New(env, startAfter ? "Already capturing" : "Already prepared").Value());
+            return deferred.Promise();
+        }
+
+        if (!ParseStartArguments(info))
+        {
+            deferred.Reject(env.GetAndClearPendingException().Value());
+            return deferred.Promise();
+        }
+
+        busy = true;
+        disposeRequested = false;
+        BackgroundWorker::Run(
+            env, Value(),
+            [this, startAfter]()
+            { return RunWork([this, startAfter]()
+                             { return PrepareUnit(startAfter); }); },
+            [this, deferred, startAfter](Napi::Env env, const std::string &error)
+            { FinishPrepare(env, deferred, startAfter, error); });
+        return deferred.Promise();
     }
 
-    struct AudioData
+    // prepare(callback[, options]) 或 prepare(options)：打开采集设备、分配缓冲区、
+    // 打开文件/编码器，但不启动 IO。参数与 startCapture 相同，返回 Promise
+    Napi::Value Prepare(const Napi::CallbackInfo &info)
     {
-        std::unique_ptr<uint8_t[]> data;
-        size_t size;
+        return BeginPrepare(info, false);
+    }
 
-        AudioData(size_t s) : size(s)
+    // 启动麦克风和采集后端，失败时不留下运行中的麦克风。返回错误信息
+    std::string StartDevices(InputStream *mic)
+    {
+        health->Resume();
+        std::string error = mic ? mic->Start() : std::string();
+        if (error.empty())
         {
-            data = std::make_unique<uint8_t[]>(s);
+            error = source->Start();
         }
-    };
+        if (!error.empty() && mic)
+        {
+            mic->Stop();
+        }
+        return error;
+    }
 
-    OSStatus HandleAudioInput(AudioUnitRenderActionFlags *ioActionFlags,
-                              const AudioTimeStamp *inTimeStamp,
-                              UInt32 inBusNumber,
-                              UInt32 inNumberFrames)
+    std::string StartUnit()
     {
-        // 准备音频缓冲区
-        AudioBufferList bufferList;
-        bufferList.mNumberBuffers = 1;
-        bufferList.mBuffers[0].mNumberChannels = 2;                // 立体声
-        bufferList.mBuffers[0].mDataByteSize = inNumberFrames * 4; // 2通道 * 2字节/采样
+        std::lock_guard<std::mutex> lock(unitMutex);
+        if (isCapturing)
+        {
+            return std::string();
+        }
+        std::string error = StartDevices(microphone.get());
+        if (error.empty())
+        {
+            isCapturing = true;
+        }
+        return error;
+    }
 
-        // 创建临时缓冲区
-        auto tempBuffer = std::make_unique<Float32[]>(inNumberFrames * 2);
-        bufferList.mBuffers[0].mData = tempBuffer.get();
+    // start()：只启动已准备好的采集，同步返回
+    Napi::Value Start(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
 
-        // 渲染音频数据
-        OSStatus status = AudioUnitRender(audioUnit,
-                                          ioActionFlags,
-                                          inTimeStamp,
-                                          inBusNumber,
-                                          inNumberFrames,
-                                          &bufferList);
+        if (!isPrepared || busy)
+        {
+            Napi::Error::New(env, busy ? "Capture is busy" : "Not prepared").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
 
-        if (status == noErr && tsfn)
+        std::string error = StartUnit();
+        if (!error.empty())
         {
-            // 创建持久化的音频数据
-            size_t bufferSize = inNumberFrames * 2 * sizeof(Float32);
-            auto audioData = std::make_shared<AudioData>(bufferSize);
-            memcpy(audioData->data.get(), tempBuffer.get(), bufferSize);
+            Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        }
+        return env.Undefined();
+    }
 
-            // 使用共享指针传递数据
-            auto callback = [audioData](Napi::Env env, Napi::Function jsCallback)
+    // 任意线程：停止采集，返回后 IO 回调不再运行
+    void StopUnit()
+    {
+        std::lock_guard<std::mutex> lock(unitMutex);
+        if (isCapturing)
+        {
+            source->Stop();
+            if (microphone)
             {
-                auto arrayBuffer = Napi::ArrayBuffer::New(
-                    env,
-                    audioData->data.get(),
-                    audioData->size);
-                jsCallback.Call({arrayBuffer});
-            };
+                microphone->Stop();
+            }
+            isCapturing = false;
+        }
+    }
 
-            tsfn.NonBlockingCall(callback);
+    // stop()：只停止采集，环形缓冲区中已有的数据照常投递，可以再次 start()。
+    // stop({ drain })：停止并在工作线程上释放整个管线，返回 Promise，之后需要重新 prepare()。
+    // drain 默认为 true：投递剩余的数据、写完文件、冲刷编码器，已排队的数据块都交给回调后才兑现；
+    // drain 为 false 时与 dispose() 相同
+    Napi::Value Stop(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (!info[0].IsObject())
+        {
+            StopUnit();
+            return env.Undefined();
         }
 
-        return status;
+        Napi::Object options = info[0].As<Napi::Object>();
+        bool drain = !options.Has("drain") || options.Get("drain").ToBoolean().Value();
+        if (busy || !isPrepared)
+        {
+            return Dispose(info);
+        }
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        disposeWaiters.push_back(deferred);
+        BeginDispose(env, drain);
+        return deferred.Promise();
     }
 
-public:
-    static Napi::Object Init(Napi::Env env, Napi::Object exports)
+    // startCapture(...) 等价于 prepare(...) 后 start()，返回 Promise
+    Napi::Value StartCapture(const Napi::CallbackInfo &info)
     {
-        Napi::Function func = DefineClass(env, "AudioCapture", {InstanceMethod("requestPermission", &AudioCapture::RequestPermission), InstanceMethod("startCapture", &AudioCapture::StartCapture), InstanceMethod("stopCapture", &AudioCapture::StopCapture)});
+        return BeginPrepare(info, true);
+    }
 
-        Napi::FunctionReference *constructor = new Napi::FunctionReference();
-        *constructor = Napi::Persistent(func);
-        env.SetInstanceData(constructor);
+    // 投递线程按设备的 IO 周期以 time-constraint 策略运行，并加入设备 IO 线程的 workgroup，
+    // 转换、分析等下游处理在繁忙的大小核机器上也能按时完成；IO 回调只做渲染和写环
+    void UpdateRealtime()
+    {
+        uint32_t frames = source->BufferFrames();
+        double rate = source->DeviceSampleRate();
+        if (frames == 0 || rate <= 0)
+        {
+            frames = kMaxFramesPerSlice;
+            rate = captureSampleRate;
+        }
+        scheduler->SetRealtime(this, static_cast<uint64_t>(frames * 1e9 / rate), source->Workgroup());
+    }
 
-        exports.Set("AudioCapture", func);
-        return exports;
+    // 后端的通知线程、IO 停止期间：默认设备切换或当前设备的采样率/流配置变化后已重新绑定。
+    // 交给回调的格式保持不变，下游的重采样器、环形缓冲区和投递线程都不受影响，
+    // 只需要按新设备更新时间戳的采样率和投递线程的周期
+    static void DeviceChanged(void *context, double deviceSampleRate)
+    {
+        AudioCapture *capture = static_cast<AudioCapture *>(context);
+        capture->health->Rebind(deviceSampleRate > 0 ? deviceSampleRate : capture->captureSampleRate);
+        if (capture->deliveryRunning.load(std::memory_order_acquire))
+        {
+            capture->UpdateRealtime();
+        }
     }
 
-    AudioCapture(const Napi::CallbackInfo &info)
-        : Napi::ObjectWrap<AudioCapture>(info),
-          isCapturing(false),
-          env_(info.Env()) {}
+    // 工作线程：停止并释放采集后端，关闭文件和编码器。drain 时先投递环形缓冲区中剩余的数据。
+    // 不涉及 JS 对象；ThreadSafeFunction 由 CompleteDispose 在 JS 线程释放
+    void ReleaseUnit(bool drain = false)
+    {
+        StopUnit();
+        // 返回后不会再有重新绑定在进行
+        source->Close();
+        if (microphone)
+        {
+            microphone->Close();
+        }
 
-    Napi::Value RequestPermission(const Napi::CallbackInfo &info)
+        // 返回后共享的投递线程不会再访问本实例
+        if (deliveryRunning.load(std::memory_order_acquire))
+        {
+            deliveryRunning.store(false, std::memory_order_release);
+            scheduler->StopServicing(this);
+        }
+
+        // 投递线程已不再访问本实例，由当前线程投递停止前不足一块的剩余数据
+        if (drain && !pullMode && !sharedMode)
+        {
+            uint32_t frames = ring.AvailableRead();
+            if (frames > 0)
+            {
+                DeliverFromRing(frames);
+            }
+        }
+
+        // IO 线程停止后通知消费端并移除共享内存段，已经映射的进程仍可读完剩余数据
+        if (sharedMemory)
+        {
+            reinterpret_cast<std::atomic<int32_t> *>(sharedMemory->Header() + SharedRingLayout::kStateIndex)->store(0, std::memory_order_release);
+            sharedMemory.reset();
+        }
+
+        // 投递线程不再服务本实例后再关闭文件，保证写完所有数据并回写最终头部
+        if (fileWriter)
+        {
+            fileWriter->Close();
+        }
+
+#if defined(__APPLE__)
+        // 冲刷编码器，最后的数据包要在释放线程安全函数之前投递
+        if (encoder)
+        {
+            encoder->Close();
+        }
+#endif
+    }
+
+    void ResolveDisposeWaiters(Napi::Env env)
+    {
+        disposeRequested = false;
+        std::vector<Napi::Promise::Deferred> waiters;
+        waiters.swap(disposeWaiters);
+        for (Napi::Promise::Deferred &waiter : waiters)
+        {
+            waiter.Resolve(env.Undefined());
+        }
+    }
+
+    // JS 线程：释放完成。drain 时先把已排队的数据块交给回调
+    void CompleteDispose(Napi::Env env, bool drain = false)
+    {
+        busy = false;
+        if (drain)
+        {
+            DrainQueue(env);
+        }
+        scheduler->Deactivate();
+
+        // 共享内存段已在 ReleaseUnit 中移除，描述它的 JS 对象在这里释放
+        if (!sharedMemoryName.empty())
+        {
+            sharedRing.Reset();
+        }
+
+        if (isPrepared)
+        {
+            isPrepared = false;
+            Unref();
+        }
+        readWaiting.store(false, std::memory_order_relaxed);
+        ResolvePendingReads(env);
+        ResolveDisposeWaiters(env);
+    }
+
+    void BeginDispose(Napi::Env env, bool drain = false)
+    {
+        busy = true;
+        disposeRequested = false;
+        BackgroundWorker::Run(
+            env, Value(),
+            [this, drain]()
+            {
+                return RunWork([this, drain]()
+                               {
+                    ReleaseUnit(drain);
+                    return std::string(); });
+            },
+            [this, drain](Napi::Env env, const std::string &)
+            { CompleteDispose(env, drain); });
+    }
+
+    // dispose()：在工作线程上停止并释放采集设备和整个投递管线，之后需要重新 prepare()。
+    // 准备或释放正在进行时，返回的 Promise 在其后的释放完成时兑现
+    Napi::Value Dispose(const Napi::CallbackInfo &info)
     {
         Napi::Env env = info.Env();
-        return Napi::Boolean::New(env, true);
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+        if (busy)
+        {
+            if (!isPrepared)
+            {
+                disposeRequested = true;
+            }
+            disposeWaiters.push_back(deferred);
+            return deferred.Promise();
+        }
+        if (!isPrepared)
+        {
+            deferred.Resolve(env.Undefined());
+            return deferred.Promise();
+        }
+
+        disposeWaiters.push_back(deferred);
+        BeginDispose(env);
+        return deferred.Promise();
     }
 
-    Napi::Value StartCapture(const Napi::CallbackInfo &info)
+    // stopCapture() 等价于 stop() 后 dispose()，返回 Promise
+    Napi::Value StopCapture(const Napi::CallbackInfo &info)
+    {
+        return Dispose(info);
+    }
+
+    // 拉取模式：把环形缓冲区中已有的数据复制到调用方的 Float32Array，返回帧数
+    Napi::Value Read(const Napi::CallbackInfo &info)
     {
         Napi::Env env = info.Env();
 
-        if (isCapturing)
+        if (info.Length() < 1 || !info[0].IsTypedArray() ||
+            info[0].As<Napi::TypedArray>().TypedArrayType() != napi_float32_array)
         {
-            Napi::Error::New(env, "Already capturing").ThrowAsJavaScriptException();
+            Napi::TypeError::New(env, "Float32Array required").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
-        if (info.Length() < 1 || !info[0].IsFunction())
+        if (!pullMode)
         {
-            Napi::Error::New(env, "Callback function required").ThrowAsJavaScriptException();
+            Napi::Error::New(env, "read() requires pull mode").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
-        // 创建线程安全的函数回调
-        tsfn = Napi::ThreadSafeFunction::New(
-            env,
-            info[0].As<Napi::Function>(),
-            "AudioCallback",
-            0,
-            1,
-            [](Napi::Env)
-            {
-                // Finalizer callback
-            });
+        Napi::Float32Array target = info[0].As<Napi::Float32Array>();
+        uint32_t frames = static_cast<uint32_t>(target.ElementLength() / kChannels);
+        return Napi::Number::New(env, ring.Read(target.Data(), frames));
+    }
 
-        // 获取系统默认输出设备
-        UInt32 propertySize = sizeof(AudioDeviceID);
-        AudioObjectPropertyAddress propertyAddress = {
-            kAudioHardwarePropertyDefaultOutputDevice,
-            kAudioObjectPropertyScopeGlobal,
-            kAudioObjectPropertyElementMain};
+    // sharedMemory 模式下返回 { name, capacity, channels, sampleRate }，name 交给渲染进程的
+    // new SharedMemoryReader(name)，读出数据不经过 IPC。
+    // 共享模式下返回 { buffer, header, samples, writeIndex, readIndex, capacity, channels, sampleRate }。
+    // buffer 可直接 postMessage 给 Worker。读写位置是按 2^32 回绕的帧计数，
+    // 消费者用 Atomics.load(header, writeIndex) >>> 0 取得写位置，消费后用
+    // Atomics.store(header, readIndex, pos) 发布读位置。native 端无法调用
+    // Atomics.notify，等待新数据时 Atomics.wait(header, writeIndex, last, timeout) 必须带超时。
+    Napi::Value GetSharedBuffer(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (sharedRing.IsEmpty())
+        {
+            return env.Undefined();
+        }
+        return sharedRing.Value();
+    }
 
-        OSStatus status = AudioObjectGetPropertyData(kAudioObjectSystemObject,
-                                                     &propertyAddress,
-                                                     0,
-                                                     NULL,
-                                                     &propertySize,
-                                                     &outputDevice);
+    // for await (const chunk of capture)：每次产出一个 Float32Array，dispose() 后结束
+    Napi::Value AsyncIterator(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        Napi::Object iterator = Napi::Object::New(env);
+        iterator.Set("capture", info.This());
+        iterator.Set("next", Napi::Function::New(env, [](const Napi::CallbackInfo &info) -> Napi::Value
+                                                 {
+            Napi::Env env = info.Env();
+            Napi::Value capture = info.This().IsObject() ? info.This().As<Napi::Object>().Get("capture") : env.Undefined();
+            AudioCapture *self = capture.IsObject() ? AudioCapture::Unwrap(capture.As<Napi::Object>()) : nullptr;
+            if (!self)
+            {
+                Napi::TypeError::New(env, "Invalid iterator").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            return self->NextChunk(env); }));
+        iterator.Set("return", Napi::Function::New(env, [](const Napi::CallbackInfo &info) -> Napi::Value
+                                                   {
+            Napi::Env env = info.Env();
+            Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+            deferred.Resolve(IteratorResult(env, env.Undefined(), true));
+            return deferred.Promise(); }));
+        return iterator;
+    }
 
-        if (status != noErr)
+    // 返回 { codec, sampleRate, channels, bitrate, framesPerPacket, primingFrames, remainderFrames, adts, magicCookie }，
+    // magicCookie 为解码器配置（AAC 的 AudioSpecificConfig）；primingFrames 为开头的预滚帧数，
+    // 数据包的 pts 已减去这部分。未启用编码（或不是 macOS）时返回 undefined
+    Napi::Value GetEncoderConfig(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+#if !defined(__APPLE__)
+        return env.Undefined();
+#else
+        if (!encoder)
         {
-            Napi::Error::New(env, "Failed to get default output device").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
-        // 设置音频组件描述
-        AudioComponentDescription desc;
-        desc.componentType = kAudioUnitType_Output;
-        desc.componentSubType = kAudioUnitSubType_HALOutput;
-        desc.componentManufacturer = kAudioUnitManufacturer_Apple;
-        desc.componentFlags = 0;
-        desc.componentFlagsMask = 0;
+        const std::vector<uint8_t> &cookie = encoder->MagicCookie();
+        Napi::ArrayBuffer magicCookie = Napi::ArrayBuffer::New(env, cookie.size());
+        if (!cookie.empty())
+        {
+            memcpy(magicCookie.Data(), cookie.data(), cookie.size());
+        }
 
-        // 创建音频单元
-        AudioComponent component = AudioComponentFindNext(NULL, &desc);
-        status = AudioComponentInstanceNew(component, &audioUnit);
+        Napi::Object config = Napi::Object::New(env);
+        config.Set("codec", Napi::String::New(env, encoder->Options().codec == Codec::Aac ? "aac" : "opus"));
+        config.Set("sampleRate", Napi::Number::New(env, encoder->SampleRate()));
+        config.Set("channels", Napi::Number::New(env, encoder->Channels()));
+        config.Set("bitrate", Napi::Number::New(env, encoder->Options().bitrate));
+        config.Set("framesPerPacket", Napi::Number::New(env, encoder->FramesPerPacket()));
+        config.Set("primingFrames", Napi::Number::New(env, encoder->PrimingFrames()));
+        config.Set("remainderFrames", Napi::Number::New(env, encoder->RemainderFrames()));
+        config.Set("adts", Napi::Boolean::New(env, encoder->Options().adts));
+        config.Set("magicCookie", magicCookie);
+        return config;
+#endif
+    }
 
-        if (status != noErr)
+    // setProcessors(processors)：设置投递前的原生处理链，格式同 startCapture 的 processors 选项，空数组清除。
+    // 采集进行中调用时从下一块数据开始生效，各级的滤波器和增益状态重新开始
+    Napi::Value SetProcessors(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        std::vector<ProcessorSpec> specs;
+        if (!ParseProcessors(env, info[0], specs))
+        {
+            return env.Undefined();
+        }
+        if (!specs.empty() && (busy || isPrepared) && (pullMode || sharedMode))
         {
-            Napi::Error::New(env, "Failed to create audio unit").ThrowAsJavaScriptException();
+            Napi::Error::New(env, "processors are only supported for callback and file delivery").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
-        // 禁用输出
-        UInt32 enableIO = 0;
-        status = AudioUnitSetProperty(audioUnit,
-                                      kAudioOutputUnitProperty_EnableIO,
-                                      kAudioUnitScope_Output,
-                                      0,
-                                      &enableIO,
-                                      sizeof(enableIO));
-
-        // 启用输入
-        enableIO = 1;
-        status = AudioUnitSetProperty(audioUnit,
-                                      kAudioOutputUnitProperty_EnableIO,
-                                      kAudioUnitScope_Input,
-                                      1,
-                                      &enableIO,
-                                      sizeof(enableIO));
-
-        // 设置设备
-        status = AudioUnitSetProperty(audioUnit,
-                                      kAudioOutputUnitProperty_CurrentDevice,
-                                      kAudioUnitScope_Global,
-                                      0,
-                                      &outputDevice,
-                                      sizeof(AudioDeviceID));
-
-        // 设置流格式
-        AudioStreamBasicDescription streamFormat;
-        streamFormat.mSampleRate = 44100;
-        streamFormat.mFormatID = kAudioFormatLinearPCM;
-        streamFormat.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
-        streamFormat.mFramesPerPacket = 1;
-        streamFormat.mChannelsPerFrame = 2;
-        streamFormat.mBitsPerChannel = 32;
-        streamFormat.mBytesPerPacket = streamFormat.mChannelsPerFrame * sizeof(Float32);
-        streamFormat.mBytesPerFrame = streamFormat.mBytesPerPacket;
-
-        status = AudioUnitSetProperty(audioUnit,
-                                      kAudioUnitProperty_StreamFormat,
-                                      kAudioUnitScope_Output,
-                                      1,
-                                      &streamFormat,
-                                      sizeof(streamFormat));
-
-        // 设置回调
-        AURenderCallbackStruct callbackStruct;
-        callbackStruct.inputProc = AudioInputCallback;
-        callbackStruct.inputProcRefCon = this;
-
-        status = AudioUnitSetProperty(audioUnit,
-                                      kAudioOutputUnitProperty_SetInputCallback,
-                                      kAudioUnitScope_Global,
-                                      0,
-                                      &callbackStruct,
-                                      sizeof(callbackStruct));
-
-        // 初始化并启动音频单元
-        status = AudioUnitInitialize(audioUnit);
-        status = AudioOutputUnitStart(audioUnit);
-
-        isCapturing = true;
+        processorSpecs = std::move(specs);
+        if (isPrepared && deliveryRunning.load(std::memory_order_acquire))
+        {
+            InstallProcessors();
+        }
         return env.Undefined();
     }
 
-    Napi::Value StopCapture(const Napi::CallbackInfo &info)
+    // snapshot(seconds[, path])：取出回溯缓冲区中最近 seconds 秒的数据，复制在工作线程上进行，不打断采集。
+    // 不给 path 时 resolve { data: Float32Array | Int16Array（交错）, frames, sampleRate, channels, frame, hostTime }；
+    // 给出 path 时写成 WAV（.caf 后缀写成 CAF），resolve { path, frames, sampleRate, channels, frame, hostTime }
+    Napi::Value Snapshot(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (!history)
+        {
+            Napi::Error::New(env, "snapshot requires the history option").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (!info[0].IsNumber() || !(info[0].As<Napi::Number>().DoubleValue() > 0))
+        {
+            Napi::TypeError::New(env, "seconds must be a positive number").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (!info[1].IsUndefined() && !info[1].IsString())
+        {
+            Napi::TypeError::New(env, "path must be a string").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        struct SnapshotResult
+        {
+            std::vector<uint8_t> bytes;
+            size_t frames = 0;
+            ChunkTime time;
+        };
+        std::shared_ptr<HistoryBuffer> snapshotSource = history;
+        double seconds = std::min(info[0].As<Napi::Number>().DoubleValue(), snapshotSource->CapacitySeconds());
+        size_t frames = static_cast<size_t>(seconds * snapshotSource->SampleRate());
+        FileWriterOptions options;
+        if (info[1].IsString())
+        {
+            options.path = info[1].As<Napi::String>().Utf8Value();
+            size_t dot = options.path.rfind('.');
+            options.container = dot != std::string::npos && options.path.compare(dot, std::string::npos, ".caf") == 0 ? FileContainer::Caf : FileContainer::Wav;
+            options.sample = snapshotSource->Sample();
+        }
+
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        auto result = std::make_shared<SnapshotResult>();
+        BackgroundWorker::Run(
+            env, info.This().As<Napi::Object>(),
+            [snapshotSource, frames, options, result]()
+            {
+                result->frames = snapshotSource->Snapshot(frames, result->bytes, result->time);
+                if (options.path.empty())
+                {
+                    return std::string();
+                }
+                FileWriter writer;
+                int error = writer.WriteComplete(options, snapshotSource->SampleRate(), snapshotSource->Channels(), result->bytes.data(), result->bytes.size());
+                result->bytes = std::vector<uint8_t>();
+                return error == 0 ? std::string() : "Failed to write " + options.path + ": " + strerror(error);
+            },
+            [deferred, snapshotSource, options, result](Napi::Env env, const std::string &error)
+            {
+                if (!error.empty())
+                {
+                    deferred.Reject(Napi::Error::New(env, error).Value());
+                    return;
+                }
+
+                Napi::Object snapshot = Napi::Object::New(env);
+                if (options.path.empty())
+                {
+                    // 数据直接交给 ArrayBuffer，回收时释放；不允许外部缓冲区时复制一次
+                    auto *bytes = new std::vector<uint8_t>(std::move(result->bytes));
+                    size_t samples = result->frames * snapshotSource->Channels();
+                    napi_value external;
+                    Napi::ArrayBuffer buffer;
+                    if (napi_create_external_arraybuffer(
+                            env, bytes->data(), bytes->size(),
+                            [](napi_env, void *, void *hint)
+                            { delete static_cast<std::vector<uint8_t> *>(hint); },
+                            bytes, &external) == napi_ok)
+                    {
+                        buffer = Napi::ArrayBuffer(env, external);
+                    }
+                    else
+                    {
+                        buffer = Napi::ArrayBuffer::New(env, bytes->size());
+                        memcpy(buffer.Data(), bytes->data(), bytes->size());
+                        delete bytes;
+                    }
+                    if (snapshotSource->Sample() == SampleFormat::Int16)
+                    {
+                        snapshot.Set("data", Napi::Int16Array::New(env, samples, buffer, 0));
+                    }
+                    else
+                    {
+                        snapshot.Set("data", Napi::Float32Array::New(env, samples, buffer, 0));
+                    }
+                }
+                else
+                {
+                    snapshot.Set("path", Napi::String::New(env, options.path));
+                }
+                snapshot.Set("frames", Napi::Number::New(env, static_cast<double>(result->frames)));
+                snapshot.Set("sampleRate", Napi::Number::New(env, snapshotSource->SampleRate()));
+                snapshot.Set("channels", Napi::Number::New(env, snapshotSource->Channels()));
+                snapshot.Set("frame", Napi::Number::New(env, static_cast<double>(result->time.frame)));
+                snapshot.Set("hostTime", Napi::Number::New(env, static_cast<double>(result->time.hostTimeNs)));
+                deferred.Resolve(snapshot);
+            });
+        return deferred.Promise();
+    }
+
+    // getLoudness()：{ momentary, shortTerm, integrated, maxMomentary, maxShortTerm（LUFS）, range（LU）,
+    //   truePeak（dBTP）, samplePeak（dBFS）, clippedSamples, duration（秒） }，尚无数据的项为 -Infinity。
+    // 只复制已有的统计，可以高频调用
+    Napi::Value GetLoudness(const Napi::CallbackInfo &info)
     {
         Napi::Env env = info.Env();
+        if (!loudnessActive)
+        {
+            Napi::Error::New(env, "getLoudness requires the loudness option").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        LoudnessMeter::Reading reading = loudness.Read();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("momentary", Napi::Number::New(env, reading.momentary));
+        result.Set("shortTerm", Napi::Number::New(env, reading.shortTerm));
+        result.Set("integrated", Napi::Number::New(env, reading.integrated));
+        result.Set("maxMomentary", Napi::Number::New(env, reading.maxMomentary));
+        result.Set("maxShortTerm", Napi::Number::New(env, reading.maxShortTerm));
+        result.Set("range", Napi::Number::New(env, reading.range));
+        result.Set("truePeak", Napi::Number::New(env, reading.truePeak));
+        result.Set("samplePeak", Napi::Number::New(env, reading.samplePeak));
+        result.Set("clippedSamples", Napi::Number::New(env, static_cast<double>(reading.clippedSamples)));
+        result.Set("duration", Napi::Number::New(env, reading.duration));
+        return result;
+    }
 
-        if (!isCapturing)
+    // 返回 { bufferFrames, deviceLatency, safetyOffset, streamLatency, totalFrames, sampleRate, totalMs }，
+    // 帧数都以设备采样率计；totalFrames 为采样到达 IO 回调前的输入延迟估计。未准备好时返回 undefined
+    Napi::Value GetLatency(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (!isPrepared)
         {
             return env.Undefined();
         }
 
-        if (audioUnit)
+        CaptureLatency frames = source->Latency();
+        uint32_t total = frames.bufferFrames + frames.deviceLatency + frames.safetyOffset + frames.streamLatency;
+        double rate = frames.sampleRate;
+
+        Napi::Object latency = Napi::Object::New(env);
+        latency.Set("bufferFrames", Napi::Number::New(env, frames.bufferFrames));
+        latency.Set("deviceLatency", Napi::Number::New(env, frames.deviceLatency));
+        latency.Set("safetyOffset", Napi::Number::New(env, frames.safetyOffset));
+        latency.Set("streamLatency", Napi::Number::New(env, frames.streamLatency));
+        latency.Set("totalFrames", Napi::Number::New(env, total));
+        latency.Set("sampleRate", Napi::Number::New(env, rate));
+        latency.Set("totalMs", Napi::Number::New(env, rate > 0 ? total * 1000.0 / rate : 0));
+        return latency;
+    }
+
+    // { count, meanUs, maxUs, p50Us, p99Us, buckets }，buckets[i] 为 [2^(i-1), 2^i) us 内的次数
+    static Napi::Object HistogramToObject(Napi::Env env, const LatencyHistogram &histogram)
+    {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("count", Napi::Number::New(env, static_cast<double>(histogram.Count())));
+        result.Set("meanUs", Napi::Number::New(env, histogram.MeanUs()));
+        result.Set("maxUs", Napi::Number::New(env, histogram.MaxUs()));
+        result.Set("p50Us", Napi::Number::New(env, histogram.PercentileUs(0.5)));
+        result.Set("p99Us", Napi::Number::New(env, histogram.PercentileUs(0.99)));
+        Napi::Array buckets = Napi::Array::New(env, LatencyHistogram::kBuckets);
+        for (size_t i = 0; i < LatencyHistogram::kBuckets; i++)
         {
-            AudioOutputUnitStop(audioUnit);
-            AudioUnitUninitialize(audioUnit);
-            AudioComponentInstanceDispose(audioUnit);
+            buckets.Set(static_cast<uint32_t>(i), Napi::Number::New(env, static_cast<double>(histogram.Bucket(i))));
         }
+        result.Set("buckets", buckets);
+        return result;
+    }
 
-        if (tsfn)
+    Napi::Value GetStats(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("droppedChunks", Napi::Number::New(env, static_cast<double>(queue->DroppedChunks() + pool->ExhaustedChunks())));
+        stats.Set("coalescedChunks", Napi::Number::New(env, static_cast<double>(queue->CoalescedChunks())));
+        stats.Set("queueDepth", Napi::Number::New(env, static_cast<double>(queue->Depth())));
+        stats.Set("poolBlocks", Napi::Number::New(env, static_cast<double>(pool->BlockCount())));
+        stats.Set("poolExhaustedChunks", Napi::Number::New(env, static_cast<double>(pool->ExhaustedChunks())));
+#if defined(AUDIO_CAPTURE_COUNT_ALLOCATIONS)
+        stats.Set("heapAllocations", Napi::Number::New(env, static_cast<double>(HeapAllocations())));
+#endif
+        if (fileWriter)
         {
-            tsfn.Release();
+            stats.Set("fileBytesWritten", Napi::Number::New(env, static_cast<double>(fileWriter->BytesWritten())));
+            stats.Set("fileOverflowFrames", Napi::Number::New(env, static_cast<double>(fileWriter->OverflowFrames())));
+            stats.Set("fileError", Napi::Number::New(env, fileWriter->LastError()));
         }
+#if defined(__APPLE__)
+        if (encoder)
+        {
+            stats.Set("encodedPackets", Napi::Number::New(env, static_cast<double>(encoder->PacketCount())));
+            stats.Set("encoderOverflowFrames", Napi::Number::New(env, static_cast<double>(encoder->OverflowFrames())));
+            stats.Set("encoderError", Napi::Number::New(env, encoder->LastError()));
+        }
+#endif
+        if (hasGate)
+        {
+            stats.Set("gateSuppressedFrames", Napi::Number::New(env, static_cast<double>(gate.SuppressedFrames())));
+            stats.Set("gateActivations", Napi::Number::New(env, static_cast<double>(gate.Activations())));
+        }
+        if (microphone)
+        {
+            stats.Set("microphoneDriftPpm", Napi::Number::New(env, aligner.DriftPpm()));
+            stats.Set("microphoneUnderrunFrames", Napi::Number::New(env, static_cast<double>(aligner.UnderrunFrames())));
+            stats.Set("microphoneResyncs", Napi::Number::New(env, static_cast<double>(aligner.Resyncs())));
+            stats.Set("microphoneOverflowFrames", Napi::Number::New(env, static_cast<double>(microphone->OverflowFrames())));
+        }
+        stats.Set("overflowFrames", Napi::Number::New(env, static_cast<double>(overflowFrames.load(std::memory_order_relaxed))));
 
-        isCapturing = false;
-        return env.Undefined();
+        stats.Set("ioCycles", Napi::Number::New(env, static_cast<double>(health->ioCycles.load())));
+        stats.Set("renderErrors", Napi::Number::New(env, static_cast<double>(health->renderErrors.load())));
+        stats.Set("lastRenderError", Napi::Number::New(env, health->lastRenderError.load()));
+        stats.Set("sampleTimeGaps", Napi::Number::New(env, static_cast<double>(health->sampleTimeGaps.load())));
+        stats.Set("queueFull", Napi::Number::New(env, static_cast<double>(health->queueFull.load())));
+        stats.Set("callFailures", Napi::Number::New(env, static_cast<double>(health->callFailures.load())));
+        stats.Set("deviceChanges", Napi::Number::New(env, static_cast<double>(health->deviceChanges.load())));
+        stats.Set("renderTime", HistogramToObject(env, health->renderTime));
+        stats.Set("deliveryLatency", HistogramToObject(env, health->deliveryLatency));
+        stats.Set("ioJitter", HistogramToObject(env, health->ioJitter));
+        return stats;
     }
 
     ~AudioCapture()
     {
-        if (isCapturing)
+        // 工作期间 BackgroundWorker 持有 JS 对象、准备好期间本实例持有自己，
+        // 因此 GC 析构时管线早已释放；环境退出时由 EnvCleanup 释放。这里不阻塞也不兑现 Promise
+        if (!shuttingDown)
         {
-            StopCapture(Napi::CallbackInfo(env_, nullptr));
+            napi_remove_env_cleanup_hook(env_, EnvCleanup, this);
         }
+        // 已排队的待办不再回调本实例
+        handle->client = nullptr;
     }
 };
 
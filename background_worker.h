@@ -0,0 +1,45 @@
+// background_worker.h
+#pragma once
+#include <napi.h>
+#include <functional>
+#include <string>
+
+// 在 libuv 工作线程上执行 work，完成后在 JS 线程调用 done(env, error)。
+// 持有 owner 的引用，使工作期间 JS 对象（及其 native 实例）不会被回收。
+class BackgroundWorker : public Napi::AsyncWorker
+{
+public:
+    using Work = std::function<std::string()>; // 返回错误信息，空字符串表示成功
+    using Done = std::function<void(Napi::Env, const std::string &)>;
+
+    BackgroundWorker(Napi::Env env, Napi::Object owner, Work work, Done done)
+        : Napi::AsyncWorker(env, "AudioCapture"),
+          owner(Napi::Persistent(owner)),
+          work(std::move(work)),
+          done(std::move(done))
+    {
+    }
+
+    // 创建并排队，完成后自动释放
+    static void Run(Napi::Env env, Napi::Object owner, Work work, Done done)
+    {
+        (new BackgroundWorker(env, owner, std::move(work), std::move(done)))->Queue();
+    }
+
+protected:
+    void Execute() override
+    {
+        error = work();
+    }
+
+    void OnOK() override
+    {
+        done(Env(), error);
+    }
+
+private:
+    Napi::ObjectReference owner;
+    Work work;
+    Done done;
+    std::string error;
+};
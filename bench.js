@@ -0,0 +1,186 @@
+// 采集管线的基准/长时间运行测试，不需要音频硬件和界面。
+// 用合成后端（audio_capture_bench.node）按设定的采样率和缓冲区大小驱动 IO 回调，
+// 经过与正式模块相同的环形缓冲区、成块、格式转换和投递。
+//
+//   node bench.js --duration 3600 --rate 48000 --buffer 128 --instances 4 --chunk 480
+//
+// 奇数且变化的帧数（单声道、48k → 44.1k 重采样）覆盖整数格式转换的尾部和抖动表回绕，建议在 ASan 构建下运行：
+//
+//   node bench.js --duration 30 --warmup 0 --rate 48000 --buffer 127 --sample-rate 44100 --channels 1 --output-format s16
+//
+// 每个统计周期输出一行 JSON；结束时如果超过 --max-rss-growth-mb、--max-render-p99-us、
+// --max-delivery-p99-us、--max-allocations-per-sec（预热后最差的周期）或出现丢帧/池耗尽，
+// 以非零状态退出，可以直接接到 CI。allocationsPerSec 为本模块 C++ 代码经 operator new 的堆分配，
+// 不包括 V8 的 JS 堆。
+const path = require("path");
+
+const { AudioCapture } = require(path.join(__dirname, "build/Release/audio_capture_bench.node"));
+
+function parseArgs(argv) {
+  const options = {
+    duration: 60,
+    interval: 5,
+    rate: 48000,
+    buffer: 512,
+    instances: 1,
+    chunk: 0,
+    maxLatencyMs: 0,
+    outputFormat: "f32",
+    sampleRate: 0,
+    channels: 2,
+    maxQueue: 0,
+    warmup: 5,
+    maxRssGrowthMb: Infinity,
+    maxRenderP99Us: Infinity,
+    maxDeliveryP99Us: Infinity,
+    maxAllocationsPerSec: Infinity,
+  };
+  const names = {
+    "--duration": "duration",
+    "--interval": "interval",
+    "--rate": "rate",
+    "--buffer": "buffer",
+    "--instances": "instances",
+    "--chunk": "chunk",
+    "--max-latency-ms": "maxLatencyMs",
+    "--output-format": "outputFormat",
+    "--sample-rate": "sampleRate",
+    "--channels": "channels",
+    "--max-queue": "maxQueue",
+    "--warmup": "warmup",
+    "--max-rss-growth-mb": "maxRssGrowthMb",
+    "--max-render-p99-us": "maxRenderP99Us",
+    "--max-delivery-p99-us": "maxDeliveryP99Us",
+    "--max-allocations-per-sec": "maxAllocationsPerSec",
+  };
+  for (let i = 2; i < argv.length; i += 2) {
+    const name = names[argv[i]];
+    if (!name || i + 1 >= argv.length) {
+      throw new Error(`Unknown or incomplete argument: ${argv[i]}`);
+    }
+    const value = argv[i + 1];
+    options[name] = name === "outputFormat" ? value : Number(value);
+  }
+  return options;
+}
+
+function captureOptions(options) {
+  const result = {
+    deviceSampleRate: options.rate,
+    bufferFrames: options.buffer,
+    outputFormat: options.outputFormat,
+    maxQueue: options.maxQueue,
+  };
+  if (options.chunk > 0) result.chunkFrames = options.chunk;
+  if (options.maxLatencyMs > 0) result.maxLatencyMs = options.maxLatencyMs;
+  if (options.sampleRate > 0) result.sampleRate = options.sampleRate;
+  if (options.channels !== 2) result.channels = options.channels;
+  return result;
+}
+
+// 所有实例的统计合并：计数相加，分位数取最差的实例。堆分配计数是整个模块的，只取一次
+function summarize(captures) {
+  const total = {
+    chunks: 0,
+    heapAllocations: 0,
+    droppedChunks: 0,
+    poolExhaustedChunks: 0,
+    overflowFrames: 0,
+    sampleTimeGaps: 0,
+    queueFull: 0,
+    renderP50Us: 0,
+    renderP99Us: 0,
+    renderMaxUs: 0,
+    deliveryP50Us: 0,
+    deliveryP99Us: 0,
+    deliveryMaxUs: 0,
+  };
+  for (const { capture, chunks } of captures) {
+    const stats = capture.getStats();
+    total.chunks += chunks;
+    total.heapAllocations = stats.heapAllocations;
+    total.droppedChunks += stats.droppedChunks;
+    total.poolExhaustedChunks += stats.poolExhaustedChunks;
+    total.overflowFrames += stats.overflowFrames;
+    total.sampleTimeGaps += stats.sampleTimeGaps;
+    total.queueFull += stats.queueFull;
+    total.renderP50Us = Math.max(total.renderP50Us, stats.renderTime.p50Us);
+    total.renderP99Us = Math.max(total.renderP99Us, stats.renderTime.p99Us);
+    total.renderMaxUs = Math.max(total.renderMaxUs, stats.renderTime.maxUs);
+    total.deliveryP50Us = Math.max(total.deliveryP50Us, stats.deliveryLatency.p50Us);
+    total.deliveryP99Us = Math.max(total.deliveryP99Us, stats.deliveryLatency.p99Us);
+    total.deliveryMaxUs = Math.max(total.deliveryMaxUs, stats.deliveryLatency.maxUs);
+  }
+  return total;
+}
+
+async function main() {
+  const options = parseArgs(process.argv);
+  const captures = [];
+  for (let i = 0; i < options.instances; i++) {
+    const entry = { capture: new AudioCapture(), chunks: 0 };
+    await entry.capture.startCapture(() => {
+      entry.chunks++;
+    }, captureOptions(options));
+    captures.push(entry);
+  }
+
+  const start = process.hrtime.bigint();
+  const elapsed = () => Number(process.hrtime.bigint() - start) / 1e9;
+  let baselineRss = 0;
+  let last = { time: 0, heapAllocations: summarize(captures).heapAllocations, chunks: 0 };
+  let report = null;
+  let worstAllocationsPerSec = 0;
+
+  await new Promise((resolve) => {
+    const timer = setInterval(() => {
+      const now = elapsed();
+      const total = summarize(captures);
+      const rss = process.memoryUsage().rss;
+      // 预热期内池和 JS 堆还在增长，RSS 基线从预热结束后开始计
+      if (!baselineRss && now >= options.warmup) baselineRss = rss;
+
+      const seconds = now - last.time;
+      report = {
+        elapsed: Math.round(now),
+        rssMb: +(rss / 1048576).toFixed(1),
+        rssGrowthMb: baselineRss ? +((rss - baselineRss) / 1048576).toFixed(1) : 0,
+        heapUsedMb: +(process.memoryUsage().heapUsed / 1048576).toFixed(1),
+        chunksPerSec: Math.round((total.chunks - last.chunks) / seconds),
+        allocationsPerSec: +((total.heapAllocations - last.heapAllocations) / seconds).toFixed(2),
+        ...total,
+      };
+      console.log(JSON.stringify(report));
+      if (baselineRss) worstAllocationsPerSec = Math.max(worstAllocationsPerSec, report.allocationsPerSec);
+      last = { time: now, heapAllocations: total.heapAllocations, chunks: total.chunks };
+
+      if (now >= options.duration) {
+        clearInterval(timer);
+        resolve();
+      }
+    }, options.interval * 1000);
+  });
+
+  for (const { capture } of captures) {
+    await capture.stopCapture();
+  }
+
+  const failures = [];
+  if (report.rssGrowthMb > options.maxRssGrowthMb) failures.push(`RSS grew ${report.rssGrowthMb} MB`);
+  if (report.renderP99Us > options.maxRenderP99Us) failures.push(`render p99 ${report.renderP99Us} us`);
+  if (report.deliveryP99Us > options.maxDeliveryP99Us) failures.push(`delivery p99 ${report.deliveryP99Us} us`);
+  if (worstAllocationsPerSec > options.maxAllocationsPerSec) failures.push(`${worstAllocationsPerSec} allocations/s`);
+  if (report.poolExhaustedChunks > 0) failures.push(`buffer pool exhausted ${report.poolExhaustedChunks} times`);
+  if (report.overflowFrames > 0 || report.droppedChunks > 0) {
+    failures.push(`dropped ${report.droppedChunks} chunks / ${report.overflowFrames} frames`);
+  }
+  if (failures.length > 0) {
+    console.error(`FAIL: ${failures.join(", ")}`);
+    process.exitCode = 1;
+  }
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exitCode = 1;
+});
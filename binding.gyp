@@ -3,7 +3,6 @@
     "target_name": "audio_capture",
     "cflags!": [ "-fno-exceptions" ],
     "cflags_cc!": [ "-fno-exceptions" ],
-    "sources": [ "audio_capture.cc" ],
     "include_dirs": [
       "<!@(node -p \"require('node-addon-api').include\")"
     ],
@@ -11,14 +10,81 @@
       "<!(node -p \"require('node-addon-api').gyp\")"
     ],
     "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS" ],
-    "xcode_settings": {
-      "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
-      "CLANG_CXX_LIBRARY": "libc++",
-      "MACOSX_DEPLOYMENT_TARGET": "10.15",
-      "OTHER_LDFLAGS": [
-        "-framework CoreAudio",
-        "-framework AudioToolbox"
-      ]
-    }
+    "conditions": [
+      ["OS=='mac'", {
+        "sources": [ "audio_capture.cc", "coreaudio_source.cc", "permission.mm", "process_tap.mm" ],
+        "xcode_settings": {
+          "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+          "CLANG_CXX_LIBRARY": "libc++",
+          "CLANG_ENABLE_OBJC_ARC": "YES",
+          "MACOSX_DEPLOYMENT_TARGET": "10.15",
+          "OTHER_LDFLAGS": [
+            "-framework Foundation",
+            "-framework AVFoundation",
+            "-framework CoreAudio",
+            "-framework AudioToolbox",
+            "-framework Accelerate"
+          ]
+        }
+      }],
+      ["OS=='win'", {
+        "sources": [ "audio_capture.cc", "wasapi_source.cc" ],
+        "defines": [ "NOMINMAX", "WIN32_LEAN_AND_MEAN" ],
+        "libraries": [ "ole32.lib", "avrt.lib" ],
+        "msvs_settings": {
+          "VCCLCompilerTool": {
+            "AdditionalOptions": [ "/std:c++17" ]
+          }
+        }
+      }],
+      ["OS=='linux'", {
+        "sources": [ "audio_capture.cc", "pipewire_source.cc" ],
+        "cflags_cc": [ "-std=c++17", "<!@(pkg-config --cflags libpipewire-0.3)" ],
+        "libraries": [ "<!@(pkg-config --libs libpipewire-0.3)" ]
+      }]
+    ]
+  }, {
+    "target_name": "audio_capture_bench",
+    "cflags!": [ "-fno-exceptions" ],
+    "cflags_cc!": [ "-fno-exceptions" ],
+    "sources": [ "audio_capture.cc", "synthetic_source.cc" ],
+    "include_dirs": [
+      "<!@(node -p \"require('node-addon-api').include\")"
+    ],
+    "dependencies": [
+      "<!(node -p \"require('node-addon-api').gyp\")"
+    ],
+    "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS", "AUDIO_CAPTURE_COUNT_ALLOCATIONS" ],
+    "conditions": [
+      ["OS=='mac'", {
+        "sources": [ "permission.mm" ],
+        "xcode_settings": {
+          "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+          "CLANG_CXX_LIBRARY": "libc++",
+          "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+          "CLANG_ENABLE_OBJC_ARC": "YES",
+          "MACOSX_DEPLOYMENT_TARGET": "10.15",
+          "OTHER_LDFLAGS": [
+            "-framework Foundation",
+            "-framework AVFoundation",
+            "-framework AudioToolbox",
+            "-framework Accelerate"
+          ]
+        }
+      }],
+      ["OS=='win'", {
+        "defines": [ "NOMINMAX", "WIN32_LEAN_AND_MEAN" ],
+        "libraries": [ "avrt.lib" ],
+        "msvs_settings": {
+          "VCCLCompilerTool": {
+            "AdditionalOptions": [ "/std:c++17" ]
+          }
+        }
+      }],
+      ["OS=='linux'", {
+        "cflags_cc": [ "-std=c++17" ],
+        "ldflags": [ "-Wl,-Bsymbolic-functions" ]
+      }]
+    ]
   }]
 }
\ No newline at end of file
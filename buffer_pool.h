@@ -0,0 +1,167 @@
+// buffer_pool.h
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "timestamps.h"
+
+class BufferPool;
+
+// 一块交给 JS 的音频数据，存储来自 BufferPool 并循环使用
+struct AudioData
+{
+    std::unique_ptr<uint8_t[]> data;
+    size_t size = 0;     // 有效字节数
+    size_t capacity = 0; // 存储容量
+
+    // PCM 数据块：time 为首帧时间，frames 为包含的帧数
+    // 编码后的数据包：pts 为包首帧在编码输入中的序号（预滚部分为负），frames 为包含的帧数，
+    // time.hostTimeNs 为该帧的主机时间
+    bool encoded = false;
+    int64_t pts = 0;
+    uint32_t frames = 0;
+    ChunkTime time;
+
+    // 启用静音门时为 true，active 表示本块是否有声
+    bool gated = false;
+    bool active = true;
+
+    // 非 0 时为平面 Float32 数据的声道数，交给 JS 时每个声道一个 Float32Array
+    uint32_t planarChannels = 0;
+
+    uint64_t enqueuedAt = 0; // 入队时刻（ns），用于统计投递延迟
+
+    // 借出期间持有所属的池，保证池比所有外部 ArrayBuffer 活得更久
+    std::shared_ptr<BufferPool> owner;
+
+    // 池内序号和空闲链表中的下一块
+    uint32_t poolIndex = 0;
+    std::atomic<uint32_t> poolNext{0};
+
+    explicit AudioData(size_t c) : data(std::make_unique<uint8_t[]>(c)), capacity(c) {}
+};
+
+// 固定容量的数据块池：所有块在构造时一次性分配，借出的块在 JS 的 ArrayBuffer 被回收
+// （finalizer）时归还。空闲链表是无锁栈，投递线程、编码线程和 JS 线程的 finalizer
+// 都不加锁；池耗尽时 Acquire 返回空句柄并计为丢弃，不会退回到分配内存。
+class BufferPool : public std::enable_shared_from_this<BufferPool>
+{
+private:
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+
+    std::vector<std::unique_ptr<AudioData>> blocks;
+    size_t blockBytes = 0;
+
+    // 高 32 位为版本号，低 32 位为栈顶块的序号，版本号避免 ABA
+    std::atomic<uint64_t> freeHead{kEmpty};
+    std::atomic<uint64_t> exhausted{0};
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "BufferPool needs a lock-free 64-bit atomic");
+
+    // 按 2 的幂取整
+    static size_t RoundUp(size_t size)
+    {
+        size_t c = 4096;
+        while (c < size)
+        {
+            c <<= 1;
+        }
+        return c;
+    }
+
+    AudioData *Pop()
+    {
+        uint64_t head = freeHead.load(std::memory_order_acquire);
+        for (;;)
+        {
+            uint32_t index = static_cast<uint32_t>(head);
+            if (index == kEmpty)
+            {
+                return nullptr;
+            }
+            uint32_t next = blocks[index]->poolNext.load(std::memory_order_relaxed);
+            uint64_t desired = (((head >> 32) + 1) << 32) | next;
+            if (freeHead.compare_exchange_weak(head, desired, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                return blocks[index].get();
+            }
+        }
+    }
+
+    void Push(AudioData *block)
+    {
+        uint64_t head = freeHead.load(std::memory_order_relaxed);
+        uint64_t desired;
+        do
+        {
+            block->poolNext.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            desired = (((head >> 32) + 1) << 32) | block->poolIndex;
+        } while (!freeHead.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+public:
+    struct Recycler
+    {
+        void operator()(AudioData *block) const
+        {
+            if (block->owner)
+            {
+                block->owner->Recycle(block);
+            }
+            else
+            {
+                delete block;
+            }
+        }
+    };
+    using Handle = std::unique_ptr<AudioData, Recycler>;
+
+    // 分配 count 块、每块至少 size 字节
+    BufferPool(size_t count = 0, size_t size = 0) : blockBytes(count > 0 ? RoundUp(size) : 0)
+    {
+        blocks.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            blocks.push_back(std::make_unique<AudioData>(blockBytes));
+            blocks.back()->poolIndex = static_cast<uint32_t>(i);
+            Push(blocks.back().get());
+        }
+    }
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // 池空或 size 超过块容量时返回空句柄
+    Handle Acquire(size_t size)
+    {
+        AudioData *block = size <= blockBytes ? Pop() : nullptr;
+        if (!block)
+        {
+            exhausted.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        block->size = size;
+        block->encoded = false;
+        block->pts = 0;
+        block->frames = 0;
+        block->time = ChunkTime();
+        block->gated = false;
+        block->active = true;
+        block->planarChannels = 0;
+        block->owner = shared_from_this();
+        return Handle(block);
+    }
+
+    void Recycle(AudioData *block)
+    {
+        // 最后一个借出的块归还时池可能随之析构，因此先取出引用，入栈后不再访问成员
+        std::shared_ptr<BufferPool> keepAlive = std::move(block->owner);
+        Push(block);
+    }
+
+    size_t BlockCount() const { return blocks.size(); }
+    size_t BlockBytes() const { return blockBytes; }
+    uint64_t ExhaustedChunks() const { return exhausted.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,107 @@
+// capture_source.h
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 采集后端接口：macOS 为 AUHAL（可选进程 tap），Windows 为 WASAPI，Linux 为 PipeWire，基准测试为合成信号。
+// 后端只负责把设备的数据以交错立体声 Float32 交给 CaptureCallback，
+// 环形缓冲区、成块、处理链、格式转换、写文件和投递都由 AudioCapture 负责，所有平台共用。
+// 同一接口也用于第二路输入（麦克风，input 为 true）。
+
+struct CaptureSourceOptions
+{
+    std::string device;        // 设备 id（enumerateDevices 返回的 id），空字符串表示系统默认设备
+    bool input = false;        // false：采集系统输出（环回/监听/虚拟声卡）；true：采集输入设备（麦克风）
+    uint32_t sampleRate = 0;   // 0 表示使用设备（混音格式）的采样率
+    uint32_t bufferFrames = 0; // 设备缓冲区帧数，0 表示使用系统默认值
+
+    // 仅 macOS：tap 为 true 时通过进程 tap + 私有聚合设备采集系统/进程音频（macOS 14.2+）
+    bool tap = false;
+    std::vector<int32_t> tapProcesses; // 进程 ID 列表
+    bool tapExclude = true;            // true：捕获除 tapProcesses 以外的所有进程；false：只捕获 tapProcesses
+    bool tapMute = false;              // 捕获期间让被捕获的进程不再从扬声器输出
+};
+
+// 一个 IO 周期首帧的时间
+struct CaptureSourceTime
+{
+    bool sampleTimeValid = false;
+    double sampleTime = 0;     // 设备时钟上的采样位置，以 DeviceSampleRate() 计
+    uint64_t hostTimeNs = 0;   // 与 HostTimeNs() 同一时钟，0 表示无效
+    uint64_t cycleStartNs = 0; // IO 回调开始的时间，非 0 时 renderTime 包括后端取数据的耗时
+    int32_t status = 0;        // 非 0 时本周期取数据失败（平台错误码），samples 为 nullptr
+};
+
+// 后端 IO 线程调用：samples 为交错立体声 Float32，不能分配内存或阻塞
+using CaptureCallback = void (*)(void *context, const float *samples, uint32_t frames, const CaptureSourceTime &time);
+// 后端在设备切换或格式变化时重新绑定，在自己的通知线程上、IO 停止期间调用，deviceSampleRate 为新设备的采样率
+using DeviceChangedCallback = void (*)(void *context, double deviceSampleRate);
+
+struct CaptureDeviceInfo
+{
+    std::string id;
+    std::string uid; // 平台的持久标识，没有时与 id 相同
+    std::string name;
+    std::string manufacturer;
+    uint32_t inputChannels = 0;
+    uint32_t outputChannels = 0;
+    double sampleRate = 0;
+    bool isDefaultInput = false;
+    bool isDefaultOutput = false;
+};
+
+// 输入延迟的估计，帧数以设备采样率计
+struct CaptureLatency
+{
+    uint32_t bufferFrames = 0;
+    uint32_t deviceLatency = 0;
+    uint32_t safetyOffset = 0;
+    uint32_t streamLatency = 0;
+    double sampleRate = 0;
+};
+
+class CaptureSource
+{
+public:
+    static constexpr uint32_t kChannels = 2;
+
+    virtual ~CaptureSource() = default;
+
+    // 工作线程：打开设备并协商格式，不启动 IO。失败时返回错误信息
+    virtual std::string Open(const CaptureSourceOptions &options, CaptureCallback callback, void *context) = 0;
+    // Open 成功后有效：交给 callback 的采样率
+    virtual uint32_t SampleRate() const = 0;
+    // 设备缓冲区帧数（以 DeviceSampleRate() 计），未知时为 0
+    virtual uint32_t BufferFrames() const = 0;
+    // 启动/停止 IO，Stop 返回后不再调用 callback。可以在任意线程调用，但不能并发
+    virtual std::string Start() = 0;
+    virtual void Stop() = 0;
+    // 工作线程：释放设备
+    virtual void Close() = 0;
+
+    // 设备时钟的采样率：后端内部做了采样率转换时与 SampleRate() 不同
+    virtual double DeviceSampleRate() const { return SampleRate(); }
+    virtual CaptureLatency Latency() const
+    {
+        CaptureLatency latency;
+        latency.bufferFrames = BufferFrames();
+        latency.sampleRate = DeviceSampleRate();
+        return latency;
+    }
+    // 设备 IO 线程所属的 workgroup（macOS），投递线程加入它；没有时为空
+    virtual std::shared_ptr<void> Workgroup() const { return nullptr; }
+    // JS 线程：准备完成后开始跟随默认设备的切换和当前设备的格式变化，直到 Close。
+    // context 与 Open 相同；不跟随设备切换的后端忽略
+    virtual void FollowDevice(DeviceChangedCallback callback) { (void)callback; }
+};
+
+// 由平台后端实现
+std::unique_ptr<CaptureSource> CreateCaptureSource();
+std::vector<CaptureDeviceInfo> ListCaptureDevices();
+
+#if defined(AUDIO_CAPTURE_COUNT_ALLOCATIONS)
+// 仅基准后端：本模块经 operator new 的累计分配次数
+uint64_t HeapAllocations();
+#endif
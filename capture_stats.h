@@ -0,0 +1,235 @@
+// capture_stats.h
+#pragma once
+#if defined(__APPLE__)
+#include <CoreAudio/CoreAudio.h>
+#include <mach/mach_time.h>
+#else
+#include <chrono>
+#endif
+#include <node_api.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__APPLE__)
+// mach_absolute_time 与纳秒之间的换算
+inline const mach_timebase_info_data_t &HostTimebase()
+{
+    static const mach_timebase_info_data_t timebase = []
+    {
+        mach_timebase_info_data_t info = {1, 1};
+        mach_timebase_info(&info);
+        return info;
+    }();
+    return timebase;
+}
+
+inline uint64_t HostTicksToNs(uint64_t ticks)
+{
+    return ticks * HostTimebase().numer / HostTimebase().denom;
+}
+
+inline uint64_t NsToHostTicks(uint64_t ns)
+{
+    return ns * HostTimebase().denom / HostTimebase().numer;
+}
+
+inline uint64_t HostTimeNs()
+{
+    return HostTicksToNs(mach_absolute_time());
+}
+#else
+// 与 libuv 的 uv_hrtime 同一时钟：Linux 为 CLOCK_MONOTONIC，Windows 为 QueryPerformanceCounter
+inline uint64_t HostTimeNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+#endif
+
+// 无锁直方图，按微秒取 2 的幂分桶：第 0 桶 < 1us，第 i 桶为 [2^(i-1), 2^i) us。
+// Record 只有 relaxed 原子操作，可以在实时线程调用。
+class LatencyHistogram
+{
+public:
+    static constexpr size_t kBuckets = 24; // 最后一桶收纳 >= 2^22 us（约 4 秒）
+
+private:
+    std::atomic<uint64_t> buckets[kBuckets] = {};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sumNs{0};
+    std::atomic<uint64_t> maxNs{0};
+
+public:
+    void Record(uint64_t ns)
+    {
+        uint64_t us = ns / 1000;
+        size_t bucket = 0;
+        while (us > 0 && bucket < kBuckets - 1)
+        {
+            us >>= 1;
+            bucket++;
+        }
+        buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sumNs.fetch_add(ns, std::memory_order_relaxed);
+
+        uint64_t current = maxNs.load(std::memory_order_relaxed);
+        while (ns > current && !maxNs.compare_exchange_weak(current, ns, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void Reset()
+    {
+        for (auto &b : buckets)
+        {
+            b.store(0, std::memory_order_relaxed);
+        }
+        count.store(0, std::memory_order_relaxed);
+        sumNs.store(0, std::memory_order_relaxed);
+        maxNs.store(0, std::memory_order_relaxed);
+    }
+
+    // 第 i 桶的上界（微秒）
+    static double BucketUpperUs(size_t bucket)
+    {
+        return static_cast<double>(1ull << bucket);
+    }
+
+    uint64_t Bucket(size_t bucket) const { return buckets[bucket].load(std::memory_order_relaxed); }
+    uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+    double MeanUs() const
+    {
+        uint64_t n = Count();
+        return n > 0 ? sumNs.load(std::memory_order_relaxed) / 1000.0 / n : 0.0;
+    }
+    double MaxUs() const { return maxNs.load(std::memory_order_relaxed) / 1000.0; }
+
+    // 按桶上界估计分位数（微秒），q 取 0..1
+    double PercentileUs(double q) const
+    {
+        uint64_t n = Count();
+        if (n == 0)
+        {
+            return 0.0;
+        }
+        uint64_t target = static_cast<uint64_t>(q * n);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; i++)
+        {
+            seen += Bucket(i);
+            if (seen > target)
+            {
+                return BucketUpperUs(i);
+            }
+        }
+        return MaxUs();
+    }
+};
+
+// 采集健康状况计数器，IO 线程、投递线程和 JS 线程共同写入，由 getStats 读取。
+// 投递回调可能晚于 AudioCapture 析构执行，因此以 shared_ptr 共享持有。
+struct CaptureStats
+{
+    std::atomic<uint64_t> ioCycles{0};
+    std::atomic<uint64_t> renderErrors{0};
+    std::atomic<int32_t> lastRenderError{0};
+    std::atomic<uint64_t> sampleTimeGaps{0}; // mSampleTime 不连续（丢帧/xrun）的次数
+    std::atomic<uint64_t> queueFull{0};      // NonBlockingCall 返回 napi_queue_full 的次数
+    std::atomic<uint64_t> callFailures{0};   // NonBlockingCall 的其他失败（如正在关闭）
+    std::atomic<uint64_t> deviceChanges{0};  // 设备切换/格式变化后重新绑定的次数
+
+    LatencyHistogram renderTime;      // IO 回调耗时
+    LatencyHistogram deliveryLatency; // 入队到 JS 回调开始之间的延迟
+    LatencyHistogram ioJitter;        // 相邻 IO 周期的 mHostTime 间隔与采样数推算的间隔之差
+
+    // 以下只在 IO 线程访问
+    bool hasLastTime = false;
+    double lastSampleTime = 0;
+    uint64_t lastHostTime = 0; // 纳秒
+    uint32_t lastFrames = 0;
+    double nsPerFrame = 0;
+
+    void Reset(double sampleRate)
+    {
+        ioCycles.store(0, std::memory_order_relaxed);
+        renderErrors.store(0, std::memory_order_relaxed);
+        lastRenderError.store(0, std::memory_order_relaxed);
+        sampleTimeGaps.store(0, std::memory_order_relaxed);
+        queueFull.store(0, std::memory_order_relaxed);
+        callFailures.store(0, std::memory_order_relaxed);
+        deviceChanges.store(0, std::memory_order_relaxed);
+        renderTime.Reset();
+        deliveryLatency.Reset();
+        ioJitter.Reset();
+        hasLastTime = false;
+        nsPerFrame = sampleRate > 0 ? 1e9 / sampleRate : 0;
+    }
+
+    // IO 线程停止期间调用：重新绑定设备后 mSampleTime 重新计数，不算作丢帧
+    void Rebind(double sampleRate)
+    {
+        deviceChanges.fetch_add(1, std::memory_order_relaxed);
+        hasLastTime = false;
+        nsPerFrame = sampleRate > 0 ? 1e9 / sampleRate : 0;
+    }
+
+    // IO 线程停止期间调用：stop() 之后再 start()，中间的空档不算作丢帧
+    void Resume()
+    {
+        hasLastTime = false;
+    }
+
+    // IO 线程：检查采样计数是否连续并记录周期抖动。hostTimeNs 为 0 表示无效
+    void RecordCycle(bool sampleTimeValid, double sampleTime, uint64_t hostTimeNs, uint32_t frames)
+    {
+        ioCycles.fetch_add(1, std::memory_order_relaxed);
+        if (!sampleTimeValid)
+        {
+            hasLastTime = false;
+            return;
+        }
+
+        if (hasLastTime)
+        {
+            if (sampleTime != lastSampleTime + lastFrames)
+            {
+                sampleTimeGaps.fetch_add(1, std::memory_order_relaxed);
+            }
+            else if (hostTimeNs > 0 && lastHostTime > 0 && nsPerFrame > 0)
+            {
+                double actual = static_cast<double>(hostTimeNs - lastHostTime);
+                double expected = lastFrames * nsPerFrame;
+                double jitter = actual > expected ? actual - expected : expected - actual;
+                ioJitter.Record(static_cast<uint64_t>(jitter));
+            }
+        }
+        hasLastTime = true;
+        lastSampleTime = sampleTime;
+        lastHostTime = hostTimeNs;
+        lastFrames = frames;
+    }
+
+#if defined(__APPLE__)
+    void RecordTimeStamp(const AudioTimeStamp *timeStamp, UInt32 frames)
+    {
+        bool sampleValid = timeStamp && (timeStamp->mFlags & kAudioTimeStampSampleTimeValid);
+        bool hostValid = timeStamp && (timeStamp->mFlags & kAudioTimeStampHostTimeValid);
+        RecordCycle(sampleValid, sampleValid ? timeStamp->mSampleTime : 0, hostValid ? HostTicksToNs(timeStamp->mHostTime) : 0, frames);
+    }
+#endif
+
+    void RecordCallStatus(napi_status status)
+    {
+        if (status == napi_queue_full)
+        {
+            queueFull.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (status != napi_ok)
+        {
+            callFailures.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
@@ -0,0 +1,486 @@
+// coreaudio_source.cc
+#include "capture_source.h"
+#include <AudioToolbox/AudioToolbox.h>
+#include <CoreAudio/CoreAudio.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "capture_stats.h"
+#include "device_monitor.h"
+#include "devices.h"
+#include "process_tap.h"
+#include "thread_priority.h"
+
+namespace
+{
+    bool IsNumericId(const std::string &id)
+    {
+        return !id.empty() && id.find_first_not_of("0123456789") == std::string::npos;
+    }
+
+    // device 选项：AudioDeviceID 的十进制字符串或设备 UID，找不到时返回 kAudioObjectUnknown
+    AudioDeviceID ResolveDevice(const std::string &id)
+    {
+        if (IsNumericId(id))
+        {
+            AudioDeviceID device = static_cast<AudioDeviceID>(strtoul(id.c_str(), nullptr, 10));
+            if (DeviceExists(device))
+            {
+                return device;
+            }
+        }
+        return DeviceForUID(id);
+    }
+}
+
+// AUHAL 采集：hal 模式直接采集设备的输入流（采集系统输出时需要虚拟声卡），
+// tap 模式通过进程 tap + 私有聚合设备采集系统/进程音频（macOS 14.2+）。
+// 客户端格式固定为交错立体声 Float32，设备采样率与之不同时由 AUHAL 转换。
+// 采集系统输出时监听设备切换和格式变化，在监听队列上原地重新绑定音频单元，下游的环形缓冲区和投递都保持不变
+class CoreAudioSource : public CaptureSource
+{
+private:
+    static constexpr UInt32 kMaxFramesPerSlice = 4096;
+    static constexpr UInt32 kDefaultSampleRate = 44100;
+
+    AudioUnit audioUnit = nullptr;
+    AudioStreamBasicDescription streamFormat = {};
+    // 监听队列在重新绑定时写入，JS 线程查询延迟和 IO 周期时读取
+    std::atomic<AudioDeviceID> device{kAudioObjectUnknown};
+    AudioDeviceID requestedDevice = kAudioObjectUnknown; // kAudioObjectUnknown 表示系统默认设备
+    uint32_t sampleRate = 0;
+    uint32_t bufferFrames = 0; // 请求的设备 IO 缓冲区帧数，0 表示使用设备当前的设置
+    bool input = false;
+
+    // tap 所在的输出设备变化时在新设备上重建 tap 和聚合设备
+    ProcessTapOptions tapOptions;
+    std::unique_ptr<ProcessTap> processTap;
+    AudioDeviceID tapOutputDevice = kAudioObjectUnknown;
+
+    DeviceMonitor deviceMonitor;
+    DeviceChangedCallback deviceChanged = nullptr;
+    // 串行化 Start/Stop 和监听队列上的重新绑定
+    std::mutex unitMutex;
+    bool running = false;
+
+    // 渲染缓冲区在 Open 时一次性分配，IO 回调只做 AudioUnitRender，不加锁也不分配
+    UInt32 maxFramesPerSlice = kMaxFramesPerSlice; // 不小于 kMaxFramesPerSlice 和 bufferFrames
+    std::unique_ptr<Float32[]> renderBuffer;
+
+    CaptureCallback callback = nullptr;
+    void *context = nullptr;
+
+    static OSStatus InputCallback(void *inRefCon,
+                                  AudioUnitRenderActionFlags *ioActionFlags,
+                                  const AudioTimeStamp *inTimeStamp,
+                                  UInt32 inBusNumber,
+                                  UInt32 inNumberFrames,
+                                  AudioBufferList *ioData)
+    {
+        CoreAudioSource *self = static_cast<CoreAudioSource *>(inRefCon);
+        CaptureSourceTime time;
+        time.cycleStartNs = HostTimeNs();
+        if (inTimeStamp && (inTimeStamp->mFlags & kAudioTimeStampSampleTimeValid))
+        {
+            time.sampleTimeValid = true;
+            time.sampleTime = inTimeStamp->mSampleTime;
+        }
+        if (inTimeStamp && (inTimeStamp->mFlags & kAudioTimeStampHostTimeValid))
+        {
+            time.hostTimeNs = HostTicksToNs(inTimeStamp->mHostTime);
+        }
+
+        OSStatus status = kAudio_ParamError;
+        if (inNumberFrames <= self->maxFramesPerSlice)
+        {
+            AudioBufferList bufferList;
+            bufferList.mNumberBuffers = 1;
+            bufferList.mBuffers[0].mNumberChannels = kChannels;
+            bufferList.mBuffers[0].mDataByteSize = inNumberFrames * kChannels * sizeof(Float32);
+            bufferList.mBuffers[0].mData = self->renderBuffer.get();
+            status = AudioUnitRender(self->audioUnit, ioActionFlags, inTimeStamp, inBusNumber, inNumberFrames, &bufferList);
+        }
+
+        time.status = status;
+        self->callback(self->context, status == noErr ? self->renderBuffer.get() : nullptr, inNumberFrames, time);
+        return status;
+    }
+
+    // 音频单元未初始化时调用：绑定设备，并重新设置客户端流格式（更换设备后 AUHAL 可能重置它）
+    OSStatus BindDevice(AudioDeviceID target)
+    {
+        OSStatus status = AudioUnitSetProperty(audioUnit,
+                                               kAudioOutputUnitProperty_CurrentDevice,
+                                               kAudioUnitScope_Global,
+                                               0,
+                                               &target,
+                                               sizeof(AudioDeviceID));
+        if (status != noErr)
+        {
+            return status;
+        }
+        return AudioUnitSetProperty(audioUnit,
+                                    kAudioUnitProperty_StreamFormat,
+                                    kAudioUnitScope_Output,
+                                    1,
+                                    &streamFormat,
+                                    sizeof(streamFormat));
+    }
+
+    // 音频单元未初始化时调用：按 bufferFrames 设置设备的 IO 缓冲区，超出设备允许的范围时取边界值。
+    // 同一设备的多个客户端中 HAL 采用最小的设置，实际生效的大小由 Latency() 返回。
+    void ApplyBufferFrames()
+    {
+        if (bufferFrames == 0)
+        {
+            return;
+        }
+        UInt32 frames = bufferFrames;
+        UInt32 minFrames = 0;
+        UInt32 maxFrames = 0;
+        if (DeviceBufferFrameSizeRange(device, minFrames, maxFrames))
+        {
+            frames = std::min(std::max(frames, minFrames), maxFrames);
+        }
+        frames = std::min(frames, maxFramesPerSlice);
+        AudioUnitSetProperty(audioUnit,
+                             kAudioDevicePropertyBufferFrameSize,
+                             kAudioUnitScope_Global,
+                             0,
+                             &frames,
+                             sizeof(frames));
+    }
+
+    // 监听队列：默认设备切换或当前设备的采样率/流配置变化。
+    // 只停止并重新初始化已有的音频单元，不重新创建；客户端格式保持不变，
+    // 设备采样率变化由 AUHAL 转换，下游的重采样器、环形缓冲区和投递线程都不受影响。
+    void RebindDevice()
+    {
+        std::lock_guard<std::mutex> lock(unitMutex);
+
+        // 指定的设备被拔出时退回到系统默认输出设备
+        AudioDeviceID next = requestedDevice;
+        if (next == kAudioObjectUnknown || !DeviceExists(next))
+        {
+            next = DefaultDevice(kAudioHardwarePropertyDefaultOutputDevice);
+        }
+        if (next == kAudioObjectUnknown)
+        {
+            return;
+        }
+
+        // AudioOutputUnitStop 返回时 IO 线程已经退出，之后可以安全地重置 IO 线程状态
+        AudioOutputUnitStop(audioUnit);
+        AudioUnitUninitialize(audioUnit);
+
+        // tap 后端：输出设备变化时在新设备上重建 tap 和聚合设备，失败时保留原来的
+        std::unique_ptr<ProcessTap> previousTap;
+        AudioDeviceID target = next;
+        if (processTap)
+        {
+            target = device;
+            if (next != tapOutputDevice)
+            {
+                auto tap = std::make_unique<ProcessTap>();
+                if (tap->Create(tapOptions, next) == noErr)
+                {
+                    previousTap = std::move(processTap);
+                    processTap = std::move(tap);
+                    tapOutputDevice = next;
+                    target = processTap->AggregateDevice();
+                }
+            }
+        }
+
+        if (BindDevice(target) != noErr && target != device.load())
+        {
+            // 新设备不可用，回到原来的设备
+            if (previousTap)
+            {
+                processTap = std::move(previousTap);
+            }
+            target = device;
+            BindDevice(target);
+        }
+        device = target;
+        ApplyBufferFrames();
+
+        if (deviceChanged)
+        {
+            deviceChanged(context, DeviceSampleRate());
+        }
+
+        AudioUnitInitialize(audioUnit);
+        if (running)
+        {
+            AudioOutputUnitStart(audioUnit);
+        }
+
+        // 音频单元已不再使用旧的聚合设备
+        previousTap.reset();
+        deviceMonitor.Watch(device);
+    }
+
+public:
+    CoreAudioSource() = default;
+    CoreAudioSource(const CoreAudioSource &) = delete;
+    CoreAudioSource &operator=(const CoreAudioSource &) = delete;
+
+    ~CoreAudioSource()
+    {
+        Close();
+    }
+
+    std::string Open(const CaptureSourceOptions &options, CaptureCallback captureCallback, void *callbackContext) override
+    {
+        Close();
+        callback = captureCallback;
+        context = callbackContext;
+        input = options.input;
+        bufferFrames = options.bufferFrames;
+        const char *unitName = input ? "microphone audio unit" : "audio unit";
+
+        requestedDevice = kAudioObjectUnknown;
+        if (!options.device.empty())
+        {
+            requestedDevice = ResolveDevice(options.device);
+            if (requestedDevice == kAudioObjectUnknown)
+            {
+                return IsNumericId(options.device) ? "Audio device " + options.device + " not found" : "Audio device '" + options.device + "' not found";
+            }
+        }
+
+        // 未指定设备时采集系统默认输出设备（输入模式为默认输入设备）
+        AudioDeviceID target = requestedDevice;
+        if (target == kAudioObjectUnknown)
+        {
+            target = DefaultDevice(input ? kAudioHardwarePropertyDefaultInputDevice : kAudioHardwarePropertyDefaultOutputDevice);
+        }
+        if (input && (target == kAudioObjectUnknown || DeviceNominalSampleRate(target) <= 0 ||
+                      DeviceChannelCount(target, kAudioObjectPropertyScopeInput) == 0))
+        {
+            return "No usable microphone input device";
+        }
+        if (target == kAudioObjectUnknown)
+        {
+            return "Failed to get default output device";
+        }
+
+        // tap 后端：在输出设备上建立进程 tap 和私有聚合设备，之后按普通输入设备采集聚合设备
+        if (options.tap)
+        {
+            if (!ProcessTap::IsSupported())
+            {
+                return "The tap backend requires macOS 14.2 or later";
+            }
+            tapOptions.processes.assign(options.tapProcesses.begin(), options.tapProcesses.end());
+            tapOptions.exclude = options.tapExclude;
+            tapOptions.mute = options.tapMute;
+            processTap = std::make_unique<ProcessTap>();
+            OSStatus tapStatus = processTap->Create(tapOptions, target);
+            if (tapStatus != noErr)
+            {
+                processTap.reset();
+                return "Failed to create process tap (OSStatus " + std::to_string(tapStatus) + ")";
+            }
+            tapOutputDevice = target;
+            target = processTap->AggregateDevice();
+        }
+        device = target;
+
+        // 未指定采样率时按设备的标称采样率渲染，不做采样率转换
+        Float64 nominalRate = DeviceNominalSampleRate(target);
+        sampleRate = options.sampleRate > 0 ? options.sampleRate : nominalRate > 0 ? static_cast<uint32_t>(nominalRate) : kDefaultSampleRate;
+        // 先调用一次 HostTimeNs，避免在实时线程上初始化时基
+        HostTimeNs();
+
+        AudioComponentDescription desc = {};
+        desc.componentType = kAudioUnitType_Output;
+        desc.componentSubType = kAudioUnitSubType_HALOutput;
+        desc.componentManufacturer = kAudioUnitManufacturer_Apple;
+        AudioComponent component = AudioComponentFindNext(NULL, &desc);
+        if (!component || AudioComponentInstanceNew(component, &audioUnit) != noErr)
+        {
+            audioUnit = nullptr;
+            Close();
+            return std::string("Failed to create ") + unitName;
+        }
+
+        // 禁用输出，启用输入
+        UInt32 enableIO = 0;
+        OSStatus status = AudioUnitSetProperty(audioUnit, kAudioOutputUnitProperty_EnableIO, kAudioUnitScope_Output, 0, &enableIO, sizeof(enableIO));
+        enableIO = 1;
+        if (status == noErr)
+        {
+            status = AudioUnitSetProperty(audioUnit, kAudioOutputUnitProperty_EnableIO, kAudioUnitScope_Input, 1, &enableIO, sizeof(enableIO));
+        }
+
+        // 单声道设备由 AUHAL 复制到两个声道
+        streamFormat.mSampleRate = sampleRate;
+        streamFormat.mFormatID = kAudioFormatLinearPCM;
+        streamFormat.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
+        streamFormat.mFramesPerPacket = 1;
+        streamFormat.mChannelsPerFrame = kChannels;
+        streamFormat.mBitsPerChannel = 32;
+        streamFormat.mBytesPerPacket = kChannels * sizeof(Float32);
+        streamFormat.mBytesPerFrame = streamFormat.mBytesPerPacket;
+
+        if (status == noErr)
+        {
+            status = BindDevice(target);
+        }
+        // 大缓冲区（批量录制）时一个 IO 周期可能超过 kMaxFramesPerSlice
+        maxFramesPerSlice = std::max(bufferFrames, kMaxFramesPerSlice);
+        ApplyBufferFrames();
+
+        // 限制单次渲染的最大帧数，使预分配的渲染缓冲区足够大
+        UInt32 maxFrames = maxFramesPerSlice;
+        if (status == noErr)
+        {
+            status = AudioUnitSetProperty(audioUnit, kAudioUnitProperty_MaximumFramesPerSlice, kAudioUnitScope_Global, 0, &maxFrames, sizeof(maxFrames));
+        }
+
+        AURenderCallbackStruct callbackStruct;
+        callbackStruct.inputProc = InputCallback;
+        callbackStruct.inputProcRefCon = this;
+        if (status == noErr)
+        {
+            status = AudioUnitSetProperty(audioUnit, kAudioOutputUnitProperty_SetInputCallback, kAudioUnitScope_Global, 0, &callbackStruct, sizeof(callbackStruct));
+        }
+        if (status != noErr)
+        {
+            Close();
+            return std::string("Failed to configure ") + unitName + " (OSStatus " + std::to_string(status) + ")";
+        }
+
+        renderBuffer = std::make_unique<Float32[]>(maxFramesPerSlice * kChannels);
+
+        // 初始化音频单元，由 Start 启动
+        status = AudioUnitInitialize(audioUnit);
+        if (status != noErr)
+        {
+            Close();
+            return std::string("Failed to initialize ") + unitName + " (OSStatus " + std::to_string(status) + ")";
+        }
+        return std::string();
+    }
+
+    uint32_t SampleRate() const override { return sampleRate; }
+
+    uint32_t BufferFrames() const override
+    {
+        return DeviceUInt32Property(device, kAudioDevicePropertyBufferFrameSize);
+    }
+
+    double DeviceSampleRate() const override
+    {
+        Float64 rate = DeviceNominalSampleRate(device);
+        return rate > 0 ? rate : sampleRate;
+    }
+
+    CaptureLatency Latency() const override
+    {
+        AudioDeviceID current = device;
+        CaptureLatency latency;
+        latency.bufferFrames = DeviceUInt32Property(current, kAudioDevicePropertyBufferFrameSize);
+        latency.deviceLatency = DeviceUInt32Property(current, kAudioDevicePropertyLatency, kAudioObjectPropertyScopeInput);
+        latency.safetyOffset = DeviceUInt32Property(current, kAudioDevicePropertySafetyOffset, kAudioObjectPropertyScopeInput);
+        latency.streamLatency = DeviceStreamLatency(current, kAudioObjectPropertyScopeInput);
+        latency.sampleRate = DeviceNominalSampleRate(current);
+        return latency;
+    }
+
+    std::shared_ptr<void> Workgroup() const override
+    {
+        return DeviceIoWorkgroup(device);
+    }
+
+    // 只在采集系统输出时跟随；未指定设备时同时跟随系统默认输出设备，准备好但未启动时也要跟随
+    void FollowDevice(DeviceChangedCallback callback) override
+    {
+        if (!audioUnit || input)
+        {
+            return;
+        }
+        deviceChanged = callback;
+        deviceMonitor.Start(device, requestedDevice == kAudioObjectUnknown, [this]()
+                            { RebindDevice(); });
+    }
+
+    std::string Start() override
+    {
+        std::lock_guard<std::mutex> lock(unitMutex);
+        if (!audioUnit || running)
+        {
+            return std::string();
+        }
+        OSStatus status = AudioOutputUnitStart(audioUnit);
+        if (status != noErr)
+        {
+            return "Failed to start audio unit (OSStatus " + std::to_string(status) + ")";
+        }
+        running = true;
+        return std::string();
+    }
+
+    // 返回后 IO 回调不再运行
+    void Stop() override
+    {
+        std::lock_guard<std::mutex> lock(unitMutex);
+        if (audioUnit && running)
+        {
+            AudioOutputUnitStop(audioUnit);
+            running = false;
+        }
+    }
+
+    void Close() override
+    {
+        // 返回后不会再有重新绑定在进行
+        deviceMonitor.Stop();
+        deviceChanged = nullptr;
+        Stop();
+        if (audioUnit)
+        {
+            AudioUnitUninitialize(audioUnit);
+            AudioComponentInstanceDispose(audioUnit);
+            audioUnit = nullptr;
+        }
+        // 音频单元释放后再销毁聚合设备和 tap
+        processTap.reset();
+        tapOutputDevice = kAudioObjectUnknown;
+        renderBuffer.reset();
+    }
+};
+
+std::unique_ptr<CaptureSource> CreateCaptureSource()
+{
+    return std::make_unique<CoreAudioSource>();
+}
+
+// id 为 AudioDeviceID 的十进制字符串，uid 为持久的设备 UID，两者都可以作为 device 选项
+std::vector<CaptureDeviceInfo> ListCaptureDevices()
+{
+    AudioDeviceID defaultInput = DefaultDevice(kAudioHardwarePropertyDefaultInputDevice);
+    AudioDeviceID defaultOutput = DefaultDevice(kAudioHardwarePropertyDefaultOutputDevice);
+
+    std::vector<CaptureDeviceInfo> devices;
+    for (AudioDeviceID id : ListDevices())
+    {
+        CaptureDeviceInfo info;
+        info.id = std::to_string(id);
+        info.uid = DeviceStringProperty(id, kAudioDevicePropertyDeviceUID);
+        info.name = DeviceStringProperty(id, kAudioObjectPropertyName);
+        info.manufacturer = DeviceStringProperty(id, kAudioObjectPropertyManufacturer);
+        info.inputChannels = DeviceChannelCount(id, kAudioObjectPropertyScopeInput);
+        info.outputChannels = DeviceChannelCount(id, kAudioObjectPropertyScopeOutput);
+        info.sampleRate = DeviceNominalSampleRate(id);
+        info.isDefaultInput = id == defaultInput;
+        info.isDefaultOutput = id == defaultOutput;
+        devices.push_back(info);
+    }
+    return devices;
+}
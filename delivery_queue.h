@@ -0,0 +1,160 @@
+// delivery_queue.h
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include "buffer_pool.h"
+
+// 队列满时的处理策略
+enum class QueuePolicy
+{
+    DropNewest, // 丢弃新到的数据块
+    DropOldest, // 丢弃最早排队的数据块
+    Coalesce,   // 把新数据合并到队尾数据块
+};
+
+inline bool ParseQueuePolicy(const std::string &name, QueuePolicy &policy)
+{
+    if (name == "drop-newest")
+    {
+        policy = QueuePolicy::DropNewest;
+    }
+    else if (name == "drop-oldest")
+    {
+        policy = QueuePolicy::DropOldest;
+    }
+    else if (name == "coalesce")
+    {
+        policy = QueuePolicy::Coalesce;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// 生产线程与 JS 线程之间的有界队列。
+// 只有队列从空变为非空时才需要唤醒 JS 线程，JS 线程一次取空整个队列，
+// 因此 ThreadSafeFunction 中最多只有一个待处理调用。
+class DeliveryQueue
+{
+private:
+    std::mutex mutex;
+    std::deque<BufferPool::Handle> chunks;
+    size_t maxDepth = 0; // 0 表示不限制
+    QueuePolicy policy = QueuePolicy::DropOldest;
+    bool scheduled = false;
+
+    uint64_t droppedChunks = 0;
+    uint64_t coalescedChunks = 0;
+
+public:
+    // 合并后的数据块上限，超过后按 DropOldest 处理，保证内存有界
+    static constexpr size_t kMaxCoalesceBytes = 1 << 20;
+
+    void Configure(size_t depth, QueuePolicy queuePolicy)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        maxDepth = depth;
+        policy = queuePolicy;
+        chunks.clear();
+        scheduled = false;
+        droppedChunks = 0;
+        coalescedChunks = 0;
+    }
+
+    // 入队，返回 true 表示调用方需要唤醒 JS 线程
+    bool Push(BufferPool::Handle chunk)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (maxDepth > 0 && chunks.size() >= maxDepth)
+        {
+            switch (policy)
+            {
+            case QueuePolicy::DropNewest:
+                droppedChunks++;
+                return false;
+            case QueuePolicy::Coalesce:
+            {
+                BufferPool::Handle &tail = chunks.back();
+                size_t mergedSize = tail->size + chunk->size;
+                // 池中的数据块定长，队尾块容量足够时原地追加，否则按 DropOldest 处理
+                if (mergedSize <= kMaxCoalesceBytes && tail->capacity >= mergedSize)
+                {
+                    memcpy(tail->data.get() + tail->size, chunk->data.get(), chunk->size);
+                    tail->size = mergedSize;
+                    tail->frames += chunk->frames;
+                    tail->active = tail->active || chunk->active;
+                    coalescedChunks++;
+                    return false;
+                }
+                chunks.pop_front();
+                droppedChunks++;
+                break;
+            }
+            case QueuePolicy::DropOldest:
+                chunks.pop_front();
+                droppedChunks++;
+                break;
+            }
+        }
+
+        chunks.push_back(std::move(chunk));
+        if (scheduled)
+        {
+            return false;
+        }
+        scheduled = true;
+        return true;
+    }
+
+    // JS 线程：取出一个数据块，队列为空时返回空句柄并清除调度标记
+    BufferPool::Handle Pop()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (chunks.empty())
+        {
+            scheduled = false;
+            return nullptr;
+        }
+        BufferPool::Handle chunk = std::move(chunks.front());
+        chunks.pop_front();
+        return chunk;
+    }
+
+    // 唤醒失败（如 ThreadSafeFunction 已关闭）时调用，允许下次重新调度
+    void Unschedule()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        scheduled = false;
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks.clear();
+        scheduled = false;
+    }
+
+    size_t Depth()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return chunks.size();
+    }
+
+    uint64_t DroppedChunks()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return droppedChunks;
+    }
+
+    uint64_t CoalescedChunks()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return coalescedChunks;
+    }
+};
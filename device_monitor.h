@@ -0,0 +1,140 @@
+// device_monitor.h
+#pragma once
+#include <CoreAudio/CoreAudio.h>
+#include <dispatch/dispatch.h>
+#include <atomic>
+#include <functional>
+#include "devices.h"
+
+// 监听默认输出设备的切换以及当前设备的采样率/流配置变化。
+// HAL 在自己的通知线程上调用监听函数，这里只做合并，
+// 真正的处理（重新绑定音频单元）在一个串行队列上进行，不阻塞 HAL 也不占用 JS 线程。
+class DeviceMonitor
+{
+public:
+    using ChangeCallback = std::function<void()>;
+
+private:
+    dispatch_queue_t queue = dispatch_queue_create("audio-capture.device-monitor", DISPATCH_QUEUE_SERIAL);
+    ChangeCallback onChange;
+    std::atomic<bool> active{false};
+    std::atomic<bool> changePending{false};
+    bool followDefault = false;
+    AudioDeviceID device = kAudioObjectUnknown;
+
+    static AudioObjectPropertyAddress DefaultDeviceAddress()
+    {
+        return DeviceAddress(kAudioHardwarePropertyDefaultOutputDevice);
+    }
+
+    static AudioObjectPropertyAddress DeviceAddresses(size_t index)
+    {
+        static const AudioObjectPropertyAddress addresses[] = {
+            DeviceAddress(kAudioDevicePropertyNominalSampleRate),
+            DeviceAddress(kAudioDevicePropertyStreamConfiguration, kAudioObjectPropertyScopeInput),
+            DeviceAddress(kAudioDevicePropertyDeviceIsAlive),
+        };
+        return addresses[index];
+    }
+    static constexpr size_t kDeviceAddressCount = 3;
+
+    static OSStatus Listener(AudioObjectID, UInt32, const AudioObjectPropertyAddress *, void *clientData)
+    {
+        static_cast<DeviceMonitor *>(clientData)->Notify();
+        return noErr;
+    }
+
+    // HAL 通知线程：一次切换通常会连续触发多个属性，合并成一次处理
+    void Notify()
+    {
+        if (!active.load(std::memory_order_acquire) || changePending.exchange(true))
+        {
+            return;
+        }
+        dispatch_async_f(queue, this, [](void *context)
+                         {
+            DeviceMonitor *self = static_cast<DeviceMonitor *>(context);
+            self->changePending.store(false);
+            if (self->active.load(std::memory_order_acquire))
+            {
+                self->onChange();
+            } });
+    }
+
+    void AddDeviceListeners(AudioDeviceID target)
+    {
+        for (size_t i = 0; i < kDeviceAddressCount; i++)
+        {
+            AudioObjectPropertyAddress address = DeviceAddresses(i);
+            AudioObjectAddPropertyListener(target, &address, Listener, this);
+        }
+    }
+
+    void RemoveDeviceListeners(AudioDeviceID target)
+    {
+        for (size_t i = 0; i < kDeviceAddressCount; i++)
+        {
+            AudioObjectPropertyAddress address = DeviceAddresses(i);
+            AudioObjectRemovePropertyListener(target, &address, Listener, this);
+        }
+    }
+
+public:
+    DeviceMonitor() = default;
+    DeviceMonitor(const DeviceMonitor &) = delete;
+    DeviceMonitor &operator=(const DeviceMonitor &) = delete;
+
+    ~DeviceMonitor()
+    {
+        Stop();
+        dispatch_release(queue);
+    }
+
+    // JS 线程：开始监听 target。followDefault 为 true 时同时监听系统默认输出设备的切换。
+    // callback 在串行队列上调用，其中可以调用 Watch 改为监听新的设备。
+    void Start(AudioDeviceID target, bool followDefaultDevice, ChangeCallback callback)
+    {
+        Stop();
+        onChange = std::move(callback);
+        followDefault = followDefaultDevice;
+        device = target;
+        active.store(true, std::memory_order_release);
+        if (followDefault)
+        {
+            AudioObjectPropertyAddress address = DefaultDeviceAddress();
+            AudioObjectAddPropertyListener(kAudioObjectSystemObject, &address, Listener, this);
+        }
+        AddDeviceListeners(device);
+    }
+
+    // 串行队列：音频单元重新绑定到 target 后改为监听它
+    void Watch(AudioDeviceID target)
+    {
+        if (target == device)
+        {
+            return;
+        }
+        RemoveDeviceListeners(device);
+        device = target;
+        AddDeviceListeners(device);
+    }
+
+    // JS 线程：移除监听并等待正在进行的处理结束，返回后不会再调用 callback
+    void Stop()
+    {
+        if (!active.exchange(false))
+        {
+            return;
+        }
+        if (followDefault)
+        {
+            AudioObjectPropertyAddress address = DefaultDeviceAddress();
+            AudioObjectRemovePropertyListener(kAudioObjectSystemObject, &address, Listener, this);
+        }
+        dispatch_sync_f(queue, this, [](void *context)
+                        {
+            DeviceMonitor *self = static_cast<DeviceMonitor *>(context);
+            self->RemoveDeviceListeners(self->device);
+            self->device = kAudioObjectUnknown; });
+    }
+};
@@ -0,0 +1,188 @@
+// devices.h
+#pragma once
+#include <CoreAudio/CoreAudio.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <string>
+#include <vector>
+
+// CoreAudio 设备查询的小工具
+
+inline AudioObjectPropertyAddress DeviceAddress(AudioObjectPropertySelector selector,
+                                                AudioObjectPropertyScope scope = kAudioObjectPropertyScopeGlobal)
+{
+    return {selector, scope, kAudioObjectPropertyElementMain};
+}
+
+inline std::vector<AudioDeviceID> ListDevices()
+{
+    std::vector<AudioDeviceID> devices;
+    AudioObjectPropertyAddress address = DeviceAddress(kAudioHardwarePropertyDevices);
+    UInt32 size = 0;
+    if (AudioObjectGetPropertyDataSize(kAudioObjectSystemObject, &address, 0, NULL, &size) != noErr)
+    {
+        return devices;
+    }
+    devices.resize(size / sizeof(AudioDeviceID));
+    if (AudioObjectGetPropertyData(kAudioObjectSystemObject, &address, 0, NULL, &size, devices.data()) != noErr)
+    {
+        devices.clear();
+    }
+    else
+    {
+        devices.resize(size / sizeof(AudioDeviceID));
+    }
+    return devices;
+}
+
+// selector 为 kAudioHardwarePropertyDefaultOutputDevice 等，失败时返回 kAudioObjectUnknown
+inline AudioDeviceID DefaultDevice(AudioObjectPropertySelector selector)
+{
+    AudioDeviceID device = kAudioObjectUnknown;
+    AudioObjectPropertyAddress address = DeviceAddress(selector);
+    UInt32 size = sizeof(device);
+    if (AudioObjectGetPropertyData(kAudioObjectSystemObject, &address, 0, NULL, &size, &device) != noErr)
+    {
+        return kAudioObjectUnknown;
+    }
+    return device;
+}
+
+inline std::string CFStringToUtf8(CFStringRef string)
+{
+    if (!string)
+    {
+        return std::string();
+    }
+    CFIndex length = CFStringGetMaximumSizeForEncoding(CFStringGetLength(string), kCFStringEncodingUTF8) + 1;
+    std::vector<char> buffer(length);
+    if (!CFStringGetCString(string, buffer.data(), length, kCFStringEncodingUTF8))
+    {
+        return std::string();
+    }
+    return std::string(buffer.data());
+}
+
+inline std::string DeviceStringProperty(AudioObjectID object, AudioObjectPropertySelector selector)
+{
+    CFStringRef value = NULL;
+    AudioObjectPropertyAddress address = DeviceAddress(selector);
+    UInt32 size = sizeof(value);
+    if (AudioObjectGetPropertyData(object, &address, 0, NULL, &size, &value) != noErr || !value)
+    {
+        return std::string();
+    }
+    std::string result = CFStringToUtf8(value);
+    CFRelease(value);
+    return result;
+}
+
+// scope 为 kAudioObjectPropertyScopeInput 或 kAudioObjectPropertyScopeOutput
+inline UInt32 DeviceChannelCount(AudioDeviceID device, AudioObjectPropertyScope scope)
+{
+    AudioObjectPropertyAddress address = DeviceAddress(kAudioDevicePropertyStreamConfiguration, scope);
+    UInt32 size = 0;
+    if (AudioObjectGetPropertyDataSize(device, &address, 0, NULL, &size) != noErr || size == 0)
+    {
+        return 0;
+    }
+    std::vector<uint8_t> storage(size);
+    AudioBufferList *bufferList = reinterpret_cast<AudioBufferList *>(storage.data());
+    if (AudioObjectGetPropertyData(device, &address, 0, NULL, &size, bufferList) != noErr)
+    {
+        return 0;
+    }
+    UInt32 channels = 0;
+    for (UInt32 i = 0; i < bufferList->mNumberBuffers; i++)
+    {
+        channels += bufferList->mBuffers[i].mNumberChannels;
+    }
+    return channels;
+}
+
+// 失败时返回 0
+inline Float64 DeviceNominalSampleRate(AudioDeviceID device)
+{
+    Float64 rate = 0;
+    AudioObjectPropertyAddress address = DeviceAddress(kAudioDevicePropertyNominalSampleRate);
+    UInt32 size = sizeof(rate);
+    if (AudioObjectGetPropertyData(device, &address, 0, NULL, &size, &rate) != noErr || rate <= 0)
+    {
+        return 0;
+    }
+    return rate;
+}
+
+// UInt32 类型的设备属性，失败时返回 fallback
+inline UInt32 DeviceUInt32Property(AudioObjectID object, AudioObjectPropertySelector selector,
+                                   AudioObjectPropertyScope scope = kAudioObjectPropertyScopeGlobal, UInt32 fallback = 0)
+{
+    UInt32 value = 0;
+    AudioObjectPropertyAddress address = DeviceAddress(selector, scope);
+    UInt32 size = sizeof(value);
+    if (AudioObjectGetPropertyData(object, &address, 0, NULL, &size, &value) != noErr)
+    {
+        return fallback;
+    }
+    return value;
+}
+
+// 设备允许的 IO 缓冲区帧数范围
+inline bool DeviceBufferFrameSizeRange(AudioDeviceID device, UInt32 &minFrames, UInt32 &maxFrames)
+{
+    AudioValueRange range;
+    AudioObjectPropertyAddress address = DeviceAddress(kAudioDevicePropertyBufferFrameSizeRange);
+    UInt32 size = sizeof(range);
+    if (AudioObjectGetPropertyData(device, &address, 0, NULL, &size, &range) != noErr)
+    {
+        return false;
+    }
+    minFrames = static_cast<UInt32>(range.mMinimum);
+    maxFrames = static_cast<UInt32>(range.mMaximum);
+    return true;
+}
+
+// scope 方向上第一个流的延迟（帧），没有流时返回 0
+inline UInt32 DeviceStreamLatency(AudioDeviceID device, AudioObjectPropertyScope scope)
+{
+    AudioObjectPropertyAddress address = DeviceAddress(kAudioDevicePropertyStreams, scope);
+    UInt32 size = 0;
+    if (AudioObjectGetPropertyDataSize(device, &address, 0, NULL, &size) != noErr || size < sizeof(AudioStreamID))
+    {
+        return 0;
+    }
+    std::vector<AudioStreamID> streams(size / sizeof(AudioStreamID));
+    if (AudioObjectGetPropertyData(device, &address, 0, NULL, &size, streams.data()) != noErr)
+    {
+        return 0;
+    }
+    return DeviceUInt32Property(streams[0], kAudioStreamPropertyLatency);
+}
+
+// 按 UID 查找设备，找不到时返回 kAudioObjectUnknown
+inline AudioDeviceID DeviceForUID(const std::string &uid)
+{
+    CFStringRef uidString = CFStringCreateWithCString(NULL, uid.c_str(), kCFStringEncodingUTF8);
+    if (!uidString)
+    {
+        return kAudioObjectUnknown;
+    }
+    AudioDeviceID device = kAudioObjectUnknown;
+    AudioObjectPropertyAddress address = DeviceAddress(kAudioHardwarePropertyTranslateUIDToDevice);
+    UInt32 size = sizeof(device);
+    OSStatus status = AudioObjectGetPropertyData(kAudioObjectSystemObject, &address,
+                                                 sizeof(uidString), &uidString, &size, &device);
+    CFRelease(uidString);
+    return status == noErr ? device : kAudioObjectUnknown;
+}
+
+inline bool DeviceExists(AudioDeviceID device)
+{
+    for (AudioDeviceID id : ListDevices())
+    {
+        if (id == device)
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,406 @@
+// dsp.h
+#pragma once
+
+// 电平、响度、静音门和处理链用到的 vDSP 子集。Apple 平台直接使用 Accelerate，
+// 其他平台提供同名、同语义的标量实现（FFT 为基 2 实数 FFT，打包格式和缩放与 vDSP_fft_zrip 相同）
+#if defined(__APPLE__)
+#include <Accelerate/Accelerate.h>
+#else
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// MSVC 的 <cmath> 默认不定义 M_PI
+constexpr double kDspPi = 3.14159265358979323846;
+
+typedef unsigned long vDSP_Length;
+typedef long vDSP_Stride;
+
+struct DSPComplex
+{
+    float real;
+    float imag;
+};
+
+struct DSPSplitComplex
+{
+    float *realp;
+    float *imagp;
+};
+
+typedef int FFTDirection;
+typedef int FFTRadix;
+enum
+{
+    kFFTDirection_Forward = 1,
+    kFFTDirection_Inverse = -1,
+};
+enum
+{
+    kFFTRadix2 = 0,
+};
+enum
+{
+    vDSP_HANN_DENORM = 0,
+    vDSP_HANN_NORM = 2,
+};
+
+inline void vDSP_maxmgv(const float *a, vDSP_Stride ia, float *c, vDSP_Length n)
+{
+    float m = 0;
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        float v = std::fabs(a[i * ia]);
+        m = v > m ? v : m;
+    }
+    *c = m;
+}
+
+inline void vDSP_maxv(const float *a, vDSP_Stride ia, float *c, vDSP_Length n)
+{
+    float m = -INFINITY;
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        m = a[i * ia] > m ? a[i * ia] : m;
+    }
+    *c = m;
+}
+
+inline void vDSP_sve(const float *a, vDSP_Stride ia, float *c, vDSP_Length n)
+{
+    float sum = 0;
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        sum += a[i * ia];
+    }
+    *c = sum;
+}
+
+inline void vDSP_svesq(const float *a, vDSP_Stride ia, float *c, vDSP_Length n)
+{
+    float sum = 0;
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        sum += a[i * ia] * a[i * ia];
+    }
+    *c = sum;
+}
+
+inline void vDSP_vmul(const float *a, vDSP_Stride ia, const float *b, vDSP_Stride ib, float *c, vDSP_Stride ic, vDSP_Length n)
+{
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        c[i * ic] = a[i * ia] * b[i * ib];
+    }
+}
+
+inline void vDSP_vadd(const float *a, vDSP_Stride ia, const float *b, vDSP_Stride ib, float *c, vDSP_Stride ic, vDSP_Length n)
+{
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        c[i * ic] = a[i * ia] + b[i * ib];
+    }
+}
+
+inline void vDSP_vsmul(const float *a, vDSP_Stride ia, const float *b, float *c, vDSP_Stride ic, vDSP_Length n)
+{
+    float scale = *b;
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        c[i * ic] = a[i * ia] * scale;
+    }
+}
+
+// d = a * b + c
+inline void vDSP_vma(const float *a, vDSP_Stride ia, const float *b, vDSP_Stride ib, const float *c, vDSP_Stride ic,
+                     float *d, vDSP_Stride id, vDSP_Length n)
+{
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        d[i * id] = a[i * ia] * b[i * ib] + c[i * ic];
+    }
+}
+
+inline void vDSP_vclip(const float *a, vDSP_Stride ia, const float *low, const float *high, float *d, vDSP_Stride id, vDSP_Length n)
+{
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        float v = a[i * ia];
+        d[i * id] = v < *low ? *low : (v > *high ? *high : v);
+    }
+}
+
+// 同 vDSP_vclip，并统计低于下限和高于上限的个数
+inline void vDSP_vclipc(const float *a, vDSP_Stride ia, const float *low, const float *high, float *d, vDSP_Stride id, vDSP_Length n,
+                        vDSP_Length *clippedLow, vDSP_Length *clippedHigh)
+{
+    *clippedLow = 0;
+    *clippedHigh = 0;
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        float v = a[i * ia];
+        if (v < *low)
+        {
+            v = *low;
+            (*clippedLow)++;
+        }
+        else if (v > *high)
+        {
+            v = *high;
+            (*clippedHigh)++;
+        }
+        d[i * id] = v;
+    }
+}
+
+// o[i] = *start * in[i]，每步 *start += *step，返回时 *start 为下一个值
+inline void vDSP_vrampmul(const float *in, vDSP_Stride is, float *start, const float *step, float *o, vDSP_Stride os, vDSP_Length n)
+{
+    float gain = *start;
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        o[i * os] = gain * in[i * is];
+        gain += *step;
+    }
+    *start = gain;
+}
+
+// 相关：c[k] = sum(a[k + p] * f[p])，p < taps
+inline void vDSP_conv(const float *a, vDSP_Stride ia, const float *f, vDSP_Stride fs, float *c, vDSP_Stride ic, vDSP_Length n, vDSP_Length taps)
+{
+    for (vDSP_Length k = 0; k < n; k++)
+    {
+        float sum = 0;
+        for (vDSP_Length p = 0; p < taps; p++)
+        {
+            sum += a[(k + p) * ia] * f[p * fs];
+        }
+        c[k * ic] = sum;
+    }
+}
+
+// 步长以 float 计，2 表示连续的复数
+inline void vDSP_ctoz(const DSPComplex *c, vDSP_Stride ic, const DSPSplitComplex *z, vDSP_Stride iz, vDSP_Length n)
+{
+    const float *in = reinterpret_cast<const float *>(c);
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        z->realp[i * iz] = in[i * ic];
+        z->imagp[i * iz] = in[i * ic + 1];
+    }
+}
+
+inline void vDSP_ztoc(const DSPSplitComplex *z, vDSP_Stride iz, DSPComplex *c, vDSP_Stride ic, vDSP_Length n)
+{
+    float *out = reinterpret_cast<float *>(c);
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        out[i * ic] = z->realp[i * iz];
+        out[i * ic + 1] = z->imagp[i * iz];
+    }
+}
+
+inline void vDSP_zvmags(const DSPSplitComplex *a, vDSP_Stride ia, float *c, vDSP_Stride ic, vDSP_Length n)
+{
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        float re = a->realp[i * ia];
+        float im = a->imagp[i * ia];
+        c[i * ic] = re * re + im * im;
+    }
+}
+
+inline void vDSP_hann_window(float *c, vDSP_Length n, int flag)
+{
+    // vDSP_HANN_NORM 乘以 sqrt(8/3)，使窗的均方根为 1
+    double scale = flag == vDSP_HANN_NORM ? 0.8165 : 0.5;
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        c[i] = static_cast<float>(scale * (1 - std::cos(2 * kDspPi * i / n)));
+    }
+}
+
+// 级联双二阶滤波器，每级系数为 b0, b1, b2, a1, a2。
+// delay 为 2 * sections + 2 个 float：第 s 级的输入历史在 [2s, 2s+1]，输出历史在 [2s+2, 2s+3]
+struct vDSP_biquad_SetupStruct
+{
+    std::vector<double> coefficients;
+    vDSP_Length sections = 0;
+};
+typedef vDSP_biquad_SetupStruct *vDSP_biquad_Setup;
+
+inline vDSP_biquad_Setup vDSP_biquad_CreateSetup(const double *coefficients, vDSP_Length sections)
+{
+    vDSP_biquad_Setup setup = new vDSP_biquad_SetupStruct();
+    setup->coefficients.assign(coefficients, coefficients + 5 * sections);
+    setup->sections = sections;
+    return setup;
+}
+
+inline void vDSP_biquad_DestroySetup(vDSP_biquad_Setup setup)
+{
+    delete setup;
+}
+
+inline void vDSP_biquad(vDSP_biquad_Setup setup, float *delay, const float *x, vDSP_Stride ix, float *y, vDSP_Stride iy, vDSP_Length n)
+{
+    for (vDSP_Length i = 0; i < n; i++)
+    {
+        double v = x[i * ix];
+        for (vDSP_Length s = 0; s < setup->sections; s++)
+        {
+            const double *c = setup->coefficients.data() + 5 * s;
+            float *h = delay + 2 * s;
+            double out = c[0] * v + c[1] * h[0] + c[2] * h[1] - c[3] * h[2] - c[4] * h[3];
+            h[1] = h[0];
+            h[0] = static_cast<float>(v);
+            v = out;
+        }
+        // 最后一级的输出历史
+        float *h = delay + 2 * setup->sections;
+        h[1] = h[0];
+        h[0] = static_cast<float>(v);
+        y[i * iy] = static_cast<float>(v);
+    }
+}
+
+// 基 2 实数 FFT。正变换输出 2 倍的 DFT，realp[0] 为直流、imagp[0] 为 Nyquist；
+// 逆变换为共轭对称扩展后不归一化的逆 DFT，正逆一次往返放大 2N 倍
+struct OpaqueFFTSetup
+{
+    vDSP_Length log2Max = 0;
+    std::vector<double> cosTable; // cos(2πk/N)，N = 2^log2Max，k < N/2
+    std::vector<double> sinTable;
+};
+typedef OpaqueFFTSetup *FFTSetup;
+
+inline FFTSetup vDSP_create_fftsetup(vDSP_Length log2n, FFTRadix)
+{
+    FFTSetup setup = new OpaqueFFTSetup();
+    setup->log2Max = log2n;
+    size_t half = (static_cast<size_t>(1) << log2n) / 2;
+    setup->cosTable.resize(half);
+    setup->sinTable.resize(half);
+    for (size_t k = 0; k < half; k++)
+    {
+        double angle = 2 * kDspPi * k / (static_cast<double>(half) * 2);
+        setup->cosTable[k] = std::cos(angle);
+        setup->sinTable[k] = std::sin(angle);
+    }
+    return setup;
+}
+
+inline void vDSP_destroy_fftsetup(FFTSetup setup)
+{
+    delete setup;
+}
+
+// 原地复数 FFT（n 为 2 的幂），direction 为 1 时求 e^{-i} 方向
+inline void FftComplexInPlace(const OpaqueFFTSetup &setup, float *re, float *im, vDSP_Stride stride, size_t n, int direction)
+{
+    for (size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j |= bit;
+        if (i < j)
+        {
+            std::swap(re[i * stride], re[j * stride]);
+            std::swap(im[i * stride], im[j * stride]);
+        }
+    }
+
+    size_t tableSize = setup.cosTable.size() * 2;
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        size_t step = tableSize / len;
+        for (size_t start = 0; start < n; start += len)
+        {
+            for (size_t k = 0; k < len / 2; k++)
+            {
+                double wr = setup.cosTable[k * step];
+                double wi = -direction * setup.sinTable[k * step];
+                size_t a = (start + k) * stride;
+                size_t b = (start + k + len / 2) * stride;
+                double tr = wr * re[b] - wi * im[b];
+                double ti = wr * im[b] + wi * re[b];
+                re[b] = static_cast<float>(re[a] - tr);
+                im[b] = static_cast<float>(im[a] - ti);
+                re[a] = static_cast<float>(re[a] + tr);
+                im[a] = static_cast<float>(im[a] + ti);
+            }
+        }
+    }
+}
+
+inline void vDSP_fft_zrip(FFTSetup setup, const DSPSplitComplex *c, vDSP_Stride stride, vDSP_Length log2n, FFTDirection direction)
+{
+    size_t n = static_cast<size_t>(1) << log2n;
+    size_t half = n / 2;
+    float *re = c->realp;
+    float *im = c->imagp;
+    size_t step = setup->cosTable.size() * 2 / n;
+
+    if (direction == kFFTDirection_Forward)
+    {
+        FftComplexInPlace(*setup, re, im, stride, half, 1);
+        // 由 n/2 点复数结果拆出实数序列的频谱：2X[k] = (Z[k] + Z*[h-k]) - i·W^k·(Z[k] - Z*[h-k])
+        double dc = re[0];
+        double nyquist = im[0];
+        re[0] = static_cast<float>(2 * (dc + nyquist));
+        im[0] = static_cast<float>(2 * (dc - nyquist));
+        for (size_t k = 1; k <= half / 2; k++)
+        {
+            size_t m = half - k;
+            double ar = re[k * stride], ai = im[k * stride];
+            double br = re[m * stride], bi = im[m * stride];
+            double er = ar + br, ei = ai - bi; // Z[k] + Z*[m]
+            double dr = ar - br, di = ai + bi; // Z[k] - Z*[m]
+            double wr = setup->cosTable[k * step], wi = -setup->sinTable[k * step];
+            // -i·W·d
+            double tr = wr * di + wi * dr;
+            double ti = -(wr * dr - wi * di);
+            re[k * stride] = static_cast<float>(er + tr);
+            im[k * stride] = static_cast<float>(ei + ti);
+            if (m != k)
+            {
+                // 对称位置：Z[m] + Z*[k] = e*，W^m = -conj(W^k)
+                re[m * stride] = static_cast<float>(er - tr);
+                im[m * stride] = static_cast<float>(-ei + ti);
+            }
+        }
+        return;
+    }
+
+    // 逆变换：先合成 n/2 点复数谱 Z[k] = (Y[k] + Y*[h-k]) + i·W^-k·(Y[k] - Y*[h-k])
+    double dc = re[0];
+    double nyquist = im[0];
+    re[0] = static_cast<float>(dc + nyquist);
+    im[0] = static_cast<float>(dc - nyquist);
+    for (size_t k = 1; k <= half / 2; k++)
+    {
+        size_t m = half - k;
+        double ar = re[k * stride], ai = im[k * stride];
+        double br = re[m * stride], bi = im[m * stride];
+        double er = ar + br, ei = ai - bi;
+        double dr = ar - br, di = ai + bi;
+        double wr = setup->cosTable[k * step], wi = setup->sinTable[k * step]; // W^-k
+        // i·W^-k·d
+        double tr = -(wr * di + wi * dr);
+        double ti = wr * dr - wi * di;
+        re[k * stride] = static_cast<float>(er + tr);
+        im[k * stride] = static_cast<float>(ei + ti);
+        if (m != k)
+        {
+            re[m * stride] = static_cast<float>(er - tr);
+            im[m * stride] = static_cast<float>(-ei + ti);
+        }
+    }
+    FftComplexInPlace(*setup, re, im, stride, half, -1);
+}
+#endif
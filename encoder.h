@@ -0,0 +1,387 @@
+// encoder.h
+#pragma once
+#include <AudioToolbox/AudioToolbox.h>
+#include <dispatch/dispatch.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ring_buffer.h"
+#include "timestamps.h"
+
+enum class Codec
+{
+    Aac,
+    Opus,
+};
+
+struct EncoderOptions
+{
+    Codec codec = Codec::Aac;
+    UInt32 bitrate = 64000;
+    bool adts = false; // 仅 AAC：每个包前加 ADTS 头，便于直接拼接成 .aac 流
+};
+
+inline bool ParseCodec(const std::string &name, Codec &codec)
+{
+    if (name == "aac")
+    {
+        codec = Codec::Aac;
+    }
+    else if (name == "opus")
+    {
+        codec = Codec::Opus;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// 基于 AudioConverter 的 AAC/Opus 编码器，在独立线程上编码。
+// 投递线程写入交错 Float32，编码线程每凑够一个包的帧数就编码并通过回调交出数据包。
+// 编码器输出的开头有 primingFrames 帧的预滚（AAC 通常为 2112），pts 已减去这部分，
+// 因此前几个包的 pts 为负，pts 为 0 的帧就是写入的第一帧
+class AudioEncoder
+{
+public:
+    // data/size 为编码后的包（已含 ADTS 头），pts 为包首帧在输入中的序号，frames 为包含的帧数，
+    // hostTimeNs 为该帧的主机时间（0 表示未知）
+    using PacketCallback = std::function<void(const uint8_t *data, size_t size, int64_t pts, UInt32 frames, uint64_t hostTimeNs)>;
+
+private:
+    static constexpr OSStatus kNoMoreInput = 'none';
+    static constexpr UInt32 kRingSeconds = 4;
+    static constexpr UInt32 kAdtsHeaderBytes = 7;
+
+    EncoderOptions options;
+    UInt32 sampleRate = 0;
+    UInt32 channels = 0;
+    AudioConverterRef converter = nullptr;
+    UInt32 framesPerPacket = 0;
+    UInt32 maxPacketBytes = 0;
+    PacketCallback onPacket;
+
+    RingBuffer ring;
+    std::vector<Float32> input;
+    UInt32 inputOffset = 0;
+    UInt32 inputPending = 0;
+    bool flushing = false;
+    std::vector<uint8_t> output;
+    uint64_t packetIndex = 0;
+    std::vector<uint8_t> magicCookie;
+    UInt32 primingFrames = 0;
+    UInt32 remainderFrames = 0;
+
+    // 投递线程写入时记录 (输入帧序号, 时间) 锚点，编码线程据此换算每个包首帧的主机时间
+    TimestampTrack timestamps;
+    uint64_t writtenFrames = 0; // 投递线程
+
+    dispatch_semaphore_t dataReady = nullptr;
+    std::atomic<bool> running{false};
+    std::thread thread;
+
+    std::atomic<uint64_t> packetCount{0};
+    std::atomic<uint64_t> overflowFrames{0};
+    std::atomic<OSStatus> lastError{noErr};
+
+    static OSStatus InputProc(AudioConverterRef,
+                              UInt32 *ioNumberDataPackets,
+                              AudioBufferList *ioData,
+                              AudioStreamPacketDescription **,
+                              void *inUserData)
+    {
+        AudioEncoder *self = static_cast<AudioEncoder *>(inUserData);
+        if (self->inputPending == 0)
+        {
+            *ioNumberDataPackets = 0;
+            // 结束时返回 noErr + 0 包表示流结束，让编码器吐出剩余数据
+            return self->flushing ? noErr : kNoMoreInput;
+        }
+
+        UInt32 frames = *ioNumberDataPackets < self->inputPending ? *ioNumberDataPackets : self->inputPending;
+        ioData->mNumberBuffers = 1;
+        ioData->mBuffers[0].mNumberChannels = self->channels;
+        ioData->mBuffers[0].mDataByteSize = frames * self->channels * sizeof(Float32);
+        ioData->mBuffers[0].mData = self->input.data() + static_cast<size_t>(self->inputOffset) * self->channels;
+        self->inputOffset += frames;
+        self->inputPending -= frames;
+        *ioNumberDataPackets = frames;
+        return noErr;
+    }
+
+    static int AdtsSampleRateIndex(UInt32 rate)
+    {
+        static const UInt32 rates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350};
+        for (int i = 0; i < 13; i++)
+        {
+            if (rates[i] == rate)
+            {
+                return i;
+            }
+        }
+        return 15;
+    }
+
+    // AAC-LC 的 7 字节 ADTS 头（无 CRC）
+    void WriteAdtsHeader(uint8_t *h, size_t payloadBytes) const
+    {
+        size_t length = payloadBytes + kAdtsHeaderBytes;
+        int rateIndex = AdtsSampleRateIndex(sampleRate);
+        h[0] = 0xFF;
+        h[1] = 0xF1;
+        h[2] = static_cast<uint8_t>((1 << 6) | (rateIndex << 2) | ((channels >> 2) & 0x1));
+        h[3] = static_cast<uint8_t>(((channels & 0x3) << 6) | ((length >> 11) & 0x3));
+        h[4] = static_cast<uint8_t>((length >> 3) & 0xFF);
+        h[5] = static_cast<uint8_t>(((length & 0x7) << 5) | 0x1F);
+        h[6] = 0xFC;
+    }
+
+    // 编码当前输入，直到编码器要求更多数据
+    void Encode()
+    {
+        size_t headerBytes = options.adts ? kAdtsHeaderBytes : 0;
+        for (;;)
+        {
+            UInt32 packets = 1;
+            AudioBufferList bufferList;
+            bufferList.mNumberBuffers = 1;
+            bufferList.mBuffers[0].mNumberChannels = channels;
+            bufferList.mBuffers[0].mDataByteSize = maxPacketBytes;
+            bufferList.mBuffers[0].mData = output.data() + headerBytes;
+            AudioStreamPacketDescription description;
+
+            OSStatus status = AudioConverterFillComplexBuffer(converter, InputProc, this, &packets, &bufferList, &description);
+            if (packets > 0 && bufferList.mBuffers[0].mDataByteSize > 0)
+            {
+                size_t payload = bufferList.mBuffers[0].mDataByteSize;
+                if (options.adts)
+                {
+                    WriteAdtsHeader(output.data(), payload);
+                }
+                int64_t pts = static_cast<int64_t>(packetIndex * framesPerPacket) - primingFrames;
+                packetIndex++;
+                packetCount.fetch_add(1, std::memory_order_relaxed);
+                if (onPacket)
+                {
+                    onPacket(output.data(), payload + headerBytes, pts, framesPerPacket, HostTimeAt(pts));
+                }
+            }
+
+            // 真正的编码错误同样没有输出包，先记录再返回
+            if (status != noErr && status != kNoMoreInput)
+            {
+                lastError.store(status);
+                return;
+            }
+            if (status == kNoMoreInput || packets == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    // 编码线程：输入第 frame 帧的主机时间，预滚部分从第一帧往前外推
+    uint64_t HostTimeAt(int64_t frame) const
+    {
+        ChunkTime time;
+        if (!timestamps.Lookup(frame > 0 ? static_cast<uint64_t>(frame) : 0, time) || time.hostTimeNs == 0)
+        {
+            return 0;
+        }
+        if (frame >= 0)
+        {
+            return time.hostTimeNs;
+        }
+        uint64_t lead = static_cast<uint64_t>(-frame * 1e9 / sampleRate);
+        return time.hostTimeNs > lead ? time.hostTimeNs - lead : 0;
+    }
+
+    void Loop()
+    {
+        while (running.load(std::memory_order_acquire))
+        {
+            dispatch_semaphore_wait(dataReady, dispatch_time(DISPATCH_TIME_NOW, 100 * NSEC_PER_MSEC));
+            while (ring.AvailableRead() >= framesPerPacket)
+            {
+                inputOffset = 0;
+                inputPending = ring.Read(input.data(), framesPerPacket);
+                Encode();
+            }
+        }
+
+        // 编码剩余不足一包的数据，然后冲刷编码器
+        inputOffset = 0;
+        inputPending = ring.Read(input.data(), framesPerPacket);
+        flushing = true;
+        Encode();
+    }
+
+public:
+    AudioEncoder() = default;
+    AudioEncoder(const AudioEncoder &) = delete;
+    AudioEncoder &operator=(const AudioEncoder &) = delete;
+
+    ~AudioEncoder()
+    {
+        Close();
+        if (dataReady)
+        {
+            dispatch_release(dataReady);
+        }
+    }
+
+    // 创建编码器并启动编码线程，失败时返回 OSStatus
+    OSStatus Open(const EncoderOptions &encoderOptions, UInt32 rate, UInt32 numChannels, PacketCallback callback)
+    {
+        options = encoderOptions;
+        sampleRate = rate;
+        channels = numChannels;
+        onPacket = std::move(callback);
+        if (options.codec != Codec::Aac)
+        {
+            options.adts = false;
+        }
+
+        AudioStreamBasicDescription inputFormat = {};
+        inputFormat.mSampleRate = rate;
+        inputFormat.mFormatID = kAudioFormatLinearPCM;
+        inputFormat.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
+        inputFormat.mFramesPerPacket = 1;
+        inputFormat.mChannelsPerFrame = channels;
+        inputFormat.mBitsPerChannel = 32;
+        inputFormat.mBytesPerFrame = channels * sizeof(Float32);
+        inputFormat.mBytesPerPacket = inputFormat.mBytesPerFrame;
+
+        AudioStreamBasicDescription outputFormat = {};
+        outputFormat.mSampleRate = rate;
+        outputFormat.mFormatID = options.codec == Codec::Aac ? kAudioFormatMPEG4AAC : kAudioFormatOpus;
+        outputFormat.mChannelsPerFrame = channels;
+        outputFormat.mFramesPerPacket = options.codec == Codec::Aac ? 1024 : rate / 50;
+
+        OSStatus status = AudioConverterNew(&inputFormat, &outputFormat, &converter);
+        if (status != noErr)
+        {
+            converter = nullptr;
+            return status;
+        }
+
+        UInt32 bitrate = options.bitrate;
+        AudioConverterSetProperty(converter, kAudioConverterEncodeBitRate, sizeof(bitrate), &bitrate);
+
+        // 以编码器实际采用的格式为准
+        UInt32 size = sizeof(outputFormat);
+        AudioConverterGetProperty(converter, kAudioConverterCurrentOutputStreamDescription, &size, &outputFormat);
+        framesPerPacket = outputFormat.mFramesPerPacket > 0 ? outputFormat.mFramesPerPacket : 1024;
+
+        // 编码器输出开头的预滚和结尾的补齐帧数，解码端据此裁掉（如 MP4 的 edit list）
+        AudioConverterPrimeInfo primeInfo = {};
+        size = sizeof(primeInfo);
+        if (AudioConverterGetProperty(converter, kAudioConverterPrimeInfo, &size, &primeInfo) == noErr)
+        {
+            primingFrames = primeInfo.leadingFrames;
+            remainderFrames = primeInfo.trailingFrames;
+        }
+        else
+        {
+            primingFrames = 0;
+            remainderFrames = 0;
+        }
+
+        size = sizeof(maxPacketBytes);
+        if (AudioConverterGetProperty(converter, kAudioConverterPropertyMaximumOutputPacketSize, &size, &maxPacketBytes) != noErr ||
+            maxPacketBytes == 0)
+        {
+            maxPacketBytes = 8192;
+        }
+
+        // 解码端需要的配置（AAC 为 AudioSpecificConfig），编码器释放后仍可查询
+        magicCookie.clear();
+        size = 0;
+        if (AudioConverterGetPropertyInfo(converter, kAudioConverterCompressionMagicCookie, &size, nullptr) == noErr && size > 0)
+        {
+            magicCookie.resize(size);
+            if (AudioConverterGetProperty(converter, kAudioConverterCompressionMagicCookie, &size, magicCookie.data()) == noErr)
+            {
+                magicCookie.resize(size);
+            }
+            else
+            {
+                magicCookie.clear();
+            }
+        }
+
+        output.resize(maxPacketBytes + kAdtsHeaderBytes);
+        input.resize(static_cast<size_t>(framesPerPacket) * channels);
+        ring.Allocate(rate * kRingSeconds, channels);
+        inputOffset = 0;
+        inputPending = 0;
+        flushing = false;
+        packetIndex = 0;
+        timestamps.Reset(rate, rate);
+        writtenFrames = 0;
+        packetCount.store(0);
+        overflowFrames.store(0);
+        lastError.store(noErr);
+
+        if (!dataReady)
+        {
+            dataReady = dispatch_semaphore_create(0);
+        }
+        running.store(true, std::memory_order_release);
+        thread = std::thread(&AudioEncoder::Loop, this);
+        return noErr;
+    }
+
+    // 投递线程：写入交错 Float32 采样，time 为首帧的时间
+    void Write(const Float32 *samples, size_t frames, const ChunkTime &time)
+    {
+        UInt32 written = ring.Write(samples, static_cast<UInt32>(frames));
+        if (written < frames)
+        {
+            overflowFrames.fetch_add(frames - written, std::memory_order_relaxed);
+        }
+        if (written > 0)
+        {
+            TimestampTrack::Anchor anchor;
+            anchor.ringFrame = writtenFrames;
+            anchor.time = time;
+            timestamps.Push(anchor);
+            writtenFrames += written;
+        }
+        dispatch_semaphore_signal(dataReady);
+    }
+
+    // 编码剩余数据并释放编码器，最后的数据包在返回前通过回调交出
+    void Close()
+    {
+        if (thread.joinable())
+        {
+            running.store(false, std::memory_order_release);
+            dispatch_semaphore_signal(dataReady);
+            thread.join();
+        }
+        if (converter)
+        {
+            AudioConverterDispose(converter);
+            converter = nullptr;
+        }
+    }
+
+    const EncoderOptions &Options() const { return options; }
+    UInt32 SampleRate() const { return sampleRate; }
+    UInt32 Channels() const { return channels; }
+    UInt32 FramesPerPacket() const { return framesPerPacket; }
+    UInt32 PrimingFrames() const { return primingFrames; }
+    UInt32 RemainderFrames() const { return remainderFrames; }
+    const std::vector<uint8_t> &MagicCookie() const { return magicCookie; }
+    // 含 ADTS 头的单个数据包的最大字节数
+    size_t MaxPacketBytes() const { return maxPacketBytes + kAdtsHeaderBytes; }
+    uint64_t PacketCount() const { return packetCount.load(std::memory_order_relaxed); }
+    uint64_t OverflowFrames() const { return overflowFrames.load(std::memory_order_relaxed); }
+    OSStatus LastError() const { return lastError.load(); }
+};
@@ -0,0 +1,516 @@
+// file_writer.h
+#pragma once
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h>
+#include <malloc.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ring_buffer.h"
+#include "sample_format.h"
+#include "wake_event.h"
+
+// 文件 I/O 的平台差异：Windows 的 CRT 没有 pwrite/fsync/posix_memalign
+#if defined(_WIN32)
+inline int FileOpen(const std::string &path)
+{
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+inline long long FileWrite(int fd, const void *data, size_t size)
+{
+    return _write(fd, data, static_cast<unsigned int>(size));
+}
+
+// 只在 I/O 线程上调用，写完后回到文件末尾继续追加
+inline long long FileWriteAt(int fd, const void *data, size_t size, long long offset)
+{
+    long long end = _lseeki64(fd, 0, SEEK_END);
+    if (end < 0 || _lseeki64(fd, offset, SEEK_SET) < 0)
+    {
+        return -1;
+    }
+    long long n = _write(fd, data, static_cast<unsigned int>(size));
+    _lseeki64(fd, end, SEEK_SET);
+    return n;
+}
+
+inline void FileSync(int fd) { _commit(fd); }
+inline int FileClose(int fd) { return _close(fd); }
+inline void *AlignedAlloc(size_t alignment, size_t size) { return _aligned_malloc(size, alignment); }
+inline void AlignedFree(void *p) { _aligned_free(p); }
+#else
+inline int FileOpen(const std::string &path)
+{
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+inline long long FileWrite(int fd, const void *data, size_t size)
+{
+    return write(fd, data, size);
+}
+
+inline long long FileWriteAt(int fd, const void *data, size_t size, long long offset)
+{
+    return pwrite(fd, data, size, static_cast<off_t>(offset));
+}
+
+inline void FileSync(int fd) { fsync(fd); }
+inline int FileClose(int fd) { return close(fd); }
+
+inline void *AlignedAlloc(size_t alignment, size_t size)
+{
+    void *p = nullptr;
+    return posix_memalign(&p, alignment, size) == 0 ? p : nullptr;
+}
+
+inline void AlignedFree(void *p) { free(p); }
+#endif
+
+// 文件容器格式
+enum class FileContainer
+{
+    Wav,
+    Caf, // 数据块长度可以写成“未知”，没有 4GB 限制，适合长时间录制
+};
+
+// fsync 策略
+enum class SyncPolicy
+{
+    None,   // 只在关闭时写回头部，不主动 fsync
+    Header, // 每次回写头部后 fsync
+    Always, // 每次写入数据块后 fsync
+};
+
+struct FileWriterOptions
+{
+    std::string path;
+    FileContainer container = FileContainer::Wav;
+    SampleFormat sample = SampleFormat::Int16;
+    SyncPolicy sync = SyncPolicy::Header;
+    uint32_t headerIntervalMs = 1000;
+};
+
+inline bool ParseFileContainer(const std::string &name, FileContainer &container)
+{
+    if (name == "wav")
+    {
+        container = FileContainer::Wav;
+    }
+    else if (name == "caf")
+    {
+        container = FileContainer::Caf;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+inline bool ParseSyncPolicy(const std::string &name, SyncPolicy &policy)
+{
+    if (name == "none")
+    {
+        policy = SyncPolicy::None;
+    }
+    else if (name == "header")
+    {
+        policy = SyncPolicy::Header;
+    }
+    else if (name == "always")
+    {
+        policy = SyncPolicy::Always;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// 在独立 I/O 线程上把采样流式写入 WAV/CAF 文件。
+// 投递线程把 Float32 写入内部环形缓冲区，I/O 线程负责格式转换、
+// 以对齐的大块写盘，并定期回写头部中的长度，异常退出时文件仍然可读。
+class FileWriter
+{
+private:
+    static constexpr size_t kBlockBytes = 256 * 1024;
+    static constexpr size_t kAlignment = 4096;
+    static constexpr uint32_t kHeaderBytes = 4096;
+    static constexpr uint32_t kRingSeconds = 8;
+
+    FileWriterOptions options;
+    uint32_t sampleRate = 0;
+    uint32_t channels = 0;
+    int fd = -1;
+
+    RingBuffer ring;
+    SampleConverter converter;
+    std::vector<float> readBuffer;
+    uint8_t *block = nullptr;
+    size_t blockBytes = 0; // 帧长与 4KB 的公倍数，使每次整块写入都落在对齐边界
+    size_t blockUsed = 0;
+
+    WakeEvent dataReady;
+    std::atomic<bool> running{false};
+    std::thread thread;
+
+    std::atomic<uint64_t> dataBytes{0};
+    std::atomic<uint64_t> overflowFrames{0};
+    std::atomic<int> lastError{0};
+
+    static void Put16(uint8_t *p, uint16_t v)
+    {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    static void Put32(uint8_t *p, uint32_t v)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            p[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+    }
+
+    static void Put16BE(uint8_t *p, uint16_t v)
+    {
+        p[0] = static_cast<uint8_t>(v >> 8);
+        p[1] = static_cast<uint8_t>(v);
+    }
+
+    static void Put32BE(uint8_t *p, uint32_t v)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            p[i] = static_cast<uint8_t>(v >> (24 - 8 * i));
+        }
+    }
+
+    static void Put64BE(uint8_t *p, uint64_t v)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            p[i] = static_cast<uint8_t>(v >> (56 - 8 * i));
+        }
+    }
+
+    uint32_t BytesPerSample() const
+    {
+        OutputFormat format;
+        format.sample = options.sample;
+        return static_cast<uint32_t>(format.BytesPerSample());
+    }
+
+    // 生成固定 kHeaderBytes 字节的头部，用填充块把音频数据对齐到 4KB 边界；
+    // written 为已写入的数据字节数，UINT64_MAX 表示未知（仅 CAF）
+    std::vector<uint8_t> BuildHeader(uint64_t written) const
+    {
+        uint32_t bytesPerSample = BytesPerSample();
+        uint32_t blockAlign = bytesPerSample * channels;
+        bool isFloat = options.sample == SampleFormat::Float32;
+        std::vector<uint8_t> h(kHeaderBytes, 0);
+
+        if (options.container == FileContainer::Wav)
+        {
+            // RIFF + fmt 块 [+ fact 块] + JUNK 填充块 + data 块头。
+            // s16 用普通的 WAVE_FORMAT_PCM；s24 和 f32 用 WAVE_FORMAT_EXTENSIBLE 并给出 SubFormat，
+            // 浮点是非 PCM 格式，另加 fact 块记录帧数
+            uint64_t maxData = 0xFFFFFFFFull - (kHeaderBytes - 8);
+            uint32_t dataSize = static_cast<uint32_t>(written > maxData ? maxData : written);
+            bool extensible = options.sample != SampleFormat::Int16;
+            memcpy(&h[0], "RIFF", 4);
+            Put32(&h[4], kHeaderBytes - 8 + dataSize);
+            memcpy(&h[8], "WAVEfmt ", 8);
+            Put32(&h[16], extensible ? 40 : 16);
+            Put16(&h[20], extensible ? 0xFFFE : 1); // WAVE_FORMAT_EXTENSIBLE / WAVE_FORMAT_PCM
+            Put16(&h[22], static_cast<uint16_t>(channels));
+            Put32(&h[24], sampleRate);
+            Put32(&h[28], sampleRate * blockAlign);
+            Put16(&h[32], static_cast<uint16_t>(blockAlign));
+            Put16(&h[34], static_cast<uint16_t>(bytesPerSample * 8));
+            size_t offset = 36;
+            if (extensible)
+            {
+                // cbSize、有效位数、声道掩码（单声道为 FRONT_CENTER，立体声为 FRONT_LEFT | FRONT_RIGHT）和 SubFormat GUID，
+                // KSDATAFORMAT_SUBTYPE_PCM / IEEE_FLOAT 只有第一个字节不同
+                static const uint8_t kSubFormat[16] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+                                                       0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+                Put16(&h[36], 22);
+                Put16(&h[38], static_cast<uint16_t>(bytesPerSample * 8));
+                Put32(&h[40], channels == 1 ? 0x4 : 0x3);
+                memcpy(&h[44], kSubFormat, sizeof(kSubFormat));
+                h[44] = isFloat ? 0x03 : 0x01;
+                offset = 60;
+            }
+            if (isFloat)
+            {
+                memcpy(&h[offset], "fact", 4);
+                Put32(&h[offset + 4], 4);
+                Put32(&h[offset + 8], blockAlign > 0 ? dataSize / blockAlign : 0);
+                offset += 12;
+            }
+            memcpy(&h[offset], "JUNK", 4);
+            Put32(&h[offset + 4], static_cast<uint32_t>(kHeaderBytes - 8 - (offset + 8)));
+            memcpy(&h[kHeaderBytes - 8], "data", 4);
+            Put32(&h[kHeaderBytes - 4], dataSize);
+            return h;
+        }
+
+        // CAF：文件头 + desc 块 + free 填充块 + data 块（数据前有 4 字节 editCount）
+        memcpy(&h[0], "caff", 4);
+        Put16BE(&h[4], 1); // 版本 1
+        memcpy(&h[8], "desc", 4);
+        Put64BE(&h[12], 32);
+        double rate = static_cast<double>(sampleRate);
+        uint64_t rateBits;
+        memcpy(&rateBits, &rate, sizeof(rateBits));
+        Put64BE(&h[20], rateBits);
+        memcpy(&h[28], "lpcm", 4);
+        Put32BE(&h[32], (isFloat ? 1u : 0u) | 2u); // kCAFLinearPCMFormatFlagIsFloat | IsLittleEndian
+        Put32BE(&h[36], blockAlign);
+        Put32BE(&h[40], 1);
+        Put32BE(&h[44], channels);
+        Put32BE(&h[48], bytesPerSample * 8);
+        memcpy(&h[52], "free", 4);
+        Put64BE(&h[56], kHeaderBytes - 64 - 16);
+        memcpy(&h[kHeaderBytes - 16], "data", 4);
+        Put64BE(&h[kHeaderBytes - 12], written == UINT64_MAX ? UINT64_MAX : written + 4);
+        return h;
+    }
+
+    bool WriteAll(const uint8_t *data, size_t size)
+    {
+        while (size > 0)
+        {
+            long long n = FileWrite(fd, data, size);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                lastError.store(errno);
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void PatchHeader(bool final)
+    {
+        // CAF 在写入过程中保持“未知长度”，读取方按文件长度推断，只需在关闭时回写
+        if (options.container == FileContainer::Wav || final)
+        {
+            std::vector<uint8_t> header = BuildHeader(dataBytes.load(std::memory_order_relaxed));
+            if (FileWriteAt(fd, header.data(), header.size(), 0) < 0)
+            {
+                lastError.store(errno);
+                return;
+            }
+        }
+        if (options.sync != SyncPolicy::None || final)
+        {
+            FileSync(fd);
+        }
+    }
+
+    void FlushBlock()
+    {
+        if (blockUsed == 0)
+        {
+            return;
+        }
+        if (WriteAll(block, blockUsed))
+        {
+            dataBytes.fetch_add(blockUsed, std::memory_order_relaxed);
+            if (options.sync == SyncPolicy::Always)
+            {
+                FileSync(fd);
+            }
+        }
+        blockUsed = 0;
+    }
+
+    // 把环形缓冲区中的数据转换后追加到写块，写满一块就落盘
+    void Drain()
+    {
+        size_t frameBytes = BytesPerSample() * channels;
+        for (;;)
+        {
+            size_t room = (blockBytes - blockUsed) / frameBytes;
+            uint32_t frames = ring.Read(readBuffer.data(), static_cast<uint32_t>(room));
+            if (frames == 0)
+            {
+                return;
+            }
+            converter.Convert(readBuffer.data(), frames, channels, block + blockUsed);
+            blockUsed += frames * frameBytes;
+            if (blockUsed == blockBytes)
+            {
+                FlushBlock();
+            }
+        }
+    }
+
+    void Loop()
+    {
+        using Clock = std::chrono::steady_clock;
+        auto lastPatch = Clock::now();
+        const auto interval = std::chrono::milliseconds(options.headerIntervalMs);
+
+        while (running.load(std::memory_order_acquire))
+        {
+            dataReady.Wait(100 * 1000000LL);
+            Drain();
+
+            // 头部只记录已经整块落盘的数据，写盘始终保持 256KB 对齐
+            if (options.headerIntervalMs > 0 && Clock::now() - lastPatch >= interval)
+            {
+                PatchHeader(false);
+                lastPatch = Clock::now();
+            }
+        }
+
+        Drain();
+        FlushBlock();
+        PatchHeader(true);
+    }
+
+public:
+    FileWriter() = default;
+    FileWriter(const FileWriter &) = delete;
+    FileWriter &operator=(const FileWriter &) = delete;
+
+    ~FileWriter()
+    {
+        Close();
+    }
+
+    // 打开文件并启动 I/O 线程，失败时返回 errno
+    int Open(const FileWriterOptions &writerOptions, uint32_t rate, uint32_t numChannels)
+    {
+        options = writerOptions;
+        sampleRate = rate;
+        channels = numChannels;
+
+        fd = FileOpen(options.path);
+        if (fd < 0)
+        {
+            return errno;
+        }
+
+        std::vector<uint8_t> header = BuildHeader(options.container == FileContainer::Caf ? UINT64_MAX : 0);
+        if (!WriteAll(header.data(), header.size()))
+        {
+            int error = lastError.load();
+            FileClose(fd);
+            fd = -1;
+            return error;
+        }
+
+        size_t frameBytes = BytesPerSample() * channels;
+        size_t unit = kAlignment;
+        while (unit % frameBytes != 0)
+        {
+            unit += kAlignment;
+        }
+        blockBytes = kBlockBytes / unit * unit;
+        block = static_cast<uint8_t *>(AlignedAlloc(kAlignment, blockBytes));
+        if (!block)
+        {
+            FileClose(fd);
+            fd = -1;
+            return ENOMEM;
+        }
+        blockUsed = 0;
+
+        OutputFormat format;
+        format.sample = options.sample;
+        converter.SetFormat(format);
+        ring.Allocate(rate * kRingSeconds, channels);
+        readBuffer.resize(blockBytes / frameBytes * channels);
+        dataBytes.store(0);
+        overflowFrames.store(0);
+        lastError.store(0);
+
+        running.store(true, std::memory_order_release);
+        thread = std::thread(&FileWriter::Loop, this);
+        return 0;
+    }
+
+    // 同步把一段已是 options.sample 格式的交错数据写成完整的文件，不启动 I/O 线程。
+    // 在工作线程上调用，失败时返回 errno
+    int WriteComplete(const FileWriterOptions &writerOptions, uint32_t rate, uint32_t numChannels, const uint8_t *data, size_t bytes)
+    {
+        options = writerOptions;
+        sampleRate = rate;
+        channels = numChannels;
+        lastError.store(0);
+
+        fd = FileOpen(options.path);
+        if (fd < 0)
+        {
+            return errno;
+        }
+        std::vector<uint8_t> header = BuildHeader(bytes);
+        bool written = WriteAll(header.data(), header.size()) && WriteAll(data, bytes);
+        if (written && options.sync != SyncPolicy::None)
+        {
+            FileSync(fd);
+        }
+        FileClose(fd);
+        fd = -1;
+        return written ? 0 : lastError.load();
+    }
+
+    // 投递线程：写入交错 Float32 采样，I/O 跟不上时丢弃并计数
+    void Write(const float *samples, size_t frames)
+    {
+        uint32_t written = ring.Write(samples, static_cast<uint32_t>(frames));
+        if (written < frames)
+        {
+            overflowFrames.fetch_add(frames - written, std::memory_order_relaxed);
+        }
+        dataReady.Signal();
+    }
+
+    // 写完剩余数据、回写最终头部并关闭文件
+    void Close()
+    {
+        if (thread.joinable())
+        {
+            running.store(false, std::memory_order_release);
+            dataReady.Signal();
+            thread.join();
+        }
+        if (fd >= 0)
+        {
+            FileClose(fd);
+            fd = -1;
+        }
+        if (block)
+        {
+            AlignedFree(block);
+            block = nullptr;
+        }
+    }
+
+    uint64_t BytesWritten() const { return dataBytes.load(std::memory_order_relaxed); }
+    uint64_t OverflowFrames() const { return overflowFrames.load(std::memory_order_relaxed); }
+    int LastError() const { return lastError.load(); }
+};
@@ -0,0 +1,102 @@
+// history_buffer.h
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include "sample_format.h"
+#include "timestamps.h"
+
+// 回溯缓冲区：固定内存保存最近 N 秒的采集数据（交错 f32 或 s16，s16 占用减半），
+// 投递线程持续覆盖写入，snapshot 在工作线程上复制出最近的一段，不打断采集。
+// 复制期间持锁，投递线程最多被阻塞一次内存复制的时间，由采集环形缓冲区吸收
+class HistoryBuffer
+{
+private:
+    uint32_t sampleRate = 0;
+    uint32_t channels = 0;
+    size_t frameBytes = 0;
+    size_t capacityFrames = 0;
+    std::vector<uint8_t> storage;
+    SampleConverter converter;
+
+    std::mutex mutex;
+    size_t writePos = 0; // 帧
+    size_t filled = 0;
+    ChunkTime endTime;   // 最后写入的一帧之后的下一帧的帧序号和主机时间
+
+public:
+    HistoryBuffer(double seconds, uint32_t rate, uint32_t numChannels, SampleFormat sample)
+        : sampleRate(rate), channels(numChannels)
+    {
+        OutputFormat format;
+        format.sample = sample;
+        converter.SetFormat(format);
+        frameBytes = format.BytesPerSample() * channels;
+        capacityFrames = static_cast<size_t>(seconds * rate);
+        if (capacityFrames == 0)
+        {
+            capacityFrames = 1;
+        }
+        storage.assign(capacityFrames * frameBytes, 0);
+    }
+
+    HistoryBuffer(const HistoryBuffer &) = delete;
+    HistoryBuffer &operator=(const HistoryBuffer &) = delete;
+
+    // 投递线程：写入交错 Float32，time 为首帧的时间
+    void Write(const float *samples, uint32_t frames, const ChunkTime &time)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t skip = frames > capacityFrames ? frames - capacityFrames : 0;
+        const float *in = samples + skip * channels;
+        size_t remaining = frames - skip;
+        while (remaining > 0)
+        {
+            size_t n = capacityFrames - writePos;
+            if (n > remaining)
+            {
+                n = remaining;
+            }
+            converter.Convert(in, n, channels, storage.data() + writePos * frameBytes);
+            in += n * channels;
+            remaining -= n;
+            writePos = (writePos + n) % capacityFrames;
+        }
+
+        filled = filled + frames - skip > capacityFrames ? capacityFrames : filled + frames - skip;
+        endTime.frame = time.frame + frames;
+        endTime.hostTimeNs = time.hostTimeNs > 0 ? time.hostTimeNs + static_cast<uint64_t>(1e9 * frames / sampleRate) : 0;
+    }
+
+    // 复制最近 frames 帧（不足时为已有的全部）到 out，time 为复制出的首帧的帧序号和主机时间，返回帧数
+    size_t Snapshot(size_t frames, std::vector<uint8_t> &out, ChunkTime &time)
+    {
+        if (frames > capacityFrames)
+        {
+            frames = capacityFrames;
+        }
+        // 在锁外分配，持锁期间只做内存复制
+        out.resize(frames * frameBytes);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (frames > filled)
+        {
+            frames = filled;
+        }
+        size_t start = (writePos + capacityFrames - frames) % capacityFrames;
+        size_t head = capacityFrames - start < frames ? capacityFrames - start : frames;
+        memcpy(out.data(), storage.data() + start * frameBytes, head * frameBytes);
+        memcpy(out.data() + head * frameBytes, storage.data(), (frames - head) * frameBytes);
+        out.resize(frames * frameBytes);
+
+        time.frame = endTime.frame - frames;
+        time.hostTimeNs = endTime.hostTimeNs > 0 ? endTime.hostTimeNs - static_cast<uint64_t>(1e9 * frames / sampleRate) : 0;
+        return frames;
+    }
+
+    uint32_t SampleRate() const { return sampleRate; }
+    uint32_t Channels() const { return channels; }
+    SampleFormat Sample() const { return converter.Format().sample; }
+    double CapacitySeconds() const { return static_cast<double>(capacityFrames) / sampleRate; }
+};
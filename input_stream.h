@@ -0,0 +1,136 @@
+// input_stream.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include "capture_source.h"
+#include "ring_buffer.h"
+#include "timestamps.h"
+
+// 第二路输入（麦克风）：由平台后端以输入模式打开（CaptureSourceOptions::input），
+// 按设备的采样率交出立体声 Float32，不做采样率转换。
+// IO 线程写入自己的环形缓冲区并按周期记录 (环形缓冲区帧序号, 主机时间) 锚点，
+// 由投递线程上的 StreamAligner 按主机时间对齐到主采集流
+class InputStream
+{
+public:
+    using Notify = void (*)(void *context);
+
+private:
+    static constexpr uint32_t kChannels = CaptureSource::kChannels;
+    static constexpr uint32_t kMaxFramesPerSlice = 4096;
+
+    std::unique_ptr<CaptureSource> source;
+    double sampleRate = 0;
+    RingBuffer ring;
+    TimestampTrack timestamps;
+    uint64_t writtenFrames = 0; // IO 线程
+    std::atomic<uint64_t> overflowFrames{0};
+    bool running = false;
+
+    Notify notify = nullptr;
+    void *notifyContext = nullptr;
+
+    static void SourceCallback(void *context, const float *samples, uint32_t frames, const CaptureSourceTime &time)
+    {
+        InputStream *stream = static_cast<InputStream *>(context);
+        if (!samples)
+        {
+            return;
+        }
+
+        uint32_t written = stream->ring.Write(samples, frames);
+        if (written < frames)
+        {
+            stream->overflowFrames.fetch_add(frames - written, std::memory_order_relaxed);
+        }
+        if (written > 0 && time.hostTimeNs != 0)
+        {
+            TimestampTrack::Anchor anchor;
+            anchor.ringFrame = stream->writtenFrames;
+            anchor.time.frame = stream->writtenFrames;
+            anchor.time.hostTimeNs = time.hostTimeNs;
+            stream->timestamps.Push(anchor);
+        }
+        stream->writtenFrames += written;
+        if (stream->notify)
+        {
+            stream->notify(stream->notifyContext);
+        }
+    }
+
+public:
+    InputStream() = default;
+    InputStream(const InputStream &) = delete;
+    InputStream &operator=(const InputStream &) = delete;
+
+    ~InputStream()
+    {
+        Close();
+    }
+
+    // 工作线程：打开输入设备 device（空字符串表示系统默认输入设备），ringSeconds 为环形缓冲区的长度，
+    // 每个 IO 周期之后在 IO 线程上调用 onData。失败时返回错误信息
+    std::string Open(const std::string &device, double ringSeconds, Notify onData, void *context)
+    {
+        Close();
+        notify = onData;
+        notifyContext = context;
+
+        CaptureSourceOptions options;
+        options.device = device;
+        options.input = true;
+        source = CreateCaptureSource();
+        std::string error = source->Open(options, SourceCallback, this);
+        if (!error.empty())
+        {
+            source.reset();
+            return error;
+        }
+
+        sampleRate = source->SampleRate();
+        uint32_t sliceFrames = std::max(kMaxFramesPerSlice, source->BufferFrames());
+        ring.Allocate(static_cast<uint32_t>(ringSeconds * sampleRate) + sliceFrames * 2, kChannels);
+        timestamps.Reset(sampleRate, sampleRate);
+        writtenFrames = 0;
+        overflowFrames.store(0);
+        return std::string();
+    }
+
+    std::string Start()
+    {
+        if (!source || running)
+        {
+            return std::string();
+        }
+        std::string error = source->Start();
+        running = error.empty();
+        return error;
+    }
+
+    // 返回后 IO 回调不再运行
+    void Stop()
+    {
+        if (source && running)
+        {
+            source->Stop();
+            running = false;
+        }
+    }
+
+    void Close()
+    {
+        Stop();
+        if (source)
+        {
+            source->Close();
+            source.reset();
+        }
+    }
+
+    double SampleRate() const { return sampleRate; }
+    RingBuffer &Ring() { return ring; }
+    const TimestampTrack &Timestamps() const { return timestamps; }
+    uint64_t OverflowFrames() const { return overflowFrames.load(std::memory_order_relaxed); }
+};
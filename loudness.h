@@ -0,0 +1,403 @@
+// loudness.h
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include "dsp.h"
+
+// 响度与削波统计（ITU-R BS.1770-4 / EBU R128），在投递线程上逐块增量计算：
+// K 计权用两级 vDSP_biquad，按 100 ms 子块累计能量，momentary 为最近 400 ms，short-term 为最近 3 s。
+// integrated 和 loudness range 由直方图（0.1 LU 一格，-70 到 +30 LUFS）随时计算，不需要保留采样。
+// true peak 按 4 倍（96 kHz 以上 2 倍）多相内插后取峰值。Read 可在任意线程调用
+class LoudnessMeter
+{
+public:
+    struct Reading
+    {
+        double momentary = -INFINITY;  // LUFS
+        double shortTerm = -INFINITY;  // LUFS
+        double integrated = -INFINITY; // LUFS
+        double range = 0;              // LU
+        double maxMomentary = -INFINITY;
+        double maxShortTerm = -INFINITY;
+        double truePeak = -INFINITY;   // dBTP
+        double samplePeak = -INFINITY; // dBFS
+        uint64_t clippedSamples = 0;
+        uint64_t frames = 0;
+        double duration = 0; // 秒
+    };
+
+private:
+    static constexpr size_t kChunkFrames = 1024;
+    static constexpr uint32_t kMomentaryBlocks = 4;
+    static constexpr uint32_t kShortTermBlocks = 30;
+    static constexpr double kMinLufs = -70;
+    static constexpr double kMaxLufs = 30;
+    static constexpr double kBinsPerLu = 10;
+    static constexpr size_t kBins = static_cast<size_t>((kMaxLufs - kMinLufs) * kBinsPerLu);
+    static constexpr uint32_t kTapsPerPhase = 12;
+    // 约 -0.001 dBFS，16 位满幅的采样也计入
+    static constexpr float kClipLevel = 0.9999f;
+
+    uint32_t channels = 0;
+    size_t blockFrames = 0;
+
+    // K 计权：每个声道一组延迟状态
+    vDSP_biquad_Setup kWeighting = nullptr;
+    std::vector<float> delay;
+    std::vector<float> weighted;
+    std::vector<float> scratch;
+
+    // 当前 100 ms 子块和最近 kShortTermBlocks 个子块的能量（各声道均方和）
+    std::vector<double> blockSquares;
+    size_t blockFilled = 0;
+    std::vector<double> recentBlocks;
+    size_t recentPos = 0;
+    size_t recentCount = 0;
+
+    // true peak：oversample 个相位，每相 kTapsPerPhase 个系数（已反序，直接用于 vDSP_conv）
+    uint32_t oversample = 1;
+    std::vector<float> phases;
+    std::vector<float> peakInput; // 每个声道 kTapsPerPhase - 1 帧历史 + kChunkFrames 帧
+    std::vector<float> interpolated;
+
+    // 以下由 mutex 保护
+    mutable std::mutex mutex;
+    Reading current;
+    double sampleRate = 0;
+    float truePeak = 0;
+    float samplePeak = 0;
+    std::vector<uint64_t> momentaryCounts;
+    std::vector<double> momentaryEnergy;
+    std::vector<uint64_t> shortTermCounts;
+    std::vector<double> shortTermEnergy;
+
+    static double EnergyToLufs(double energy)
+    {
+        return energy > 0 ? -0.691 + 10 * std::log10(energy) : -INFINITY;
+    }
+
+    static double ToDb(float value)
+    {
+        return value > 0 ? 20 * std::log10(value) : -INFINITY;
+    }
+
+    // -70 LUFS 以下返回 -1（绝对门限），+30 以上归入最后一格
+    static long BinIndex(double lufs)
+    {
+        if (!(lufs >= kMinLufs))
+        {
+            return -1;
+        }
+        long bin = static_cast<long>((lufs - kMinLufs) * kBinsPerLu);
+        return bin < static_cast<long>(kBins) ? bin : static_cast<long>(kBins) - 1;
+    }
+
+    static double BinLufs(size_t bin)
+    {
+        return kMinLufs + (bin + 0.5) / kBinsPerLu;
+    }
+
+    // 直方图中能量高于 relativeLu（相对于全部块的平均能量）的块的平均能量和第一个保留的格
+    static double GatedEnergy(const std::vector<uint64_t> &counts, const std::vector<double> &energy, double relativeLu, size_t &firstBin, uint64_t &count)
+    {
+        uint64_t total = 0;
+        double sum = 0;
+        for (size_t i = 0; i < kBins; i++)
+        {
+            total += counts[i];
+            sum += energy[i];
+        }
+        count = 0;
+        if (total == 0)
+        {
+            return 0;
+        }
+        long gate = BinIndex(EnergyToLufs(sum / total) + relativeLu);
+        firstBin = gate < 0 ? 0 : static_cast<size_t>(gate);
+        sum = 0;
+        for (size_t i = firstBin; i < kBins; i++)
+        {
+            count += counts[i];
+            sum += energy[i];
+        }
+        return count > 0 ? sum / count : 0;
+    }
+
+    void DesignOversampler(double rate)
+    {
+        oversample = rate < 96000 ? 4 : (rate < 192000 ? 2 : 1);
+        phases.assign(static_cast<size_t>(oversample) * kTapsPerPhase, 0.0f);
+        if (oversample == 1)
+        {
+            return;
+        }
+
+        // 截止在原采样率的奈奎斯特频率的加窗 sinc 原型，每个相位归一化为直流增益 1
+        size_t taps = static_cast<size_t>(oversample) * kTapsPerPhase;
+        double center = (taps - 1) / 2.0;
+        std::vector<double> prototype(taps);
+        for (size_t k = 0; k < taps; k++)
+        {
+            double x = (k - center) / oversample;
+            double sinc = x == 0 ? 1 : std::sin(M_PI * x) / (M_PI * x);
+            double w = 2 * M_PI * (k + 0.5) / taps;
+            double window = 0.35875 - 0.48829 * std::cos(w) + 0.14128 * std::cos(2 * w) - 0.01168 * std::cos(3 * w);
+            prototype[k] = sinc * window;
+        }
+        for (uint32_t m = 0; m < oversample; m++)
+        {
+            double sum = 0;
+            for (uint32_t i = 0; i < kTapsPerPhase; i++)
+            {
+                sum += prototype[m + static_cast<size_t>(i) * oversample];
+            }
+            for (uint32_t i = 0; i < kTapsPerPhase; i++)
+            {
+                phases[m * kTapsPerPhase + (kTapsPerPhase - 1 - i)] = static_cast<float>(prototype[m + static_cast<size_t>(i) * oversample] / sum);
+            }
+        }
+    }
+
+    // 100 ms 子块结束：更新 momentary/short-term 和直方图
+    void FinishBlock()
+    {
+        double energy = 0;
+        for (uint32_t ch = 0; ch < channels; ch++)
+        {
+            energy += blockSquares[ch] / blockFrames;
+            blockSquares[ch] = 0;
+        }
+        blockFilled = 0;
+        recentBlocks[recentPos] = energy;
+        recentPos = (recentPos + 1) % kShortTermBlocks;
+        if (recentCount < kShortTermBlocks)
+        {
+            recentCount++;
+        }
+
+        double momentary = 0, shortTerm = 0;
+        for (size_t i = 0; i < recentCount; i++)
+        {
+            double value = recentBlocks[(recentPos + kShortTermBlocks - 1 - i) % kShortTermBlocks];
+            if (i < kMomentaryBlocks)
+            {
+                momentary += value;
+            }
+            shortTerm += value;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (recentCount >= kMomentaryBlocks)
+        {
+            // 门限块为 400 ms，每 100 ms 一个（重叠 75%）
+            momentary /= kMomentaryBlocks;
+            current.momentary = EnergyToLufs(momentary);
+            current.maxMomentary = current.momentary > current.maxMomentary ? current.momentary : current.maxMomentary;
+            long bin = BinIndex(current.momentary);
+            if (bin >= 0)
+            {
+                momentaryCounts[bin]++;
+                momentaryEnergy[bin] += momentary;
+            }
+        }
+        if (recentCount >= kShortTermBlocks)
+        {
+            shortTerm /= kShortTermBlocks;
+            current.shortTerm = EnergyToLufs(shortTerm);
+            current.maxShortTerm = current.shortTerm > current.maxShortTerm ? current.shortTerm : current.maxShortTerm;
+            long bin = BinIndex(current.shortTerm);
+            if (bin >= 0)
+            {
+                shortTermCounts[bin]++;
+                shortTermEnergy[bin] += shortTerm;
+            }
+        }
+    }
+
+    // 一段不超过 kChunkFrames 帧的交错数据
+    void ProcessChunk(const float *in, size_t frames)
+    {
+        float chunkTruePeak = 0, chunkSamplePeak = 0;
+        vDSP_Length clippedLow = 0, clippedHigh = 0;
+        const float low = -kClipLevel, high = kClipLevel;
+        vDSP_vclipc(in, 1, &low, &high, scratch.data(), 1, frames * channels, &clippedLow, &clippedHigh);
+
+        size_t history = kTapsPerPhase - 1;
+        size_t stride = history + kChunkFrames;
+        for (uint32_t ch = 0; ch < channels; ch++)
+        {
+            float peak = 0;
+            vDSP_maxmgv(in + ch, channels, &peak, frames);
+            chunkSamplePeak = peak > chunkSamplePeak ? peak : chunkSamplePeak;
+            vDSP_biquad(kWeighting, delay.data() + ch * 6, in + ch, channels, weighted.data() + ch * kChunkFrames, 1, frames);
+
+            if (oversample > 1)
+            {
+                float *buffer = peakInput.data() + ch * stride;
+                for (size_t i = 0; i < frames; i++)
+                {
+                    buffer[history + i] = in[i * channels + ch];
+                }
+                for (uint32_t m = 0; m < oversample; m++)
+                {
+                    vDSP_conv(buffer, 1, phases.data() + m * kTapsPerPhase, 1, interpolated.data(), 1, frames, kTapsPerPhase);
+                    vDSP_maxmgv(interpolated.data(), 1, &peak, frames);
+                    chunkTruePeak = peak > chunkTruePeak ? peak : chunkTruePeak;
+                }
+                memmove(buffer, buffer + frames, history * sizeof(float));
+            }
+        }
+
+        // K 计权后的能量按 100 ms 子块边界切分
+        size_t offset = 0;
+        while (offset < frames)
+        {
+            size_t n = blockFrames - blockFilled < frames - offset ? blockFrames - blockFilled : frames - offset;
+            for (uint32_t ch = 0; ch < channels; ch++)
+            {
+                float squares = 0;
+                vDSP_svesq(weighted.data() + ch * kChunkFrames + offset, 1, &squares, n);
+                blockSquares[ch] += squares;
+            }
+            offset += n;
+            blockFilled += n;
+            if (blockFilled == blockFrames)
+            {
+                FinishBlock();
+            }
+        }
+        if (oversample == 1)
+        {
+            chunkTruePeak = chunkSamplePeak;
+        }
+        // 内插会滤掉采样本身的一部分峰值，true peak 不低于 sample peak
+        chunkTruePeak = chunkTruePeak > chunkSamplePeak ? chunkTruePeak : chunkSamplePeak;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        truePeak = chunkTruePeak > truePeak ? chunkTruePeak : truePeak;
+        samplePeak = chunkSamplePeak > samplePeak ? chunkSamplePeak : samplePeak;
+        current.clippedSamples += clippedLow + clippedHigh;
+        current.frames += frames;
+    }
+
+public:
+    LoudnessMeter() = default;
+    LoudnessMeter(const LoudnessMeter &) = delete;
+    LoudnessMeter &operator=(const LoudnessMeter &) = delete;
+
+    ~LoudnessMeter()
+    {
+        if (kWeighting)
+        {
+            vDSP_biquad_DestroySetup(kWeighting);
+        }
+    }
+
+    // 不能与 Process 同时调用；统计清零
+    void Configure(double rate, uint32_t numChannels)
+    {
+        channels = numChannels;
+        blockFrames = static_cast<size_t>(rate / 10 + 0.5);
+
+        // BS.1770 的两级 K 计权滤波器（高频搁架 + RLB 高通），按实际采样率由模拟原型换算
+        double K = std::tan(M_PI * 1681.974450955533 / rate);
+        double Vh = std::pow(10.0, 3.999843853973347 / 20);
+        double Vb = std::pow(Vh, 0.4996667741545416);
+        double Q = 0.7071752369554196;
+        double a0 = 1 + K / Q + K * K;
+        double K2 = std::tan(M_PI * 38.13547087602444 / rate);
+        double Q2 = 0.5003270373238773;
+        double a02 = 1 + K2 / Q2 + K2 * K2;
+        const double coefficients[10] = {
+            (Vh + Vb * K / Q + K * K) / a0, 2 * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0, 2 * (K * K - 1) / a0, (1 - K / Q + K * K) / a0,
+            1, -2, 1, 2 * (K2 * K2 - 1) / a02, (1 - K2 / Q2 + K2 * K2) / a02};
+        if (kWeighting)
+        {
+            vDSP_biquad_DestroySetup(kWeighting);
+        }
+        kWeighting = vDSP_biquad_CreateSetup(coefficients, 2);
+        delay.assign(static_cast<size_t>(channels) * 6, 0.0f);
+        weighted.assign(kChunkFrames * channels, 0.0f);
+        scratch.assign(kChunkFrames * channels, 0.0f);
+
+        blockSquares.assign(channels, 0);
+        blockFilled = 0;
+        recentBlocks.assign(kShortTermBlocks, 0);
+        recentPos = 0;
+        recentCount = 0;
+
+        DesignOversampler(rate);
+        peakInput.assign(static_cast<size_t>(channels) * (kTapsPerPhase - 1 + kChunkFrames), 0.0f);
+        interpolated.assign(kChunkFrames, 0.0f);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        current = Reading();
+        sampleRate = rate;
+        truePeak = 0;
+        samplePeak = 0;
+        momentaryCounts.assign(kBins, 0);
+        momentaryEnergy.assign(kBins, 0);
+        shortTermCounts.assign(kBins, 0);
+        shortTermEnergy.assign(kBins, 0);
+    }
+
+    // 投递线程：交错 Float32
+    void Process(const float *samples, size_t frames)
+    {
+        while (frames > 0)
+        {
+            size_t n = frames < kChunkFrames ? frames : kChunkFrames;
+            ProcessChunk(samples, n);
+            samples += n * channels;
+            frames -= n;
+        }
+    }
+
+    // 任意线程：当前的统计
+    Reading Read() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Reading reading = current;
+        reading.truePeak = ToDb(truePeak);
+        reading.samplePeak = ToDb(samplePeak);
+        reading.duration = sampleRate > 0 ? reading.frames / sampleRate : 0;
+
+        // integrated：-70 LUFS 绝对门限后再按平均值 -10 LU 的相对门限
+        size_t firstBin = 0;
+        uint64_t count = 0;
+        double energy = GatedEnergy(momentaryCounts, momentaryEnergy, -10, firstBin, count);
+        reading.integrated = count > 0 ? EnergyToLufs(energy) : -INFINITY;
+
+        // loudness range（EBU Tech 3342）：short-term 按 -20 LU 相对门限后 10% 与 95% 分位之差
+        GatedEnergy(shortTermCounts, shortTermEnergy, -20, firstBin, count);
+        if (count > 0)
+        {
+            uint64_t lowRank = static_cast<uint64_t>(count * 0.10);
+            uint64_t highRank = static_cast<uint64_t>(count * 0.95);
+            highRank = highRank < count ? highRank : count - 1;
+            double lowLufs = 0, highLufs = 0;
+            uint64_t seen = 0;
+            bool lowFound = false;
+            for (size_t i = firstBin; i < kBins; i++)
+            {
+                seen += shortTermCounts[i];
+                if (!lowFound && seen > lowRank)
+                {
+                    lowLufs = BinLufs(i);
+                    lowFound = true;
+                }
+                if (seen > highRank)
+                {
+                    highLufs = BinLufs(i);
+                    break;
+                }
+            }
+            reading.range = highLufs - lowLufs;
+        }
+        return reading;
+    }
+};
@@ -58,11 +58,17 @@ ipcMain.on("start-recording", async (event) => {
       return;
     }
 
-    await audioCapture.startCapture((buffer) => {
-      // 发送音频数据到渲染进程
-      if (mainWindow && !mainWindow.isDestroyed()) {
-        mainWindow.webContents.send("audio-data", buffer);
-      }
+    // 可视化只需要电平和频谱，由 native 侧按约 60Hz 计算后发送，不再传输原始 PCM
+    await audioCapture.startCapture({
+      meter: {
+        callback: (levels) => {
+          if (mainWindow && !mainWindow.isDestroyed()) {
+            mainWindow.webContents.send("audio-levels", levels);
+          }
+        },
+        rateHz: 60,
+        bands: 32,
+      },
     });
 
     isRecording = true;
@@ -76,7 +82,8 @@ ipcMain.on("stop-recording", async (event) => {
   if (!isRecording) return;
 
   try {
-    await audioCapture.stopCapture();
+    // drain：剩余的数据都交给回调后再结束，不丢录音的结尾
+    await audioCapture.stop({ drain: true });
     isRecording = false;
     event.reply("recording-stopped");
   } catch (error) {
@@ -84,9 +91,11 @@ ipcMain.on("stop-recording", async (event) => {
   }
 });
 
-// 清理资源
-app.on("before-quit", () => {
-  if (audioCapture) {
-    audioCapture.stopCapture();
+// 清理资源：stop({ drain }) 是异步的，等它写完文件/释放设备后再退出
+app.on("before-quit", (event) => {
+  if (audioCapture && isRecording) {
+    event.preventDefault();
+    isRecording = false;
+    audioCapture.stop({ drain: true }).finally(() => app.quit());
   }
 });
@@ -0,0 +1,215 @@
+// meter.h
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "dsp.h"
+
+// 电平与频谱分析：按固定频率输出每声道峰值、RMS 和对数分段的幅度谱。
+// 输出布局：[peak × channels, rms × channels, band × bands]，均为线性幅度，满幅正弦为 1。
+// 统计和 FFT 使用 vDSP，在投递线程上调用。
+class LevelMeter
+{
+private:
+    uint32_t channels = 0;
+    uint32_t bands = 0;
+    uint32_t fftSize = 0;
+    uint32_t log2Size = 0;
+    size_t intervalFrames = 0;
+    size_t accumulated = 0;
+
+    std::vector<float> peak;
+    std::vector<float> sumSquares;
+
+    // 最近 fftSize 帧的单声道混音，循环写入
+    std::vector<float> history;
+    size_t historyPos = 0;
+
+    FFTSetup fftSetup = nullptr;
+    std::vector<float> window;
+    float windowSum = 1.0f;
+    std::vector<float> windowed;
+    std::vector<float> real;
+    std::vector<float> imag;
+    std::vector<float> magnitudes;
+    std::vector<uint32_t> bandEdges; // bands + 1 个 bin 下标
+
+    std::vector<float> result;
+
+    void Accumulate(const float *in, size_t frames)
+    {
+        for (uint32_t ch = 0; ch < channels; ch++)
+        {
+            float maxValue = 0, squares = 0;
+            vDSP_maxmgv(in + ch, channels, &maxValue, frames);
+            vDSP_svesq(in + ch, channels, &squares, frames);
+            if (maxValue > peak[ch])
+            {
+                peak[ch] = maxValue;
+            }
+            sumSquares[ch] += squares;
+        }
+
+        if (bands == 0)
+        {
+            return;
+        }
+        float scale = 1.0f / channels;
+        for (size_t i = 0; i < frames; i++)
+        {
+            float sum = 0;
+            for (uint32_t ch = 0; ch < channels; ch++)
+            {
+                sum += in[i * channels + ch];
+            }
+            history[historyPos] = sum * scale;
+            historyPos = (historyPos + 1) & (fftSize - 1);
+        }
+    }
+
+    void ComputeSpectrum(float *out)
+    {
+        // 按时间顺序展开循环缓冲区并加窗
+        size_t tail = fftSize - historyPos;
+        vDSP_vmul(history.data() + historyPos, 1, window.data(), 1, windowed.data(), 1, tail);
+        vDSP_vmul(history.data(), 1, window.data() + tail, 1, windowed.data() + tail, 1, historyPos);
+
+        DSPSplitComplex split = {real.data(), imag.data()};
+        vDSP_ctoz(reinterpret_cast<const DSPComplex *>(windowed.data()), 2, &split, 1, fftSize / 2);
+        vDSP_fft_zrip(fftSetup, &split, 1, log2Size, kFFTDirection_Forward);
+        // imag[0] 存放的是 Nyquist 分量，直流 bin 不参与频带统计
+        split.imagp[0] = 0;
+        vDSP_zvmags(&split, 1, magnitudes.data(), 1, fftSize / 2);
+
+        // zrip 的结果是实际 DFT 的 2 倍，除以窗函数之和得到正弦幅度
+        for (uint32_t b = 0; b < bands; b++)
+        {
+            float maxValue = 0;
+            vDSP_maxv(magnitudes.data() + bandEdges[b], 1, &maxValue, bandEdges[b + 1] - bandEdges[b]);
+            out[b] = std::sqrt(maxValue) / windowSum;
+        }
+    }
+
+    void BuildBands()
+    {
+        uint32_t bins = fftSize / 2;
+        if (bands > bins - 1)
+        {
+            bands = bins - 1;
+        }
+
+        // 从第 1 个 bin 到 Nyquist 按对数等分，每个频带至少一个 bin
+        bandEdges.assign(bands + 1, 0);
+        bandEdges[0] = 1;
+        for (uint32_t b = 1; b <= bands; b++)
+        {
+            uint32_t edge = static_cast<uint32_t>(std::lround(std::pow(static_cast<double>(bins), static_cast<double>(b) / bands)));
+            uint32_t minEdge = bandEdges[b - 1] + 1;
+            uint32_t maxEdge = bins - (bands - b);
+            bandEdges[b] = edge < minEdge ? minEdge : (edge > maxEdge ? maxEdge : edge);
+        }
+    }
+
+public:
+    LevelMeter() = default;
+    LevelMeter(const LevelMeter &) = delete;
+    LevelMeter &operator=(const LevelMeter &) = delete;
+
+    ~LevelMeter()
+    {
+        if (fftSetup)
+        {
+            vDSP_destroy_fftsetup(fftSetup);
+        }
+    }
+
+    // size 必须是 2 的幂；numBands 为 0 时只输出峰值和 RMS
+    void Configure(uint32_t sampleRate, uint32_t numChannels, uint32_t rateHz, uint32_t numBands, uint32_t size)
+    {
+        channels = numChannels;
+        bands = numBands;
+        fftSize = size;
+        intervalFrames = rateHz > 0 ? sampleRate / rateHz : sampleRate;
+        if (intervalFrames == 0)
+        {
+            intervalFrames = 1;
+        }
+
+        log2Size = 0;
+        while ((1u << log2Size) < fftSize)
+        {
+            log2Size++;
+        }
+        if (fftSetup)
+        {
+            vDSP_destroy_fftsetup(fftSetup);
+            fftSetup = nullptr;
+        }
+
+        if (bands > 0)
+        {
+            BuildBands();
+            fftSetup = vDSP_create_fftsetup(log2Size, kFFTRadix2);
+            window.resize(fftSize);
+            vDSP_hann_window(window.data(), fftSize, vDSP_HANN_NORM);
+            vDSP_sve(window.data(), 1, &windowSum, fftSize);
+            windowed.resize(fftSize);
+            real.resize(fftSize / 2);
+            imag.resize(fftSize / 2);
+            magnitudes.resize(fftSize / 2);
+            history.assign(fftSize, 0.0f);
+        }
+        historyPos = 0;
+
+        peak.assign(channels, 0.0f);
+        sumSquares.assign(channels, 0.0f);
+        accumulated = 0;
+        result.assign(ResultLength(), 0.0f);
+    }
+
+    size_t ResultLength() const
+    {
+        return channels * 2 + bands;
+    }
+
+    // 处理交错 Float32，每满一个统计周期调用一次 emit(const float *levels, size_t length)
+    template <typename Emit>
+    void Process(const float *in, size_t frames, Emit &&emit)
+    {
+        size_t offset = 0;
+        while (offset < frames)
+        {
+            size_t n = frames - offset;
+            if (n > intervalFrames - accumulated)
+            {
+                n = intervalFrames - accumulated;
+            }
+            Accumulate(in + offset * channels, n);
+            offset += n;
+            accumulated += n;
+
+            if (accumulated < intervalFrames)
+            {
+                break;
+            }
+
+            for (uint32_t ch = 0; ch < channels; ch++)
+            {
+                result[ch] = peak[ch];
+                result[channels + ch] = std::sqrt(sumSquares[ch] / accumulated);
+                peak[ch] = 0;
+                sumSquares[ch] = 0;
+            }
+            if (bands > 0)
+            {
+                ComputeSpectrum(result.data() + channels * 2);
+            }
+            accumulated = 0;
+            emit(result.data(), result.size());
+        }
+    }
+
+    uint32_t Channels() const { return channels; }
+    uint32_t Bands() const { return bands; }
+};
@@ -0,0 +1,34 @@
+// permission.h
+#pragma once
+
+// 音频输入（麦克风 TCC）授权状态，对应 AVAuthorizationStatus
+enum class PermissionStatus
+{
+    NotDetermined,
+    Restricted,
+    Denied,
+    Authorized,
+};
+
+inline const char *PermissionStatusName(PermissionStatus status)
+{
+    switch (status)
+    {
+    case PermissionStatus::NotDetermined:
+        return "not-determined";
+    case PermissionStatus::Restricted:
+        return "restricted";
+    case PermissionStatus::Denied:
+        return "denied";
+    case PermissionStatus::Authorized:
+        return "granted";
+    }
+    return "denied";
+}
+
+// 查询当前授权状态，不会弹出提示。实现在 permission.mm 中。
+PermissionStatus AudioInputPermission();
+
+// 尚未决定时弹出系统授权提示并阻塞到用户作出选择，返回最终状态。
+// 会阻塞调用线程，只能在工作线程上调用。
+PermissionStatus RequestAudioInputPermission();
@@ -0,0 +1,43 @@
+// permission.mm
+#include "permission.h"
+#import <AVFoundation/AVFoundation.h>
+#include <dispatch/dispatch.h>
+
+static PermissionStatus ToPermissionStatus(AVAuthorizationStatus status)
+{
+    switch (status)
+    {
+    case AVAuthorizationStatusNotDetermined:
+        return PermissionStatus::NotDetermined;
+    case AVAuthorizationStatusRestricted:
+        return PermissionStatus::Restricted;
+    case AVAuthorizationStatusDenied:
+        return PermissionStatus::Denied;
+    case AVAuthorizationStatusAuthorized:
+        return PermissionStatus::Authorized;
+    }
+    return PermissionStatus::Denied;
+}
+
+PermissionStatus AudioInputPermission()
+{
+    return ToPermissionStatus([AVCaptureDevice authorizationStatusForMediaType:AVMediaTypeAudio]);
+}
+
+PermissionStatus RequestAudioInputPermission()
+{
+    PermissionStatus status = AudioInputPermission();
+    if (status != PermissionStatus::NotDetermined)
+    {
+        return status;
+    }
+
+    // 完成回调在任意队列上执行，这里等待它返回
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    [AVCaptureDevice requestAccessForMediaType:AVMediaTypeAudio
+                             completionHandler:^(BOOL) {
+                               dispatch_semaphore_signal(done);
+                             }];
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    return AudioInputPermission();
+}
@@ -0,0 +1,345 @@
+// pipewire_source.cc
+#include "capture_source.h"
+#include <pipewire/pipewire.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/pod/builder.h>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+namespace
+{
+    void EnsurePipeWire()
+    {
+        static std::once_flag once;
+        std::call_once(once, []
+                       { pw_init(nullptr, nullptr); });
+    }
+}
+
+// 以监听流采集默认输出（sink）或指定 sink 的混音：PW_KEY_STREAM_CAPTURE_SINK 让会话管理器
+// 把输入流连接到 sink 的 monitor 端口；input 为 true 时是普通的输入流，连接到默认或指定的 source（麦克风）。
+// 只运行 PulseAudio（没有 PipeWire）的系统上不可用。
+// 协商格式固定为交错立体声 F32，采样率不同时由 PipeWire 转换。
+// process 不设 RT_PROCESS，在线程循环上运行：Stop 持有循环锁修改状态，返回时回调必然已经结束
+class PipeWireSource : public CaptureSource
+{
+private:
+    pw_thread_loop *loop = nullptr;
+    pw_stream *stream = nullptr;
+    uint32_t sampleRate = 0;
+    uint32_t bufferFrames = 0;
+    bool negotiated = false;
+    bool failed = false;
+    std::string streamError;
+
+    CaptureCallback callback = nullptr;
+    void *context = nullptr;
+    bool running = false; // 只在持有循环锁时访问
+
+    static void OnStateChanged(void *data, pw_stream_state, pw_stream_state state, const char *error)
+    {
+        PipeWireSource *self = static_cast<PipeWireSource *>(data);
+        if (state == PW_STREAM_STATE_ERROR)
+        {
+            self->failed = true;
+            self->streamError = error ? error : "stream error";
+            pw_thread_loop_signal(self->loop, false);
+        }
+    }
+
+    static void OnParamChanged(void *data, uint32_t id, const spa_pod *param)
+    {
+        PipeWireSource *self = static_cast<PipeWireSource *>(data);
+        if (id != SPA_PARAM_Format || !param)
+        {
+            return;
+        }
+        spa_audio_info_raw info = {};
+        if (spa_format_audio_raw_parse(param, &info) >= 0 && info.rate > 0)
+        {
+            self->sampleRate = info.rate;
+            self->negotiated = true;
+        }
+        pw_thread_loop_signal(self->loop, false);
+    }
+
+    static void OnProcess(void *data)
+    {
+        PipeWireSource *self = static_cast<PipeWireSource *>(data);
+        pw_buffer *buffer = pw_stream_dequeue_buffer(self->stream);
+        if (!buffer)
+        {
+            return;
+        }
+
+        spa_data &block = buffer->buffer->datas[0];
+        if (self->running && block.data && block.chunk)
+        {
+            uint32_t frames = block.chunk->size / (kChannels * sizeof(float));
+            const float *samples = SPA_PTROFF(block.data, block.chunk->offset, const float);
+
+            // 图时钟与流同一采样率时，ticks 就是采样位置；now 为 CLOCK_MONOTONIC 纳秒
+            CaptureSourceTime time;
+            pw_time position = {};
+            if (pw_stream_get_time_n(self->stream, &position, sizeof(position)) == 0)
+            {
+                time.hostTimeNs = position.now > 0 ? static_cast<uint64_t>(position.now) : 0;
+                if (position.rate.num == 1 && position.rate.denom == self->sampleRate)
+                {
+                    time.sampleTimeValid = true;
+                    time.sampleTime = static_cast<double>(position.ticks);
+                }
+            }
+            if (frames > 0)
+            {
+                self->callback(self->context, samples, frames, time);
+            }
+        }
+        pw_stream_queue_buffer(self->stream, buffer);
+    }
+
+    static const pw_stream_events &StreamEvents()
+    {
+        static const pw_stream_events events = []
+        {
+            pw_stream_events e = {};
+            e.version = PW_VERSION_STREAM_EVENTS;
+            e.state_changed = OnStateChanged;
+            e.param_changed = OnParamChanged;
+            e.process = OnProcess;
+            return e;
+        }();
+        return events;
+    }
+
+public:
+    PipeWireSource() = default;
+    PipeWireSource(const PipeWireSource &) = delete;
+    PipeWireSource &operator=(const PipeWireSource &) = delete;
+
+    ~PipeWireSource()
+    {
+        Close();
+    }
+
+    std::string Open(const CaptureSourceOptions &options, CaptureCallback captureCallback, void *callbackContext) override
+    {
+        Close();
+        EnsurePipeWire();
+        callback = captureCallback;
+        context = callbackContext;
+        sampleRate = 0;
+        bufferFrames = options.bufferFrames;
+        negotiated = false;
+        failed = false;
+
+        loop = pw_thread_loop_new("audio-capture", nullptr);
+        if (!loop || pw_thread_loop_start(loop) != 0)
+        {
+            Close();
+            return "Failed to start PipeWire thread loop";
+        }
+
+        pw_properties *props = pw_properties_new(PW_KEY_MEDIA_TYPE, "Audio",
+                                                 PW_KEY_MEDIA_CATEGORY, "Capture",
+                                                 PW_KEY_MEDIA_ROLE, options.input ? "Communication" : "Music",
+                                                 nullptr);
+        if (!options.input)
+        {
+            pw_properties_set(props, PW_KEY_STREAM_CAPTURE_SINK, "true");
+        }
+        if (!options.device.empty())
+        {
+            pw_properties_set(props, PW_KEY_TARGET_OBJECT, options.device.c_str());
+        }
+        if (options.bufferFrames > 0)
+        {
+            pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%u/%u", options.bufferFrames, options.sampleRate > 0 ? options.sampleRate : 48000);
+        }
+
+        pw_thread_loop_lock(loop);
+        stream = pw_stream_new_simple(pw_thread_loop_get_loop(loop), "AudioCapture", props, &StreamEvents(), this);
+        if (!stream)
+        {
+            pw_thread_loop_unlock(loop);
+            Close();
+            return "Failed to connect to PipeWire";
+        }
+
+        uint8_t podBuffer[1024];
+        spa_pod_builder builder = SPA_POD_BUILDER_INIT(podBuffer, sizeof(podBuffer));
+        spa_audio_info_raw info = {};
+        info.format = SPA_AUDIO_FORMAT_F32;
+        info.channels = kChannels;
+        info.rate = options.sampleRate; // 0 表示跟随图的采样率
+        info.position[0] = SPA_AUDIO_CHANNEL_FL;
+        info.position[1] = SPA_AUDIO_CHANNEL_FR;
+        const spa_pod *params[1] = {spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &info)};
+
+        int result = pw_stream_connect(stream, PW_DIRECTION_INPUT, PW_ID_ANY,
+                                       static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_INACTIVE),
+                                       params, 1);
+
+        // 等待格式协商完成，才能知道实际采样率
+        while (result == 0 && !negotiated && !failed)
+        {
+            if (pw_thread_loop_timed_wait(loop, 5) != 0)
+            {
+                failed = true;
+                streamError = "timed out negotiating the stream format";
+            }
+        }
+        pw_thread_loop_unlock(loop);
+
+        if (result != 0 || failed)
+        {
+            std::string error = result != 0 ? std::string(strerror(-result)) : streamError;
+            Close();
+            return std::string(options.input ? "Failed to open PipeWire input stream: " : "Failed to open PipeWire monitor stream: ") + error;
+        }
+        return std::string();
+    }
+
+    uint32_t SampleRate() const override { return sampleRate; }
+    uint32_t BufferFrames() const override { return bufferFrames; }
+
+    std::string Start() override
+    {
+        pw_thread_loop_lock(loop);
+        running = true;
+        int result = pw_stream_set_active(stream, true);
+        pw_thread_loop_unlock(loop);
+        return result == 0 ? std::string() : "Failed to start PipeWire stream: " + std::string(strerror(-result));
+    }
+
+    void Stop() override
+    {
+        if (!loop || !stream)
+        {
+            return;
+        }
+        pw_thread_loop_lock(loop);
+        running = false;
+        pw_stream_set_active(stream, false);
+        pw_thread_loop_unlock(loop);
+    }
+
+    void Close() override
+    {
+        if (loop)
+        {
+            pw_thread_loop_lock(loop);
+            running = false;
+            if (stream)
+            {
+                pw_stream_destroy(stream);
+                stream = nullptr;
+            }
+            pw_thread_loop_unlock(loop);
+            pw_thread_loop_stop(loop);
+            pw_thread_loop_destroy(loop);
+            loop = nullptr;
+        }
+    }
+};
+
+std::unique_ptr<CaptureSource> CreateCaptureSource()
+{
+    return std::make_unique<PipeWireSource>();
+}
+
+namespace
+{
+    // 枚举注册表中的 Audio/Sink 和 Audio/Source 节点，core sync 往返一次即可拿到当前全部对象
+    struct DeviceQuery
+    {
+        pw_main_loop *loop = nullptr;
+        pw_core *core = nullptr;
+        int syncSeq = 0;
+        std::vector<CaptureDeviceInfo> devices;
+    };
+
+    void OnGlobal(void *data, uint32_t, uint32_t, const char *type, uint32_t, const spa_dict *props)
+    {
+        DeviceQuery *query = static_cast<DeviceQuery *>(data);
+        if (!props || strcmp(type, PW_TYPE_INTERFACE_Node) != 0)
+        {
+            return;
+        }
+        const char *mediaClass = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+        const char *name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+        if (!mediaClass || !name || (strcmp(mediaClass, "Audio/Sink") != 0 && strcmp(mediaClass, "Audio/Source") != 0))
+        {
+            return;
+        }
+
+        CaptureDeviceInfo info;
+        info.id = name;
+        info.uid = name;
+        const char *description = spa_dict_lookup(props, PW_KEY_NODE_DESCRIPTION);
+        info.name = description ? description : name;
+        const char *vendor = spa_dict_lookup(props, PW_KEY_DEVICE_VENDOR_NAME);
+        info.manufacturer = vendor ? vendor : "";
+        const char *channels = spa_dict_lookup(props, PW_KEY_AUDIO_CHANNELS);
+        uint32_t channelCount = channels ? static_cast<uint32_t>(strtoul(channels, nullptr, 10)) : 0;
+        (strcmp(mediaClass, "Audio/Source") == 0 ? info.inputChannels : info.outputChannels) = channelCount;
+        const char *rate = spa_dict_lookup(props, PW_KEY_AUDIO_RATE);
+        info.sampleRate = rate ? strtod(rate, nullptr) : 0;
+        query->devices.push_back(info);
+    }
+
+    void OnCoreDone(void *data, uint32_t id, int seq)
+    {
+        DeviceQuery *query = static_cast<DeviceQuery *>(data);
+        if (id == PW_ID_CORE && seq == query->syncSeq)
+        {
+            pw_main_loop_quit(query->loop);
+        }
+    }
+}
+
+// id 为节点名（node.name），可直接作为 device 或 microphone.device 选项；
+// 默认 sink/source 记录在会话管理器的元数据中，这里不解析
+std::vector<CaptureDeviceInfo> ListCaptureDevices()
+{
+    EnsurePipeWire();
+    DeviceQuery query;
+    query.loop = pw_main_loop_new(nullptr);
+    if (!query.loop)
+    {
+        return query.devices;
+    }
+    pw_context *context = pw_context_new(pw_main_loop_get_loop(query.loop), nullptr, 0);
+    query.core = context ? pw_context_connect(context, nullptr, 0) : nullptr;
+    if (query.core)
+    {
+        pw_registry *registry = pw_core_get_registry(query.core, PW_VERSION_REGISTRY, 0);
+
+        pw_registry_events registryEvents = {};
+        registryEvents.version = PW_VERSION_REGISTRY_EVENTS;
+        registryEvents.global = OnGlobal;
+        spa_hook registryListener = {};
+        pw_registry_add_listener(registry, &registryListener, &registryEvents, &query);
+
+        pw_core_events coreEvents = {};
+        coreEvents.version = PW_VERSION_CORE_EVENTS;
+        coreEvents.done = OnCoreDone;
+        spa_hook coreListener = {};
+        pw_core_add_listener(query.core, &coreListener, &coreEvents, &query);
+
+        query.syncSeq = pw_core_sync(query.core, PW_ID_CORE, 0);
+        pw_main_loop_run(query.loop);
+
+        spa_hook_remove(&coreListener);
+        spa_hook_remove(&registryListener);
+        pw_proxy_destroy(reinterpret_cast<pw_proxy *>(registry));
+        pw_core_disconnect(query.core);
+    }
+    if (context)
+    {
+        pw_context_destroy(context);
+    }
+    pw_main_loop_destroy(query.loop);
+    return query.devices;
+}
@@ -0,0 +1,46 @@
+// process_tap.h
+#pragma once
+#include <CoreAudio/CoreAudio.h>
+#include <sys/types.h>
+#include <vector>
+
+struct ProcessTapOptions
+{
+    std::vector<pid_t> processes; // 进程 ID 列表
+    bool exclude = true;          // true：捕获除 processes 以外的所有进程；false：只捕获 processes
+    bool mute = false;            // 捕获期间让被捕获的进程不再从扬声器输出
+};
+
+// 基于 AudioHardwareCreateProcessTap 的系统/进程音频捕获（macOS 14.2+）。
+// 创建一个私有的进程 tap 和包含它的私有聚合设备，聚合设备的输入流就是 tap 的音频，
+// 由原有的 HAL 输出单元当作普通输入设备采集，不需要虚拟声卡驱动。
+// 实现在 process_tap.mm 中。
+class ProcessTap
+{
+private:
+    AudioObjectID tap = kAudioObjectUnknown;
+    AudioDeviceID aggregateDevice = kAudioObjectUnknown;
+
+public:
+    ProcessTap() = default;
+    ProcessTap(const ProcessTap &) = delete;
+    ProcessTap &operator=(const ProcessTap &) = delete;
+
+    ~ProcessTap()
+    {
+        Destroy();
+    }
+
+    // 运行的系统和编译用的 SDK 都支持进程 tap 时返回 true
+    static bool IsSupported();
+
+    // outputDevice 作为聚合设备的主设备提供时钟，失败时返回 OSStatus
+    OSStatus Create(const ProcessTapOptions &options, AudioDeviceID outputDevice);
+
+    void Destroy();
+
+    AudioDeviceID AggregateDevice() const
+    {
+        return aggregateDevice;
+    }
+};
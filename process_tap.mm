@@ -0,0 +1,144 @@
+// process_tap.mm
+#include "process_tap.h"
+#include "devices.h"
+#import <Foundation/Foundation.h>
+#include <AvailabilityMacros.h>
+
+#if defined(__MAC_OS_X_VERSION_MAX_ALLOWED) && __MAC_OS_X_VERSION_MAX_ALLOWED >= 140200
+#import <CoreAudio/AudioHardwareTapping.h>
+#import <CoreAudio/CATapDescription.h>
+#define AUDIO_CAPTURE_HAS_PROCESS_TAP 1
+#endif
+
+bool ProcessTap::IsSupported()
+{
+#ifdef AUDIO_CAPTURE_HAS_PROCESS_TAP
+    if (@available(macOS 14.2, *))
+    {
+        return true;
+    }
+#endif
+    return false;
+}
+
+#ifdef AUDIO_CAPTURE_HAS_PROCESS_TAP
+
+// 把进程 ID 转换为 CoreAudio 进程对象，找不到的进程（从未输出过音频）跳过
+static NSArray<NSNumber *> *ProcessObjects(const std::vector<pid_t> &processes)
+{
+    NSMutableArray<NSNumber *> *objects = [NSMutableArray array];
+    AudioObjectPropertyAddress address = DeviceAddress(kAudioHardwarePropertyTranslatePIDToProcessObject);
+    for (pid_t pid : processes)
+    {
+        AudioObjectID object = kAudioObjectUnknown;
+        UInt32 size = sizeof(object);
+        if (AudioObjectGetPropertyData(kAudioObjectSystemObject, &address, sizeof(pid), &pid, &size, &object) == noErr &&
+            object != kAudioObjectUnknown)
+        {
+            [objects addObject:@(object)];
+        }
+    }
+    return objects;
+}
+
+API_AVAILABLE(macos(14.2))
+static OSStatus CreateTap(const ProcessTapOptions &options, AudioObjectID *tap, NSString **tapUID)
+{
+    NSArray<NSNumber *> *objects = ProcessObjects(options.processes);
+    CATapDescription *description;
+    if (options.exclude)
+    {
+        description = [[CATapDescription alloc] initStereoGlobalTapButExcludeProcesses:objects];
+    }
+    else
+    {
+        if (objects.count == 0)
+        {
+            return kAudioHardwareBadObjectError;
+        }
+        description = [[CATapDescription alloc] initStereoMixdownOfProcesses:objects];
+    }
+    description.name = @"AudioCapture";
+    description.privateTap = YES;
+    description.muteBehavior = options.mute ? CATapMuted : CATapUnmuted;
+
+    OSStatus status = AudioHardwareCreateProcessTap(description, tap);
+    if (status == noErr)
+    {
+        *tapUID = description.UUID.UUIDString;
+    }
+    return status;
+}
+
+OSStatus ProcessTap::Create(const ProcessTapOptions &options, AudioDeviceID outputDevice)
+{
+    Destroy();
+    if (@available(macOS 14.2, *))
+    {
+        @autoreleasepool
+        {
+            NSString *tapUID = nil;
+            OSStatus status = CreateTap(options, &tap, &tapUID);
+            if (status != noErr)
+            {
+                tap = kAudioObjectUnknown;
+                return status;
+            }
+
+            // 聚合设备以输出设备为主设备（时钟源），tap 作为它的输入流，开启漂移补偿
+            NSString *outputUID = [NSString stringWithUTF8String:DeviceStringProperty(outputDevice, kAudioDevicePropertyDeviceUID).c_str()];
+            NSDictionary *composition = @{
+                @kAudioAggregateDeviceNameKey : @"AudioCapture Tap",
+                @kAudioAggregateDeviceUIDKey : [NSUUID UUID].UUIDString,
+                @kAudioAggregateDeviceMainSubDeviceKey : outputUID,
+                @kAudioAggregateDeviceIsPrivateKey : @YES,
+                @kAudioAggregateDeviceIsStackedKey : @NO,
+                @kAudioAggregateDeviceTapAutoStartKey : @YES,
+                @kAudioAggregateDeviceSubDeviceListKey : @[ @{@kAudioSubDeviceUIDKey : outputUID} ],
+                @kAudioAggregateDeviceTapListKey : @[ @{
+                    @kAudioSubTapDriftCompensationKey : @YES,
+                    @kAudioSubTapUIDKey : tapUID,
+                } ],
+            };
+
+            status = AudioHardwareCreateAggregateDevice((__bridge CFDictionaryRef)composition, &aggregateDevice);
+            if (status != noErr)
+            {
+                aggregateDevice = kAudioObjectUnknown;
+                Destroy();
+            }
+            return status;
+        }
+    }
+    return kAudioHardwareUnsupportedOperationError;
+}
+
+void ProcessTap::Destroy()
+{
+    if (@available(macOS 14.2, *))
+    {
+        if (aggregateDevice != kAudioObjectUnknown)
+        {
+            AudioHardwareDestroyAggregateDevice(aggregateDevice);
+            aggregateDevice = kAudioObjectUnknown;
+        }
+        if (tap != kAudioObjectUnknown)
+        {
+            AudioHardwareDestroyProcessTap(tap);
+            tap = kAudioObjectUnknown;
+        }
+    }
+}
+
+#else
+
+OSStatus ProcessTap::Create(const ProcessTapOptions &, AudioDeviceID)
+{
+    return kAudioHardwareUnsupportedOperationError;
+}
+
+void ProcessTap::Destroy()
+{
+}
+
+#endif
@@ -0,0 +1,473 @@
+// processors.h
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "dsp.h"
+
+// 投递前在原生侧对采集格式（交错 Float32）做的预处理：增益、双二阶滤波、AGC、降噪。
+// 各级按 setProcessors 给出的顺序串联，在投递线程上原地处理，JS 拿到的已是处理后的数据。
+enum class ProcessorType
+{
+    Gain,
+    Biquad,
+    Agc,
+    NoiseSuppressor,
+};
+
+// RBJ Audio EQ Cookbook 的滤波器类型
+enum class BiquadType
+{
+    Lowpass,
+    Highpass,
+    Bandpass,
+    Notch,
+    Peaking,
+    LowShelf,
+    HighShelf,
+};
+
+inline bool ParseBiquadType(const std::string &name, BiquadType &type)
+{
+    if (name == "lowpass")
+    {
+        type = BiquadType::Lowpass;
+    }
+    else if (name == "highpass")
+    {
+        type = BiquadType::Highpass;
+    }
+    else if (name == "bandpass")
+    {
+        type = BiquadType::Bandpass;
+    }
+    else if (name == "notch")
+    {
+        type = BiquadType::Notch;
+    }
+    else if (name == "peaking")
+    {
+        type = BiquadType::Peaking;
+    }
+    else if (name == "lowshelf")
+    {
+        type = BiquadType::LowShelf;
+    }
+    else if (name == "highshelf")
+    {
+        type = BiquadType::HighShelf;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+struct ProcessorSpec
+{
+    ProcessorType type = ProcessorType::Gain;
+    double gainDb = 0; // gain 的增益；peaking/shelf 的提升量
+    BiquadType filter = BiquadType::Highpass;
+    double frequency = 1000;
+    double q = 0.7071;
+    double targetDb = -18;   // AGC 目标 RMS（dBFS）
+    double maxGainDb = 30;   // AGC 最大提升
+    double attackMs = 10;    // AGC 降低增益的时间常数
+    double releaseMs = 500;  // AGC 提高增益的时间常数
+    double reductionDb = 12; // 降噪的最大衰减
+};
+
+class AudioProcessor
+{
+public:
+    virtual ~AudioProcessor() = default;
+    // samples 为交错数据，原地处理
+    virtual void Process(float *samples, uint32_t frames) = 0;
+};
+
+class GainProcessor : public AudioProcessor
+{
+private:
+    float gain = 1.0f;
+    uint32_t channels = 0;
+
+public:
+    GainProcessor(double gainDb, uint32_t numChannels)
+        : gain(static_cast<float>(std::pow(10.0, gainDb / 20))), channels(numChannels) {}
+
+    void Process(float *samples, uint32_t frames) override
+    {
+        vDSP_vsmul(samples, 1, &gain, samples, 1, static_cast<vDSP_Length>(frames) * channels);
+    }
+};
+
+// 单级双二阶滤波，每个声道独立的延迟状态，用 vDSP_biquad 按步长处理交错数据
+class BiquadProcessor : public AudioProcessor
+{
+private:
+    uint32_t channels = 0;
+    vDSP_biquad_Setup setup = nullptr;
+    std::vector<float> delay; // 每声道 2 * sections + 2 个
+    std::vector<float> scratch;
+
+public:
+    // maxFrames 为单次 Process 的最大帧数，临时缓冲区在这里一次分配好
+    BiquadProcessor(const ProcessorSpec &spec, double sampleRate, uint32_t numChannels, uint32_t maxFrames)
+        : channels(numChannels), delay(static_cast<size_t>(numChannels) * 4, 0.0f),
+          scratch(static_cast<size_t>(maxFrames) * numChannels)
+    {
+        double w0 = 2 * M_PI * std::min(spec.frequency, sampleRate * 0.49) / sampleRate;
+        double cosW = std::cos(w0);
+        double alpha = std::sin(w0) / (2 * spec.q);
+        double a = std::pow(10.0, spec.gainDb / 40);
+        double b0 = 1, b1 = 0, b2 = 0, a0 = 1, a1 = 0, a2 = 0;
+        switch (spec.filter)
+        {
+        case BiquadType::Lowpass:
+            b0 = (1 - cosW) / 2, b1 = 1 - cosW, b2 = (1 - cosW) / 2;
+            a0 = 1 + alpha, a1 = -2 * cosW, a2 = 1 - alpha;
+            break;
+        case BiquadType::Highpass:
+            b0 = (1 + cosW) / 2, b1 = -(1 + cosW), b2 = (1 + cosW) / 2;
+            a0 = 1 + alpha, a1 = -2 * cosW, a2 = 1 - alpha;
+            break;
+        case BiquadType::Bandpass:
+            b0 = alpha, b1 = 0, b2 = -alpha;
+            a0 = 1 + alpha, a1 = -2 * cosW, a2 = 1 - alpha;
+            break;
+        case BiquadType::Notch:
+            b0 = 1, b1 = -2 * cosW, b2 = 1;
+            a0 = 1 + alpha, a1 = -2 * cosW, a2 = 1 - alpha;
+            break;
+        case BiquadType::Peaking:
+            b0 = 1 + alpha * a, b1 = -2 * cosW, b2 = 1 - alpha * a;
+            a0 = 1 + alpha / a, a1 = -2 * cosW, a2 = 1 - alpha / a;
+            break;
+        case BiquadType::LowShelf:
+        {
+            double s = 2 * std::sqrt(a) * alpha;
+            b0 = a * ((a + 1) - (a - 1) * cosW + s);
+            b1 = 2 * a * ((a - 1) - (a + 1) * cosW);
+            b2 = a * ((a + 1) - (a - 1) * cosW - s);
+            a0 = (a + 1) + (a - 1) * cosW + s;
+            a1 = -2 * ((a - 1) + (a + 1) * cosW);
+            a2 = (a + 1) + (a - 1) * cosW - s;
+            break;
+        }
+        case BiquadType::HighShelf:
+        {
+            double s = 2 * std::sqrt(a) * alpha;
+            b0 = a * ((a + 1) + (a - 1) * cosW + s);
+            b1 = -2 * a * ((a - 1) + (a + 1) * cosW);
+            b2 = a * ((a + 1) + (a - 1) * cosW - s);
+            a0 = (a + 1) - (a - 1) * cosW + s;
+            a1 = 2 * ((a - 1) - (a + 1) * cosW);
+            a2 = (a + 1) - (a - 1) * cosW - s;
+            break;
+        }
+        }
+        // vDSP 的系数顺序为 b0, b1, b2, a1, a2，已按 a0 归一化
+        const double coefficients[5] = {b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+        setup = vDSP_biquad_CreateSetup(coefficients, 1);
+    }
+
+    BiquadProcessor(const BiquadProcessor &) = delete;
+    BiquadProcessor &operator=(const BiquadProcessor &) = delete;
+
+    ~BiquadProcessor() override
+    {
+        if (setup)
+        {
+            vDSP_biquad_DestroySetup(setup);
+        }
+    }
+
+    void Process(float *samples, uint32_t frames) override
+    {
+        // 输出写到临时缓冲区再拷回，不依赖 vDSP_biquad 对原地步长访问的行为。
+        // 缓冲区按最大块预分配，超出时只是兜底
+        size_t count = static_cast<size_t>(frames) * channels;
+        if (scratch.size() < count)
+        {
+            scratch.resize(count);
+        }
+        for (uint32_t ch = 0; ch < channels; ch++)
+        {
+            vDSP_biquad(setup, delay.data() + ch * 4, samples + ch, channels, scratch.data() + ch, channels, frames);
+        }
+        std::memcpy(samples, scratch.data(), count * sizeof(float));
+    }
+};
+
+// 自动增益：按块计算所有声道的 RMS，向目标电平平滑调整增益，块内线性过渡避免爆音。
+// 低于 -60 dBFS 的块视为静音，保持当前增益，不把底噪拉起来；输出限制在 ±1
+class AgcProcessor : public AudioProcessor
+{
+private:
+    static constexpr double kSilenceDb = -60;
+
+    uint32_t channels = 0;
+    double sampleRate = 0;
+    double targetDb = 0;
+    double maxGainDb = 0;
+    double attackMs = 0;
+    double releaseMs = 0;
+    double gainDb = 0;
+    float gain = 1.0f;
+
+public:
+    AgcProcessor(const ProcessorSpec &spec, double rate, uint32_t numChannels)
+        : channels(numChannels), sampleRate(rate), targetDb(spec.targetDb), maxGainDb(spec.maxGainDb),
+          attackMs(spec.attackMs), releaseMs(spec.releaseMs) {}
+
+    void Process(float *samples, uint32_t frames) override
+    {
+        if (frames == 0)
+        {
+            return;
+        }
+        vDSP_Length count = static_cast<vDSP_Length>(frames) * channels;
+        float squares = 0;
+        vDSP_svesq(samples, 1, &squares, count);
+        double levelDb = 10 * std::log10(squares / count + 1e-12);
+
+        if (levelDb > kSilenceDb)
+        {
+            double desired = std::min(targetDb - levelDb, maxGainDb);
+            double blockMs = 1000.0 * frames / sampleRate;
+            double timeConstant = desired < gainDb ? attackMs : releaseMs;
+            double coefficient = timeConstant > 0 ? 1 - std::exp(-blockMs / timeConstant) : 1;
+            gainDb += (desired - gainDb) * coefficient;
+        }
+
+        float next = static_cast<float>(std::pow(10.0, gainDb / 20));
+        float step = (next - gain) / frames;
+        for (uint32_t ch = 0; ch < channels; ch++)
+        {
+            float start = gain;
+            vDSP_vrampmul(samples + ch, channels, &start, &step, samples + ch, channels, frames);
+        }
+        gain = next;
+
+        float low = -1.0f, high = 1.0f;
+        vDSP_vclip(samples, 1, &low, &high, samples, 1, count);
+    }
+};
+
+// 谱减降噪：sqrt-Hann 窗 50% 重叠的 STFT，按最小值跟踪估计每个频点的噪声功率，
+// 用 Wiener 形式的增益（下限由 reductionDb 决定）压低噪声，针对语音背景中的稳态噪声，
+// 长时间不变的信号（如单音）同样会被压低。各声道共用同一组增益以保持声像；
+// 引入 fftSize 帧（约 10 ms）的固定延迟，块的时间戳不做修正
+class NoiseSuppressor : public AudioProcessor
+{
+private:
+    static constexpr float kOverSubtraction = 2.0f;
+    static constexpr float kNoiseRiseDbPerSecond = 5.0f;
+    static constexpr float kPowerSmoothing = 0.8f;
+    static constexpr float kGainSmoothing = 0.4f;
+
+    uint32_t channels = 0;
+    uint32_t fftSize = 0;
+    uint32_t hop = 0;
+    uint32_t log2Size = 0;
+    uint32_t fill = 0;
+    bool noiseInitialized = false;
+    float floorGain = 0;
+    float noiseRise = 1;
+
+    FFTSetup fftSetup = nullptr;
+    std::vector<float> window;
+    std::vector<float> input;   // 每声道 fftSize：最近一帧的输入
+    std::vector<float> overlap; // 每声道 fftSize：重叠相加的累加区
+    std::vector<float> output;  // 每声道 hop：待输出的一段
+    std::vector<float> frame;
+    std::vector<float> real;    // 每声道 fftSize / 2
+    std::vector<float> imag;
+    std::vector<float> power;   // fftSize / 2 + 1 个频点
+    std::vector<float> scratchPower;
+    std::vector<float> smoothed; // 时间上平滑后的功率，用于最小值跟踪
+    std::vector<float> noise;
+    std::vector<float> gains;
+
+    void ProcessFrame()
+    {
+        uint32_t half = fftSize / 2;
+        std::fill(power.begin(), power.end(), 0.0f);
+        for (uint32_t ch = 0; ch < channels; ch++)
+        {
+            vDSP_vmul(input.data() + ch * fftSize, 1, window.data(), 1, frame.data(), 1, fftSize);
+            DSPSplitComplex split = {real.data() + ch * half, imag.data() + ch * half};
+            vDSP_ctoz(reinterpret_cast<const DSPComplex *>(frame.data()), 2, &split, 1, half);
+            vDSP_fft_zrip(fftSetup, &split, 1, log2Size, kFFTDirection_Forward);
+
+            // zrip 的 imag[0] 是 Nyquist 分量，单独放到最后一个频点
+            float nyquist = split.imagp[0];
+            split.imagp[0] = 0;
+            vDSP_zvmags(&split, 1, scratchPower.data(), 1, half);
+            split.imagp[0] = nyquist;
+            scratchPower[half] = nyquist * nyquist;
+            vDSP_vadd(power.data(), 1, scratchPower.data(), 1, power.data(), 1, half + 1);
+        }
+
+        // 噪声估计：平滑功率低于当前估计时立即跟随，否则按固定速率缓慢上升
+        if (!noiseInitialized)
+        {
+            smoothed = power;
+            noise = power;
+            noiseInitialized = true;
+        }
+        for (uint32_t k = 0; k <= half; k++)
+        {
+            smoothed[k] = kPowerSmoothing * smoothed[k] + (1 - kPowerSmoothing) * power[k];
+            noise[k] = smoothed[k] < noise[k] ? smoothed[k] : noise[k] * noiseRise;
+            float g = power[k] > 0 ? 1.0f - kOverSubtraction * noise[k] / power[k] : 0.0f;
+            g = std::max(g, floorGain);
+            gains[k] = kGainSmoothing * gains[k] + (1 - kGainSmoothing) * g;
+        }
+
+        // zrip 正反变换后放大 2 * fftSize 倍
+        float scale = 1.0f / (2.0f * fftSize);
+        vDSP_vsmul(gains.data(), 1, &scale, scratchPower.data(), 1, half + 1);
+        for (uint32_t ch = 0; ch < channels; ch++)
+        {
+            DSPSplitComplex split = {real.data() + ch * half, imag.data() + ch * half};
+            float nyquist = split.imagp[0] * scratchPower[half];
+            vDSP_vmul(split.realp, 1, scratchPower.data(), 1, split.realp, 1, half);
+            vDSP_vmul(split.imagp, 1, scratchPower.data(), 1, split.imagp, 1, half);
+            split.imagp[0] = nyquist;
+            vDSP_fft_zrip(fftSetup, &split, 1, log2Size, kFFTDirection_Inverse);
+            vDSP_ztoc(&split, 1, reinterpret_cast<DSPComplex *>(frame.data()), 2, half);
+
+            float *accumulator = overlap.data() + ch * fftSize;
+            vDSP_vma(frame.data(), 1, window.data(), 1, accumulator, 1, accumulator, 1, fftSize);
+            std::memcpy(output.data() + ch * hop, accumulator, hop * sizeof(float));
+            std::memmove(accumulator, accumulator + hop, (fftSize - hop) * sizeof(float));
+            std::memset(accumulator + fftSize - hop, 0, hop * sizeof(float));
+
+            float *history = input.data() + ch * fftSize;
+            std::memmove(history, history + hop, (fftSize - hop) * sizeof(float));
+        }
+    }
+
+public:
+    NoiseSuppressor(const ProcessorSpec &spec, double sampleRate, uint32_t numChannels)
+        : channels(numChannels)
+    {
+        // 帧长约 10 ms：48 kHz 及以下 512，更高的采样率 1024
+        fftSize = sampleRate > 48000 ? 1024 : 512;
+        hop = fftSize / 2;
+        while ((1u << log2Size) < fftSize)
+        {
+            log2Size++;
+        }
+        floorGain = static_cast<float>(std::pow(10.0, -spec.reductionDb / 20));
+        noiseRise = static_cast<float>(std::pow(10.0, kNoiseRiseDbPerSecond * hop / sampleRate / 10));
+
+        fftSetup = vDSP_create_fftsetup(log2Size, kFFTRadix2);
+        // 周期 Hann 窗开方后分析、合成各用一次，50% 重叠时相加恰好为 1
+        window.resize(fftSize);
+        vDSP_hann_window(window.data(), fftSize, vDSP_HANN_DENORM);
+        for (float &w : window)
+        {
+            w = std::sqrt(w);
+        }
+        input.assign(static_cast<size_t>(channels) * fftSize, 0.0f);
+        overlap.assign(static_cast<size_t>(channels) * fftSize, 0.0f);
+        output.assign(static_cast<size_t>(channels) * hop, 0.0f);
+        frame.resize(fftSize);
+        real.resize(static_cast<size_t>(channels) * fftSize / 2);
+        imag.resize(static_cast<size_t>(channels) * fftSize / 2);
+        power.resize(fftSize / 2 + 1);
+        scratchPower.resize(fftSize / 2 + 1);
+        smoothed.resize(fftSize / 2 + 1);
+        noise.resize(fftSize / 2 + 1);
+        gains.assign(fftSize / 2 + 1, 1.0f);
+    }
+
+    NoiseSuppressor(const NoiseSuppressor &) = delete;
+    NoiseSuppressor &operator=(const NoiseSuppressor &) = delete;
+
+    ~NoiseSuppressor() override
+    {
+        if (fftSetup)
+        {
+            vDSP_destroy_fftsetup(fftSetup);
+        }
+    }
+
+    void Process(float *samples, uint32_t frames) override
+    {
+        uint32_t offset = 0;
+        while (offset < frames)
+        {
+            uint32_t n = std::min(frames - offset, hop - fill);
+            for (uint32_t ch = 0; ch < channels; ch++)
+            {
+                float *history = input.data() + ch * fftSize + fftSize - hop + fill;
+                const float *pending = output.data() + ch * hop + fill;
+                for (uint32_t i = 0; i < n; i++)
+                {
+                    float *sample = samples + (offset + i) * channels + ch;
+                    history[i] = *sample;
+                    *sample = pending[i];
+                }
+            }
+            offset += n;
+            fill += n;
+            if (fill == hop)
+            {
+                ProcessFrame();
+                fill = 0;
+            }
+        }
+    }
+};
+
+// 按顺序串联的处理链，在投递线程上调用。各级的缓冲区在创建时按 maxFrames（单次投递的最大帧数）分配，
+// 投递线程上不分配内存
+class ProcessorChain
+{
+private:
+    std::vector<std::unique_ptr<AudioProcessor>> stages;
+
+public:
+    static std::unique_ptr<ProcessorChain> Create(const std::vector<ProcessorSpec> &specs, double sampleRate, uint32_t channels,
+                                                  uint32_t maxFrames)
+    {
+        auto chain = std::make_unique<ProcessorChain>();
+        for (const ProcessorSpec &spec : specs)
+        {
+            switch (spec.type)
+            {
+            case ProcessorType::Gain:
+                chain->stages.push_back(std::make_unique<GainProcessor>(spec.gainDb, channels));
+                break;
+            case ProcessorType::Biquad:
+                chain->stages.push_back(std::make_unique<BiquadProcessor>(spec, sampleRate, channels, maxFrames));
+                break;
+            case ProcessorType::Agc:
+                chain->stages.push_back(std::make_unique<AgcProcessor>(spec, sampleRate, channels));
+                break;
+            case ProcessorType::NoiseSuppressor:
+                chain->stages.push_back(std::make_unique<NoiseSuppressor>(spec, sampleRate, channels));
+                break;
+            }
+        }
+        return chain;
+    }
+
+    void Process(float *samples, uint32_t frames)
+    {
+        for (auto &stage : stages)
+        {
+            stage->Process(samples, frames);
+        }
+    }
+
+    bool Empty() const { return stages.empty(); }
+};
@@ -17,19 +17,35 @@ function updateUI(recording) {
 }
 
 // 绘制音频可视化
-function drawAudioData(buffer) {
-    const data = new Float32Array(buffer);
+// levels 布局：[peak × 2, rms × 2, band × N]，均为线性幅度
+const METER_CHANNELS = 2;
+
+function drawLevels(levels) {
     const width = visualizer.width;
     const height = visualizer.height;
-    const barWidth = width / data.length;
+    const bands = levels.length - METER_CHANNELS * 2;
+    const meterWidth = 12;
+    const barWidth = (width - meterWidth * METER_CHANNELS - 8) / bands;
 
     canvas.clearRect(0, 0, width, height);
+
+    // 频谱，按 -60dB 到 0dB 映射高度
     canvas.fillStyle = '#2196F3';
+    for (let i = 0; i < bands; i++) {
+        const db = 20 * Math.log10(levels[METER_CHANNELS * 2 + i] + 1e-6);
+        const barHeight = Math.max(0, Math.min(1, (db + 60) / 60)) * height;
+        canvas.fillRect(i * barWidth, height - barHeight, barWidth - 1, barHeight);
+    }
 
-    for (let i = 0; i < data.length; i++) {
-        const x = i * barWidth;
-        const barHeight = (Math.abs(data[i]) * height) / 2;
-        canvas.fillRect(x, height/2 - barHeight/2, barWidth - 1, barHeight);
+    // 每声道 RMS 电平条和峰值线
+    for (let ch = 0; ch < METER_CHANNELS; ch++) {
+        const x = width - meterWidth * (METER_CHANNELS - ch);
+        const rms = Math.min(1, levels[METER_CHANNELS + ch]) * height;
+        const peak = Math.min(1, levels[ch]) * height;
+        canvas.fillStyle = '#4CAF50';
+        canvas.fillRect(x, height - rms, meterWidth - 2, rms);
+        canvas.fillStyle = '#f44336';
+        canvas.fillRect(x, height - peak, meterWidth - 2, 2);
     }
 }
 
@@ -73,8 +89,8 @@ ipcRenderer.on('recording-error', (event, error) => {
     status.textContent = `Error: ${error}`;
 });
 
-ipcRenderer.on('audio-data', (event, buffer) => {
+ipcRenderer.on('audio-levels', (event, levels) => {
     if (isRecording) {
-        drawAudioData(buffer);
+        drawLevels(levels);
     }
 });
\ No newline at end of file
@@ -0,0 +1,204 @@
+// resampler.h
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 有理数比例的多相加窗 sinc 重采样器（Kaiser 窗），流式处理交错 Float32。
+// 输出率/输入率约分为 L/M，预先计算 L 组相位系数，每个输出采样只做一次点积。
+class Resampler
+{
+private:
+    static constexpr uint32_t kBaseTaps = 32;
+    static constexpr uint32_t kMaxTaps = 256;
+    static constexpr uint32_t kMaxPhases = 4096;
+    static constexpr double kKaiserBeta = 8.0;
+
+    uint32_t inRate = 0;
+    uint32_t outRate = 0;
+    uint32_t channels = 0;
+    uint32_t up = 1;   // L
+    uint32_t down = 1; // M
+    uint32_t taps = 0;
+    std::vector<float> coeffs; // up * taps
+
+    // 每个声道一段输入历史，平面排列便于点积
+    std::vector<std::vector<float>> history;
+    size_t historyFrames = 0;
+    uint32_t phase = 0;
+    size_t position = 0; // 下一个输出对应的历史起点
+
+    static uint32_t Gcd(uint32_t a, uint32_t b)
+    {
+        while (b)
+        {
+            uint32_t t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+
+    // 零阶修正贝塞尔函数，用于 Kaiser 窗
+    static double BesselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; k++)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    void BuildFilter()
+    {
+        // 降采样时截止频率随比例降低，滤波器按比例加长以保持过渡带宽
+        double ratio = static_cast<double>(up) / down;
+        double cutoff = (ratio < 1.0 ? ratio : 1.0) * 0.95;
+        taps = static_cast<uint32_t>(std::ceil(kBaseTaps / (ratio < 1.0 ? ratio : 1.0)));
+        taps = (taps + 1) & ~1u;
+        if (taps > kMaxTaps)
+        {
+            taps = kMaxTaps;
+        }
+
+        coeffs.assign(static_cast<size_t>(up) * taps, 0.0f);
+        double centre = taps / 2.0 - 1.0;
+        double i0Beta = BesselI0(kKaiserBeta);
+        for (uint32_t p = 0; p < up; p++)
+        {
+            double sum = 0.0;
+            float *h = &coeffs[static_cast<size_t>(p) * taps];
+            for (uint32_t j = 0; j < taps; j++)
+            {
+                double x = j - centre - static_cast<double>(p) / up;
+                double sinc = x == 0.0 ? 1.0 : std::sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+                double w = x / (taps / 2.0);
+                double window = std::fabs(w) >= 1.0 ? 0.0 : BesselI0(kKaiserBeta * std::sqrt(1.0 - w * w)) / i0Beta;
+                h[j] = static_cast<float>(sinc * window);
+                sum += h[j];
+            }
+            // 每个相位单独归一化，避免直流增益随相位起伏
+            for (uint32_t j = 0; j < taps; j++)
+            {
+                h[j] = static_cast<float>(h[j] / sum);
+            }
+        }
+    }
+
+    static float Dot(const float *a, const float *b, uint32_t n)
+    {
+        // 四路累加，便于编译器向量化
+        float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        uint32_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            s0 += a[i] * b[i];
+            s1 += a[i + 1] * b[i + 1];
+            s2 += a[i + 2] * b[i + 2];
+            s3 += a[i + 3] * b[i + 3];
+        }
+        for (; i < n; i++)
+        {
+            s0 += a[i] * b[i];
+        }
+        return (s0 + s1) + (s2 + s3);
+    }
+
+public:
+    // 返回 false 表示比例无法用有限相位数表示
+    bool Configure(uint32_t inputRate, uint32_t outputRate, uint32_t numChannels)
+    {
+        inRate = inputRate;
+        outRate = outputRate;
+        channels = numChannels;
+        uint32_t g = Gcd(inRate, outRate);
+        up = outRate / g;
+        down = inRate / g;
+        if (up > kMaxPhases)
+        {
+            return false;
+        }
+
+        history.assign(channels, std::vector<float>());
+        if (!IsPassthrough())
+        {
+            BuildFilter();
+        }
+        Reset();
+        return true;
+    }
+
+    void Reset()
+    {
+        // 预填半个滤波器长度的零，使输出与输入对齐
+        historyFrames = taps > 0 ? taps / 2 - 1 : 0;
+        for (auto &h : history)
+        {
+            h.assign(historyFrames, 0.0f);
+        }
+        phase = 0;
+        position = 0;
+    }
+
+    bool IsPassthrough() const
+    {
+        return inRate == outRate;
+    }
+
+    // 输入 frames 帧，输出估计不超过的帧数
+    size_t MaxOutputFrames(size_t frames) const
+    {
+        return static_cast<size_t>((static_cast<uint64_t>(frames + taps) * up) / down) + 1;
+    }
+
+    // 处理交错输入，把交错输出追加到 out，返回输出帧数
+    size_t Process(const float *in, size_t frames, std::vector<float> &out)
+    {
+        if (IsPassthrough())
+        {
+            out.insert(out.end(), in, in + frames * channels);
+            return frames;
+        }
+
+        for (uint32_t ch = 0; ch < channels; ch++)
+        {
+            std::vector<float> &h = history[ch];
+            h.resize(historyFrames + frames);
+            for (size_t i = 0; i < frames; i++)
+            {
+                h[historyFrames + i] = in[i * channels + ch];
+            }
+        }
+        historyFrames += frames;
+
+        size_t produced = 0;
+        size_t base = out.size();
+        out.resize(base + MaxOutputFrames(frames) * channels);
+        while (position + taps <= historyFrames)
+        {
+            const float *h = &coeffs[static_cast<size_t>(phase) * taps];
+            for (uint32_t ch = 0; ch < channels; ch++)
+            {
+                out[base + produced * channels + ch] = Dot(h, history[ch].data() + position, taps);
+            }
+            produced++;
+
+            phase += down;
+            position += phase / up;
+            phase %= up;
+        }
+        out.resize(base + produced * channels);
+
+        // 丢弃已经不再需要的历史
+        for (auto &h : history)
+        {
+            h.erase(h.begin(), h.begin() + position);
+        }
+        historyFrames -= position;
+        position = 0;
+        return produced;
+    }
+};
@@ -0,0 +1,150 @@
+// ring_buffer.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+              "ring indices must be plain lock-free 32-bit words to be shared with JS Atomics");
+
+// 单生产者/单消费者无锁环形缓冲区（交错 Float32，以帧为单位）
+// 生产者只在实时线程调用 Write，消费者只在另一个线程调用 Read，
+// 两端都不分配内存、不加锁，只通过读写位置的原子变量同步。
+// 存储和读写位置可以放在外部内存（如 SharedArrayBuffer）中，由其他线程直接消费。
+class RingBuffer
+{
+private:
+    std::unique_ptr<float[]> storage;
+    float *data = nullptr;
+    uint32_t capacity = 0; // 帧数，2 的幂
+    uint32_t mask = 0;
+    uint32_t channels = 0;
+
+    // 读写位置单调递增，按 2^32 回绕，差值即为已用帧数
+    alignas(64) std::atomic<uint32_t> ownWritePos{0};
+    alignas(64) std::atomic<uint32_t> ownReadPos{0};
+    std::atomic<uint32_t> *writePosPtr = &ownWritePos;
+    std::atomic<uint32_t> *readPosPtr = &ownReadPos;
+
+public:
+    RingBuffer() = default;
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    // 容量取不小于 minFrames 的 2 的幂
+    static uint32_t RoundCapacity(uint32_t minFrames)
+    {
+        uint32_t p = 1;
+        while (p < minFrames && p < (1u << 31))
+        {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    // 只能在没有生产者/消费者运行时调用
+    void Allocate(uint32_t minFrames, uint32_t numChannels)
+    {
+        capacity = RoundCapacity(minFrames);
+        mask = capacity - 1;
+        channels = numChannels;
+        storage = std::make_unique<float[]>(static_cast<size_t>(capacity) * channels);
+        data = storage.get();
+        writePosPtr = &ownWritePos;
+        readPosPtr = &ownReadPos;
+        Reset();
+    }
+
+    // 使用外部存储：samples 至少 capacityFrames * numChannels 个采样，
+    // capacityFrames 必须是 2 的幂，外部内存的生命周期由调用方保证。
+    // 接入另一端已经在使用的缓冲区时 reset 为 false，保留现有的读写位置
+    void Attach(float *samples, uint32_t capacityFrames, uint32_t numChannels,
+                std::atomic<uint32_t> *write, std::atomic<uint32_t> *read, bool reset = true)
+    {
+        storage.reset();
+        data = samples;
+        capacity = capacityFrames;
+        mask = capacity - 1;
+        channels = numChannels;
+        writePosPtr = write;
+        readPosPtr = read;
+        if (reset)
+        {
+            Reset();
+        }
+    }
+
+    void Reset()
+    {
+        writePosPtr->store(0, std::memory_order_relaxed);
+        readPosPtr->store(0, std::memory_order_relaxed);
+    }
+
+    uint32_t Capacity() const { return capacity; }
+    uint32_t Channels() const { return channels; }
+
+    uint32_t AvailableRead() const
+    {
+        return writePosPtr->load(std::memory_order_acquire) - readPosPtr->load(std::memory_order_relaxed);
+    }
+
+    uint32_t AvailableWrite() const
+    {
+        return capacity - (writePosPtr->load(std::memory_order_relaxed) - readPosPtr->load(std::memory_order_acquire));
+    }
+
+    // 生产者：写入最多 frames 帧，返回实际写入帧数（满时丢弃剩余部分）
+    uint32_t Write(const float *src, uint32_t frames)
+    {
+        uint32_t w = writePosPtr->load(std::memory_order_relaxed);
+        uint32_t r = readPosPtr->load(std::memory_order_acquire);
+        uint32_t space = capacity - (w - r);
+        if (frames > space)
+        {
+            frames = space;
+        }
+        if (frames == 0)
+        {
+            return 0;
+        }
+
+        uint32_t start = w & mask;
+        uint32_t first = capacity - start < frames ? capacity - start : frames;
+        memcpy(data + static_cast<size_t>(start) * channels, src, static_cast<size_t>(first) * channels * sizeof(float));
+        if (first < frames)
+        {
+            memcpy(data, src + static_cast<size_t>(first) * channels, static_cast<size_t>(frames - first) * channels * sizeof(float));
+        }
+
+        writePosPtr->store(w + frames, std::memory_order_release);
+        return frames;
+    }
+
+    // 消费者：读出最多 frames 帧，返回实际读出帧数
+    uint32_t Read(float *dst, uint32_t frames)
+    {
+        uint32_t r = readPosPtr->load(std::memory_order_relaxed);
+        uint32_t w = writePosPtr->load(std::memory_order_acquire);
+        uint32_t available = w - r;
+        if (frames > available)
+        {
+            frames = available;
+        }
+        if (frames == 0)
+        {
+            return 0;
+        }
+
+        uint32_t start = r & mask;
+        uint32_t first = capacity - start < frames ? capacity - start : frames;
+        memcpy(dst, data + static_cast<size_t>(start) * channels, static_cast<size_t>(first) * channels * sizeof(float));
+        if (first < frames)
+        {
+            memcpy(dst + static_cast<size_t>(first) * channels, data, static_cast<size_t>(frames - first) * channels * sizeof(float));
+        }
+
+        readPosPtr->store(r + frames, std::memory_order_release);
+        return frames;
+    }
+};
@@ -0,0 +1,241 @@
+// sample_format.h
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// 交给 JS 的采样格式
+enum class SampleFormat
+{
+    Float32,
+    Int16,
+    Int24, // 3 字节小端紧凑排列
+};
+
+struct OutputFormat
+{
+    SampleFormat sample = SampleFormat::Float32;
+    bool planar = false; // true 时按声道依次排列，否则交错
+
+    size_t BytesPerSample() const
+    {
+        switch (sample)
+        {
+        case SampleFormat::Int16:
+            return 2;
+        case SampleFormat::Int24:
+            return 3;
+        default:
+            return 4;
+        }
+    }
+
+    bool IsNativeLayout() const
+    {
+        return sample == SampleFormat::Float32 && !planar;
+    }
+};
+
+// 解析 "f32" / "s16" / "s24"，可带 "-planar" 后缀
+inline bool ParseOutputFormat(const std::string &name, OutputFormat &format)
+{
+    std::string base = name;
+    format.planar = false;
+    const std::string suffix = "-planar";
+    if (base.size() > suffix.size() && base.compare(base.size() - suffix.size(), suffix.size(), suffix) == 0)
+    {
+        format.planar = true;
+        base.resize(base.size() - suffix.size());
+    }
+
+    if (base == "f32")
+    {
+        format.sample = SampleFormat::Float32;
+    }
+    else if (base == "s16")
+    {
+        format.sample = SampleFormat::Int16;
+    }
+    else if (base == "s24")
+    {
+        format.sample = SampleFormat::Int24;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// 把交错 Float32 转换为目标格式。整数格式加 TPDF 抖动（±1 LSB），
+// 量化部分使用 SSE2 / NEON 向量化，不在实时线程调用。
+class SampleConverter
+{
+private:
+    static constexpr size_t kDitherSize = 4096; // 4 的倍数，向量读取不会越界
+    static constexpr size_t kDitherMask = kDitherSize - 1;
+
+    OutputFormat format;
+    std::vector<float> dither;
+    size_t ditherPos = 0;
+    std::vector<int32_t> quantized;
+
+    // 预先生成三角分布抖动表，以 LSB 为单位
+    void GenerateDither()
+    {
+        dither.resize(kDitherSize);
+        uint32_t state = 0x9E3779B9u;
+        auto next = [&state]()
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return static_cast<float>(state) / 4294967296.0f;
+        };
+        for (size_t i = 0; i < kDitherSize; i++)
+        {
+            dither[i] = next() - next();
+        }
+    }
+
+    // 缩放、加抖动、饱和并四舍五入为 int32
+    void Quantize(const float *in, int32_t *out, size_t count, float scale)
+    {
+        const float maxValue = scale - 1.0f;
+        const float minValue = -scale;
+        size_t i = 0;
+
+#if defined(__SSE2__)
+        const __m128 vscale = _mm_set1_ps(scale);
+        const __m128 vmax = _mm_set1_ps(maxValue);
+        const __m128 vmin = _mm_set1_ps(minValue);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 v = _mm_mul_ps(_mm_loadu_ps(in + i), vscale);
+            v = _mm_add_ps(v, _mm_loadu_ps(dither.data() + ditherPos));
+            v = _mm_min_ps(_mm_max_ps(v, vmin), vmax);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_cvtps_epi32(v));
+            ditherPos = (ditherPos + 4) & kDitherMask;
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const float32x4_t vscale = vdupq_n_f32(scale);
+        const float32x4_t vmax = vdupq_n_f32(maxValue);
+        const float32x4_t vmin = vdupq_n_f32(minValue);
+        for (; i + 4 <= count; i += 4)
+        {
+            float32x4_t v = vmulq_f32(vld1q_f32(in + i), vscale);
+            v = vaddq_f32(v, vld1q_f32(dither.data() + ditherPos));
+            v = vminq_f32(vmaxq_f32(v, vmin), vmax);
+            vst1q_s32(out + i, vcvtnq_s32_f32(v));
+            ditherPos = (ditherPos + 4) & kDitherMask;
+        }
+#endif
+
+        // 不足 4 个的尾部也按一组前进，ditherPos 始终是 4 的倍数，下一次的向量读取不会越过表尾
+        if (i < count)
+        {
+            for (size_t k = 0; i < count; i++, k++)
+            {
+                float v = in[i] * scale + dither[ditherPos + k];
+                v = v > maxValue ? maxValue : (v < minValue ? minValue : v);
+                out[i] = static_cast<int32_t>(lrintf(v));
+            }
+            ditherPos = (ditherPos + 4) & kDitherMask;
+        }
+    }
+
+public:
+    SampleConverter()
+    {
+        GenerateDither();
+    }
+
+    void SetFormat(OutputFormat outputFormat)
+    {
+        format = outputFormat;
+    }
+
+    const OutputFormat &Format() const
+    {
+        return format;
+    }
+
+    size_t OutputBytes(size_t frames, uint32_t channels) const
+    {
+        return frames * channels * format.BytesPerSample();
+    }
+
+    // in 为 frames * channels 个交错采样，out 至少 OutputBytes(frames, channels) 字节
+    void Convert(const float *in, size_t frames, uint32_t channels, uint8_t *out)
+    {
+        size_t count = frames * channels;
+
+        if (format.sample == SampleFormat::Float32)
+        {
+            if (!format.planar)
+            {
+                memcpy(out, in, count * sizeof(float));
+                return;
+            }
+            float *dst = reinterpret_cast<float *>(out);
+            for (uint32_t ch = 0; ch < channels; ch++)
+            {
+                float *plane = dst + ch * frames;
+                for (size_t i = 0; i < frames; i++)
+                {
+                    plane[i] = in[i * channels + ch];
+                }
+            }
+            return;
+        }
+
+        if (quantized.size() < count)
+        {
+            quantized.resize(count);
+        }
+        const int32_t *q = quantized.data();
+
+        if (format.sample == SampleFormat::Int16)
+        {
+            Quantize(in, quantized.data(), count, 32768.0f);
+            int16_t *dst = reinterpret_cast<int16_t *>(out);
+            if (!format.planar)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    dst[i] = static_cast<int16_t>(q[i]);
+                }
+                return;
+            }
+            for (uint32_t ch = 0; ch < channels; ch++)
+            {
+                int16_t *plane = dst + ch * frames;
+                for (size_t i = 0; i < frames; i++)
+                {
+                    plane[i] = static_cast<int16_t>(q[i * channels + ch]);
+                }
+            }
+            return;
+        }
+
+        Quantize(in, quantized.data(), count, 8388608.0f);
+        for (size_t i = 0; i < count; i++)
+        {
+            // 平面布局时把交错下标映射到所在声道平面
+            size_t index = format.planar ? (i % channels) * frames + i / channels : i;
+            uint8_t *dst = out + index * 3;
+            uint32_t v = static_cast<uint32_t>(q[i]);
+            dst[0] = static_cast<uint8_t>(v);
+            dst[1] = static_cast<uint8_t>(v >> 8);
+            dst[2] = static_cast<uint8_t>(v >> 16);
+        }
+    }
+};
@@ -0,0 +1,289 @@
+// scheduler.h
+#pragma once
+#include <napi.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "thread_priority.h"
+#include "wake_event.h"
+
+// 同一个 JS 环境中所有 AudioCapture 共用的投递调度器：
+// 一个投递线程轮流为各实例取数据，一个 ThreadSafeFunction 一次唤醒处理所有实例的待办，
+// N 路采集每个周期只唤醒一次事件循环。
+class DeliveryScheduler : public std::enable_shared_from_this<DeliveryScheduler>
+{
+public:
+    // 待办工作类型，按位组合
+    enum Work : uint32_t
+    {
+        kWorkData = 1,    // 数据队列非空
+        kWorkReaders = 2, // 唤醒等待中的异步读取
+        kWorkMeter = 4,   // 新的电平/频谱结果
+    };
+
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+        // 投递线程：处理已采集的数据，返回最多还能等待多久（纳秒）
+        virtual int64_t ServiceDelivery() = 0;
+        // JS 线程：处理 Post 投递的工作
+        virtual void OnJsThread(Napi::Env env, uint32_t work) = 0;
+    };
+
+    // 实例在调度器中的登记项。JS 回调可能晚于实例析构执行，
+    // 因此由调度器和实例共享持有，实例析构时在 JS 线程上清空 client。
+    struct Handle
+    {
+        Client *client = nullptr;
+        std::atomic<uint32_t> pending{0};
+    };
+
+private:
+    static constexpr int64_t kMaxWaitNs = 100 * 1000 * 1000;
+
+    // 投递线程服务的实例。线程在第一次 StartServicing 时创建，没有实例时一直休眠到下次唤醒
+    std::mutex clientsMutex;
+    std::vector<Client *> servicing;
+    WakeEvent wake;
+
+    // 各实例请求的实时调度（clientsMutex 保护）：取最短的 IO 周期，
+    // 线程同一时间只能属于一个 workgroup，加入第一个提供了 workgroup 的实例的
+    struct RealtimeRequest
+    {
+        Client *client;
+        uint64_t periodNs;
+        IoWorkgroup workgroup;
+    };
+    std::vector<RealtimeRequest> realtimeRequests;
+    bool realtimeChanged = false;
+    RealtimeThread realtime; // 只在投递线程上访问
+    std::atomic<bool> running{false};
+    std::thread thread;
+
+    // 有待办工作、等待 JS 线程处理的实例
+    std::mutex readyMutex;
+    std::vector<std::shared_ptr<Handle>> ready;
+    std::vector<std::shared_ptr<Handle>> draining;
+    std::atomic<bool> callPending{false};
+
+    // 有活动采集时才持有 ThreadSafeFunction，使空闲时不阻止进程退出
+    Napi::ThreadSafeFunction tsfn;
+    size_t activeClients = 0;
+
+    void Loop()
+    {
+        int64_t waitNs = kMaxWaitNs;
+        while (running.load(std::memory_order_acquire))
+        {
+            wake.Wait(waitNs);
+
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            if (realtimeChanged)
+            {
+                ApplyRealtime();
+            }
+            waitNs = servicing.empty() ? -1 : kMaxWaitNs;
+            for (Client *client : servicing)
+            {
+                waitNs = std::min(waitNs, client->ServiceDelivery());
+            }
+        }
+        realtime.Apply(0, nullptr);
+    }
+
+    // 投递线程，持有 clientsMutex：按当前的请求调整本线程的调度
+    void ApplyRealtime()
+    {
+        realtimeChanged = false;
+        uint64_t periodNs = 0;
+        IoWorkgroup workgroup;
+        for (const RealtimeRequest &request : realtimeRequests)
+        {
+            if (periodNs == 0 || request.periodNs < periodNs)
+            {
+                periodNs = request.periodNs;
+            }
+            if (!workgroup)
+            {
+                workgroup = request.workgroup;
+            }
+        }
+        realtime.Apply(periodNs, workgroup);
+    }
+
+    void EraseRealtime(Client *client)
+    {
+        auto end = std::remove_if(realtimeRequests.begin(), realtimeRequests.end(), [client](const RealtimeRequest &request)
+                                  { return request.client == client; });
+        if (end != realtimeRequests.end())
+        {
+            realtimeRequests.erase(end, realtimeRequests.end());
+            realtimeChanged = true;
+        }
+    }
+
+    // JS 线程：一次处理所有实例的待办
+    void Drain(Napi::Env env)
+    {
+        callPending.store(false);
+        {
+            std::lock_guard<std::mutex> lock(readyMutex);
+            draining.swap(ready);
+        }
+        for (size_t i = 0; i < draining.size(); i++)
+        {
+            uint32_t work = draining[i]->pending.exchange(0);
+            if (draining[i]->client && work)
+            {
+                draining[i]->client->OnJsThread(env, work);
+            }
+
+            // JS 回调抛出了异常：剩余实例留到下一次调用处理
+            if (env.IsExceptionPending() && i + 1 < draining.size())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(readyMutex);
+                    ready.insert(ready.end(), draining.begin() + i + 1, draining.end());
+                }
+                if (!callPending.exchange(true))
+                {
+                    Schedule();
+                }
+                break;
+            }
+        }
+        draining.clear();
+    }
+
+    napi_status Schedule()
+    {
+        if (!tsfn)
+        {
+            callPending.store(false);
+            return napi_closing;
+        }
+
+        std::weak_ptr<DeliveryScheduler> weak = shared_from_this();
+        napi_status status = tsfn.NonBlockingCall([weak](Napi::Env env, Napi::Function)
+                                                  {
+            if (auto self = weak.lock())
+            {
+                self->Drain(env);
+            } });
+        if (status != napi_ok)
+        {
+            callPending.store(false);
+        }
+        return status;
+    }
+
+public:
+    DeliveryScheduler() = default;
+    DeliveryScheduler(const DeliveryScheduler &) = delete;
+    DeliveryScheduler &operator=(const DeliveryScheduler &) = delete;
+
+    ~DeliveryScheduler()
+    {
+        if (thread.joinable())
+        {
+            running.store(false, std::memory_order_release);
+            wake.Signal();
+            thread.join();
+        }
+    }
+
+    // JS 线程：开始一次采集
+    void Activate(Napi::Env env)
+    {
+        if (activeClients++ == 0)
+        {
+            tsfn = Napi::ThreadSafeFunction::New(
+                env,
+                Napi::Function::New(env, [](const Napi::CallbackInfo &) {}),
+                "AudioCapture",
+                1, // callPending 保证最多只有一个待处理调用
+                1);
+            callPending.store(false);
+        }
+    }
+
+    // JS 线程：结束一次采集，调用前该实例的所有生产者线程都必须已经停止。
+    // 最后一路采集结束时释放 ThreadSafeFunction，已排队的调用仍会执行。
+    void Deactivate()
+    {
+        if (activeClients > 0 && --activeClients == 0)
+        {
+            tsfn.Release();
+            tsfn = Napi::ThreadSafeFunction();
+        }
+    }
+
+    // JS 线程：让投递线程开始为 client 服务，必要时启动线程
+    void StartServicing(Client *client)
+    {
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            servicing.push_back(client);
+        }
+        if (!thread.joinable())
+        {
+            running.store(true, std::memory_order_release);
+            thread = std::thread(&DeliveryScheduler::Loop, this);
+        }
+        wake.Signal();
+    }
+
+    // 任意线程：返回后投递线程不会再访问 client。
+    // 线程本身保留到调度器析构，使释放可以在工作线程上进行而不必 join
+    void StopServicing(Client *client)
+    {
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            servicing.erase(std::remove(servicing.begin(), servicing.end(), client), servicing.end());
+            EraseRealtime(client);
+        }
+        wake.Signal();
+    }
+
+    // 任意线程：投递线程按 client 的 IO 周期以实时优先级运行，workgroup 非空时加入它。
+    // periodNs 为 0 时撤销该实例的请求；StopServicing 也会撤销
+    void SetRealtime(Client *client, uint64_t periodNs, IoWorkgroup workgroup)
+    {
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            EraseRealtime(client);
+            if (periodNs > 0)
+            {
+                realtimeRequests.push_back({client, periodNs, std::move(workgroup)});
+            }
+            realtimeChanged = true;
+        }
+        wake.Signal();
+    }
+
+    // 任意线程（包括实时线程）：唤醒投递线程
+    void Signal()
+    {
+        wake.Signal();
+    }
+
+    // 任意线程：给实例登记待办工作并在必要时唤醒 JS 线程
+    napi_status Post(const std::shared_ptr<Handle> &handle, uint32_t work)
+    {
+        if (handle->pending.fetch_or(work) == 0)
+        {
+            std::lock_guard<std::mutex> lock(readyMutex);
+            ready.push_back(handle);
+        }
+        if (callPending.exchange(true))
+        {
+            return napi_ok;
+        }
+        return Schedule();
+    }
+};
@@ -0,0 +1,339 @@
+// shared_memory.h
+#pragma once
+#include <napi.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "ring_buffer.h"
+
+// 共享环形缓冲区的布局（SharedArrayBuffer 和命名共享内存相同）：
+// Int32 头部（写位置、读位置各占一个缓存行）后接交错 Float32 采样
+struct SharedRingLayout
+{
+    static constexpr uint32_t kHeaderInts = 32;
+    static constexpr uint32_t kHeaderBytes = kHeaderInts * sizeof(int32_t);
+    static constexpr uint32_t kWriteIndex = 0;
+    static constexpr uint32_t kCapacityIndex = 1;
+    static constexpr uint32_t kChannelsIndex = 2;
+    static constexpr uint32_t kSampleRateIndex = 3;
+    static constexpr uint32_t kMagicIndex = 4; // 仅命名共享内存：kMagic 表示头部已写好
+    static constexpr uint32_t kStateIndex = 5; // 仅命名共享内存：1 采集中，0 已结束
+    static constexpr uint32_t kReadIndex = 16;
+    static constexpr int32_t kMagic = 0x41435348; // "ACSH"
+
+    static size_t Bytes(uint32_t capacity, uint32_t channels)
+    {
+        return kHeaderBytes + static_cast<size_t>(capacity) * channels * sizeof(float);
+    }
+};
+
+// 命名的共享内存段，把采集环形缓冲区交给其他进程（如 Electron 渲染进程）直接读取，
+// 不经过 IPC 序列化。macOS/Linux 为 POSIX 共享内存，创建方负责 shm_unlink，已经映射的进程在 unlink 之后仍可继续访问；
+// Windows 为命名的文件映射，最后一个句柄关闭时释放
+class SharedMemorySegment
+{
+private:
+    std::string name;
+    void *address = nullptr;
+    size_t size = 0;
+#if defined(_WIN32)
+    HANDLE mapping = NULL;
+
+    static std::wstring WideName(const std::string &segmentName)
+    {
+        std::wstring wide = L"Local\\";
+        int length = MultiByteToWideChar(CP_UTF8, 0, segmentName.c_str(), -1, NULL, 0);
+        if (length > 1)
+        {
+            std::wstring converted(static_cast<size_t>(length - 1), L'\0');
+            MultiByteToWideChar(CP_UTF8, 0, segmentName.c_str(), -1, &converted[0], length);
+            wide += converted;
+        }
+        return wide;
+    }
+
+    static int LastErrno()
+    {
+        DWORD error = GetLastError();
+        return error == ERROR_FILE_NOT_FOUND ? ENOENT : error == ERROR_ACCESS_DENIED ? EACCES : EIO;
+    }
+#else
+    bool owner = false;
+
+    int Map(int fd, size_t bytes)
+    {
+        void *mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int error = mapped == MAP_FAILED ? errno : 0;
+        close(fd);
+        address = error == 0 ? mapped : nullptr;
+        size = error == 0 ? bytes : 0;
+        return error;
+    }
+#endif
+
+public:
+    SharedMemorySegment() = default;
+    SharedMemorySegment(const SharedMemorySegment &) = delete;
+    SharedMemorySegment &operator=(const SharedMemorySegment &) = delete;
+
+    ~SharedMemorySegment()
+    {
+        Close();
+    }
+
+    // 当前进程的 ID，用于自动命名
+    static unsigned long ProcessId()
+    {
+#if defined(_WIN32)
+        return GetCurrentProcessId();
+#else
+        return static_cast<unsigned long>(getpid());
+#endif
+    }
+
+    // 创建并映射 bytes 字节（先移除同名的残留段），内容为零。失败时返回 errno
+    int Create(const std::string &segmentName, size_t bytes)
+    {
+        Close();
+#if defined(_WIN32)
+        uint64_t length = bytes;
+        mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(length >> 32),
+                                     static_cast<DWORD>(length), WideName(segmentName).c_str());
+        if (!mapping || GetLastError() == ERROR_ALREADY_EXISTS)
+        {
+            int error = mapping ? EEXIST : LastErrno();
+            Close();
+            return error;
+        }
+        address = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+        if (!address)
+        {
+            int error = LastErrno();
+            Close();
+            return error;
+        }
+        size = bytes;
+#else
+        shm_unlink(segmentName.c_str());
+        int fd = shm_open(segmentName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0)
+        {
+            return errno;
+        }
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+        {
+            int error = errno;
+            close(fd);
+            shm_unlink(segmentName.c_str());
+            return error;
+        }
+        int error = Map(fd, bytes);
+        if (error != 0)
+        {
+            shm_unlink(segmentName.c_str());
+            return error;
+        }
+        owner = true;
+#endif
+        name = segmentName;
+        return 0;
+    }
+
+    // 映射已有的段，失败时返回 errno
+    int Open(const std::string &segmentName)
+    {
+        Close();
+#if defined(_WIN32)
+        mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, WideName(segmentName).c_str());
+        if (!mapping)
+        {
+            return LastErrno();
+        }
+        address = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+        MEMORY_BASIC_INFORMATION info;
+        if (!address || VirtualQuery(address, &info, sizeof(info)) == 0 || info.RegionSize < SharedRingLayout::kHeaderBytes)
+        {
+            int error = address ? EINVAL : LastErrno();
+            Close();
+            return error;
+        }
+        // 区域大小按页取整，实际的容量以头部为准
+        size = info.RegionSize;
+        name = segmentName;
+        return 0;
+#else
+        int fd = shm_open(segmentName.c_str(), O_RDWR, 0);
+        if (fd < 0)
+        {
+            return errno;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(SharedRingLayout::kHeaderBytes))
+        {
+            close(fd);
+            return EINVAL;
+        }
+        int error = Map(fd, static_cast<size_t>(info.st_size));
+        if (error == 0)
+        {
+            name = segmentName;
+        }
+        return error;
+#endif
+    }
+
+    void Close()
+    {
+#if defined(_WIN32)
+        if (address)
+        {
+            UnmapViewOfFile(address);
+            address = nullptr;
+        }
+        if (mapping)
+        {
+            CloseHandle(mapping);
+            mapping = NULL;
+        }
+#else
+        if (address)
+        {
+            munmap(address, size);
+            address = nullptr;
+        }
+        if (owner)
+        {
+            shm_unlink(name.c_str());
+            owner = false;
+        }
+#endif
+        size = 0;
+    }
+
+    bool IsOpen() const { return address != nullptr; }
+    int32_t *Header() const { return static_cast<int32_t *>(address); }
+    float *Samples() const { return reinterpret_cast<float *>(static_cast<uint8_t *>(address) + SharedRingLayout::kHeaderBytes); }
+    size_t Size() const { return size; }
+    const std::string &Name() const { return name; }
+};
+
+// 消费端：在另一个进程中打开 sharedMemory 模式的环形缓冲区。
+//   const reader = new SharedMemoryReader(name);
+//   const samples = reader.read(); // 交错 Float32Array，没有新数据时为 null
+// 读出时复制一次到 JS 分配的内存（启用内存沙箱的 Electron 不允许外部缓冲区），读位置写回共享内存。
+// 每个段只能有一个消费者
+class SharedMemoryReader : public Napi::ObjectWrap<SharedMemoryReader>
+{
+private:
+    SharedMemorySegment segment;
+    RingBuffer ring;
+    uint32_t sampleRate = 0;
+
+    bool CheckOpen(Napi::Env env)
+    {
+        if (!segment.IsOpen())
+        {
+            Napi::Error::New(env, "SharedMemoryReader is closed").ThrowAsJavaScriptException();
+            return false;
+        }
+        return true;
+    }
+
+public:
+    static Napi::Function Define(Napi::Env env)
+    {
+        return DefineClass(env, "SharedMemoryReader", {InstanceMethod("read", &SharedMemoryReader::Read), InstanceMethod("available", &SharedMemoryReader::Available), InstanceMethod("close", &SharedMemoryReader::Close), InstanceAccessor("capacity", &SharedMemoryReader::GetCapacity, nullptr), InstanceAccessor("channels", &SharedMemoryReader::GetChannels, nullptr), InstanceAccessor("sampleRate", &SharedMemoryReader::GetSampleRate, nullptr), InstanceAccessor("active", &SharedMemoryReader::GetActive, nullptr)});
+    }
+
+    SharedMemoryReader(const Napi::CallbackInfo &info) : Napi::ObjectWrap<SharedMemoryReader>(info)
+    {
+        Napi::Env env = info.Env();
+        if (!info[0].IsString())
+        {
+            Napi::TypeError::New(env, "name must be a string").ThrowAsJavaScriptException();
+            return;
+        }
+        std::string name = info[0].As<Napi::String>().Utf8Value();
+        int error = segment.Open(name);
+        if (error != 0)
+        {
+            Napi::Error::New(env, "Failed to open shared memory " + name + ": " + strerror(error)).ThrowAsJavaScriptException();
+            return;
+        }
+
+        int32_t *header = segment.Header();
+        uint32_t capacity = static_cast<uint32_t>(header[SharedRingLayout::kCapacityIndex]);
+        uint32_t channels = static_cast<uint32_t>(header[SharedRingLayout::kChannelsIndex]);
+        if (header[SharedRingLayout::kMagicIndex] != SharedRingLayout::kMagic || capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+            channels == 0 || SharedRingLayout::Bytes(capacity, channels) > segment.Size())
+        {
+            segment.Close();
+            Napi::Error::New(env, name + " is not an audio capture ring").ThrowAsJavaScriptException();
+            return;
+        }
+        sampleRate = static_cast<uint32_t>(header[SharedRingLayout::kSampleRateIndex]);
+        ring.Attach(segment.Samples(), capacity, channels,
+                    reinterpret_cast<std::atomic<uint32_t> *>(header + SharedRingLayout::kWriteIndex),
+                    reinterpret_cast<std::atomic<uint32_t> *>(header + SharedRingLayout::kReadIndex), false);
+    }
+
+    // read([maxFrames])：取出最多 maxFrames 帧（默认全部可读的数据）
+    Napi::Value Read(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (!CheckOpen(env))
+        {
+            return env.Undefined();
+        }
+        uint32_t frames = ring.AvailableRead();
+        if (info[0].IsNumber() && info[0].As<Napi::Number>().Uint32Value() < frames)
+        {
+            frames = info[0].As<Napi::Number>().Uint32Value();
+        }
+        if (frames == 0)
+        {
+            return env.Null();
+        }
+        Napi::Float32Array samples = Napi::Float32Array::New(env, static_cast<size_t>(frames) * ring.Channels());
+        ring.Read(samples.Data(), frames);
+        return samples;
+    }
+
+    Napi::Value Available(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (!CheckOpen(env))
+        {
+            return env.Undefined();
+        }
+        return Napi::Number::New(env, ring.AvailableRead());
+    }
+
+    Napi::Value Close(const Napi::CallbackInfo &info)
+    {
+        segment.Close();
+        return info.Env().Undefined();
+    }
+
+    Napi::Value GetCapacity(const Napi::CallbackInfo &info) { return Napi::Number::New(info.Env(), ring.Capacity()); }
+    Napi::Value GetChannels(const Napi::CallbackInfo &info) { return Napi::Number::New(info.Env(), ring.Channels()); }
+    Napi::Value GetSampleRate(const Napi::CallbackInfo &info) { return Napi::Number::New(info.Env(), sampleRate); }
+
+    // 生产端 dispose 后变为 false，剩余的数据仍可读完
+    Napi::Value GetActive(const Napi::CallbackInfo &info)
+    {
+        bool active = segment.IsOpen() &&
+                      reinterpret_cast<std::atomic<int32_t> *>(segment.Header() + SharedRingLayout::kStateIndex)->load(std::memory_order_acquire) == 1;
+        return Napi::Boolean::New(info.Env(), active);
+    }
+};
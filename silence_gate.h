@@ -0,0 +1,172 @@
+// silence_gate.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "dsp.h"
+
+// suppress：静音块不交给回调/文件/编码器；flag：全部交出，由 info.active 标记是否有声
+enum class GateMode
+{
+    Suppress,
+    Flag,
+};
+
+inline bool ParseGateMode(const std::string &name, GateMode &mode)
+{
+    if (name == "suppress")
+    {
+        mode = GateMode::Suppress;
+    }
+    else if (name == "flag")
+    {
+        mode = GateMode::Flag;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+struct GateOptions
+{
+    double thresholdDb = -50; // 块 RMS 门限（dBFS）
+    uint32_t hangoverMs = 300; // 低于门限后继续保持打开的时长
+    uint32_t preRollMs = 200;  // 打开时补发的之前的音频
+    GateMode mode = GateMode::Suppress;
+};
+
+// 能量门（简单的 VAD）：按块计算所有声道的 RMS，超过门限立即打开，
+// 连续低于门限 hangover 之后关闭。关闭期间最近 preRoll 的数据保存在历史中，
+// 打开时先交出，避免切掉语音的开头。只在投递线程上调用。
+class SilenceGate
+{
+public:
+    enum class State
+    {
+        Closed,  // 静音
+        Opening, // 本块打开了门，先取出 pre-roll
+        Open,
+    };
+
+private:
+    GateOptions options;
+    uint32_t channels = 0;
+    float thresholdPower = 0;
+    uint64_t hangoverFrames = 0;
+    uint64_t quietFrames = 0;
+    bool open = false;
+
+    // pre-roll 历史，循环写入
+    std::vector<float> history;
+    uint32_t historyCapacity = 0;
+    uint32_t historyPos = 0;
+    uint32_t historyFrames = 0;
+
+    std::atomic<uint64_t> suppressedFrames{0};
+    std::atomic<uint64_t> activations{0};
+
+public:
+    void Configure(const GateOptions &gateOptions, uint32_t sampleRate, uint32_t numChannels)
+    {
+        options = gateOptions;
+        channels = numChannels;
+        double threshold = std::pow(10.0, options.thresholdDb / 20.0);
+        thresholdPower = static_cast<float>(threshold * threshold);
+        hangoverFrames = static_cast<uint64_t>(options.hangoverMs) * sampleRate / 1000;
+        quietFrames = 0;
+        open = false;
+
+        historyCapacity = options.mode == GateMode::Suppress ? static_cast<uint32_t>(static_cast<uint64_t>(options.preRollMs) * sampleRate / 1000) : 0;
+        history.assign(static_cast<size_t>(historyCapacity) * channels, 0.0f);
+        historyPos = 0;
+        historyFrames = 0;
+        suppressedFrames.store(0, std::memory_order_relaxed);
+        activations.store(0, std::memory_order_relaxed);
+    }
+
+    GateMode Mode() const { return options.mode; }
+
+    // 判断交错采样块的状态
+    State Process(const float *samples, uint32_t frames)
+    {
+        if (frames == 0)
+        {
+            return open ? State::Open : State::Closed;
+        }
+
+        float squares = 0;
+        vDSP_svesq(samples, 1, &squares, static_cast<vDSP_Length>(frames) * channels);
+        bool loud = squares / (static_cast<float>(frames) * channels) >= thresholdPower;
+
+        if (loud)
+        {
+            quietFrames = 0;
+            if (!open)
+            {
+                open = true;
+                activations.fetch_add(1, std::memory_order_relaxed);
+                return State::Opening;
+            }
+            return State::Open;
+        }
+
+        if (open)
+        {
+            quietFrames += frames;
+            if (quietFrames <= hangoverFrames)
+            {
+                return State::Open;
+            }
+            open = false;
+        }
+        return State::Closed;
+    }
+
+    // 静音块：计入统计并保存到 pre-roll 历史
+    void Suppress(const float *samples, uint32_t frames)
+    {
+        suppressedFrames.fetch_add(frames, std::memory_order_relaxed);
+        if (historyCapacity == 0)
+        {
+            return;
+        }
+        if (frames > historyCapacity)
+        {
+            samples += static_cast<size_t>(frames - historyCapacity) * channels;
+            frames = historyCapacity;
+        }
+        uint32_t first = std::min(frames, historyCapacity - historyPos);
+        memcpy(history.data() + static_cast<size_t>(historyPos) * channels, samples, static_cast<size_t>(first) * channels * sizeof(float));
+        memcpy(history.data(), samples + static_cast<size_t>(first) * channels, static_cast<size_t>(frames - first) * channels * sizeof(float));
+        historyPos = (historyPos + frames) % historyCapacity;
+        historyFrames = std::min(historyFrames + frames, historyCapacity);
+    }
+
+    // 按时间顺序取出并清空 pre-roll 历史，返回帧数。这些帧紧接在打开门的块之前
+    uint32_t TakePreRoll(std::vector<float> &out)
+    {
+        uint32_t frames = historyFrames;
+        if (frames == 0)
+        {
+            return 0;
+        }
+        out.resize(static_cast<size_t>(frames) * channels);
+        uint32_t start = (historyPos + historyCapacity - frames) % historyCapacity;
+        uint32_t first = std::min(frames, historyCapacity - start);
+        memcpy(out.data(), history.data() + static_cast<size_t>(start) * channels, static_cast<size_t>(first) * channels * sizeof(float));
+        memcpy(out.data() + static_cast<size_t>(first) * channels, history.data(), static_cast<size_t>(frames - first) * channels * sizeof(float));
+        historyFrames = 0;
+        // 补发的帧不再算作被抑制
+        suppressedFrames.fetch_sub(frames, std::memory_order_relaxed);
+        return frames;
+    }
+
+    uint64_t SuppressedFrames() const { return suppressedFrames.load(std::memory_order_relaxed); }
+    uint64_t Activations() const { return activations.load(std::memory_order_relaxed); }
+};
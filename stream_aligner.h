@@ -0,0 +1,193 @@
+// stream_aligner.h
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "ring_buffer.h"
+#include "timestamps.h"
+
+// 把第二路输入（麦克风）对齐到主采集流：按主机时间计算主流每块首帧在输入流中的目标位置，
+// 用 PI 控制的可变比例重采样（Catmull-Rom 三次插值）跟踪目标，比例的积分项即两个设备时钟的漂移。
+// 偏差超过 kResyncSeconds 时直接跳到目标位置。只在投递线程上调用，统计可在任意线程读取
+class StreamAligner
+{
+private:
+    static constexpr uint32_t kChannels = 2;
+    static constexpr double kResponseSeconds = 1.0; // 比例项：约 1 秒消除位置偏差
+    static constexpr double kIntegralSeconds = 8.0; // 积分项时间常数
+    static constexpr double kMaxCorrection = 0.005; // 最多 ±5000 ppm
+    static constexpr double kResyncSeconds = 0.05;
+
+    double mainRate = 0;
+    double inputRate = 0;
+    double offsetFrames = 0;
+
+    // 从输入环形缓冲区取出、尚未消费的数据，fifo[0] 为输入流的第 fifoStart 帧
+    std::vector<float> fifo;
+    size_t fifoCapacity = 0;
+    size_t fifoFrames = 0;
+    uint64_t fifoStart = 0;
+
+    bool synced = false;
+    double position = 0; // 下一个输出帧对应的输入流位置（帧，可为小数）
+    double integral = 0;
+
+    std::atomic<double> driftPpm{0};
+    std::atomic<uint64_t> underrunFrames{0};
+    std::atomic<uint64_t> resyncs{0};
+
+    // 丢弃 frame 之前的数据
+    void Discard(uint64_t frame)
+    {
+        if (frame <= fifoStart)
+        {
+            return;
+        }
+        size_t drop = frame - fifoStart < fifoFrames ? static_cast<size_t>(frame - fifoStart) : fifoFrames;
+        memmove(fifo.data(), fifo.data() + drop * kChannels, (fifoFrames - drop) * kChannels * sizeof(float));
+        fifoFrames -= drop;
+        fifoStart += drop;
+    }
+
+    void Pull(RingBuffer &ring)
+    {
+        // 主流停顿时输入继续到达，先丢掉最旧的一半，保证总能取到最新的数据
+        if (fifoFrames + ring.AvailableRead() > fifoCapacity)
+        {
+            Discard(fifoStart + fifoFrames / 2 + 1);
+        }
+        size_t room = fifoCapacity - fifoFrames;
+        fifoFrames += ring.Read(fifo.data() + fifoFrames * kChannels, static_cast<uint32_t>(room));
+    }
+
+    // 主流的主机时间 hostTimeNs 对应的输入流位置，用最新一帧的时间戳按标称采样率外推
+    bool MapHostTime(const TimestampTrack &timestamps, uint64_t hostTimeNs, double &target) const
+    {
+        if (hostTimeNs == 0 || fifoFrames == 0)
+        {
+            return false;
+        }
+        uint64_t newest = fifoStart + fifoFrames - 1;
+        ChunkTime time;
+        if (!timestamps.Lookup(newest, time) || time.hostTimeNs == 0)
+        {
+            return false;
+        }
+        double deltaNs = static_cast<double>(hostTimeNs) - static_cast<double>(time.hostTimeNs);
+        target = static_cast<double>(newest) + deltaNs * inputRate / 1e9 - offsetFrames;
+        return true;
+    }
+
+    float Sample(int64_t index, uint32_t ch) const
+    {
+        return fifo[static_cast<size_t>(index) * kChannels + ch];
+    }
+
+public:
+    // ringCapacity 为输入环形缓冲区的容量；offsetMs 为正时输入相对主流再延后
+    void Configure(double mainSampleRate, double inputSampleRate, uint32_t ringCapacity, double offsetMs)
+    {
+        mainRate = mainSampleRate;
+        inputRate = inputSampleRate;
+        offsetFrames = offsetMs * inputRate / 1000;
+        fifoCapacity = ringCapacity * 2;
+        fifo.assign(fifoCapacity * kChannels, 0.0f);
+        fifoFrames = 0;
+        fifoStart = 0;
+        synced = false;
+        position = 0;
+        integral = 0;
+        driftPpm.store(0);
+        underrunFrames.store(0);
+        resyncs.store(0);
+    }
+
+    // 主流从 hostTimeNs 开始的 frames 帧所需的输入是否已经到达
+    bool Covers(RingBuffer &ring, const TimestampTrack &timestamps, uint64_t hostTimeNs, uint32_t frames)
+    {
+        Pull(ring);
+        double start = position;
+        if (!synced && !MapHostTime(timestamps, hostTimeNs, start))
+        {
+            return false;
+        }
+        double needed = start + frames * (inputRate / mainRate) * (1 + kMaxCorrection) + 2;
+        return needed < static_cast<double>(fifoStart + fifoFrames);
+    }
+
+    // 生成与主流这一块对齐的输入数据：out 为 frames 帧交错立体声，采样率与主流相同。
+    // 没有可用数据的帧填零并计入 underrunFrames
+    void Render(RingBuffer &ring, const TimestampTrack &timestamps, uint64_t hostTimeNs, uint32_t frames, float *out)
+    {
+        Pull(ring);
+        double nominal = inputRate / mainRate;
+        double correction = 0;
+        double target = 0;
+        bool mapped = MapHostTime(timestamps, hostTimeNs, target);
+        if (!synced)
+        {
+            if (!mapped)
+            {
+                memset(out, 0, static_cast<size_t>(frames) * kChannels * sizeof(float));
+                underrunFrames.fetch_add(frames, std::memory_order_relaxed);
+                return;
+            }
+            position = target;
+            integral = 0;
+            synced = true;
+        }
+        else if (mapped)
+        {
+            double error = target - position;
+            if (std::fabs(error) > kResyncSeconds * inputRate)
+            {
+                position = target;
+                integral = 0;
+                error = 0;
+                resyncs.fetch_add(1, std::memory_order_relaxed);
+            }
+            integral += error * frames / mainRate;
+            correction = (error + integral / kIntegralSeconds) / (inputRate * kResponseSeconds);
+            correction = correction > kMaxCorrection ? kMaxCorrection : (correction < -kMaxCorrection ? -kMaxCorrection : correction);
+            driftPpm.store(1e6 * integral / kIntegralSeconds / (inputRate * kResponseSeconds), std::memory_order_relaxed);
+        }
+
+        double step = nominal * (1 + correction);
+        int64_t last = static_cast<int64_t>(fifoFrames) - 1;
+        uint64_t missing = 0;
+        for (uint32_t i = 0; i < frames; i++)
+        {
+            double pos = position + i * step - static_cast<double>(fifoStart);
+            int64_t index = static_cast<int64_t>(std::floor(pos));
+            float t = static_cast<float>(pos - index);
+            float *frame = out + static_cast<size_t>(i) * kChannels;
+            if (index < 1 || index + 2 > last)
+            {
+                frame[0] = frame[1] = 0;
+                missing++;
+                continue;
+            }
+            for (uint32_t ch = 0; ch < kChannels; ch++)
+            {
+                float y0 = Sample(index - 1, ch), y1 = Sample(index, ch), y2 = Sample(index + 1, ch), y3 = Sample(index + 2, ch);
+                frame[ch] = y1 + 0.5f * t * (y2 - y0 + t * (2.0f * y0 - 5.0f * y1 + 4.0f * y2 - y3 + t * (3.0f * (y1 - y2) + y3 - y0)));
+            }
+        }
+        if (missing > 0)
+        {
+            underrunFrames.fetch_add(missing, std::memory_order_relaxed);
+        }
+
+        position += frames * step;
+        if (position > 2)
+        {
+            Discard(static_cast<uint64_t>(position) - 2);
+        }
+    }
+
+    double DriftPpm() const { return driftPpm.load(std::memory_order_relaxed); }
+    uint64_t UnderrunFrames() const { return underrunFrames.load(std::memory_order_relaxed); }
+    uint64_t Resyncs() const { return resyncs.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,200 @@
+// synthetic_source.cc
+// 基准/长时间运行测试用的合成后端：按设定的采样率和缓冲区大小定时产生正弦波，
+// 经过与真实后端相同的 IO 回调、环形缓冲区和投递管线，不需要音频硬件。
+// 作为输入（麦克风）打开时产生 880 Hz，便于区分两路。
+// 同时替换本模块的 operator new/delete 统计堆分配次数，getStats().heapAllocations 供 bench.js 计算每秒分配数
+#include "capture_source.h"
+#include "capture_stats.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+namespace
+{
+    std::atomic<uint64_t> heapAllocations{0};
+
+    void *CountedAllocate(std::size_t size)
+    {
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(size > 0 ? size : 1);
+    }
+}
+
+uint64_t HeapAllocations()
+{
+    return heapAllocations.load(std::memory_order_relaxed);
+}
+
+void *operator new(std::size_t size)
+{
+    void *p = CountedAllocate(size);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+class SyntheticSource : public CaptureSource
+{
+private:
+    static constexpr uint32_t kDefaultSampleRate = 48000;
+    static constexpr uint32_t kDefaultBufferFrames = 512;
+    static constexpr double kTwoPi = 6.283185307179586;
+
+    uint32_t sampleRate = 0;
+    uint32_t bufferFrames = 0;
+    std::unique_ptr<float[]> buffer;
+    double frequency = 440;
+    double phase = 0;
+    uint64_t position = 0;
+
+    CaptureCallback callback = nullptr;
+    void *context = nullptr;
+    std::atomic<bool> running{false};
+    std::thread thread;
+
+    // 按绝对截止时间推进，避免累计误差；落后超过一个周期时重新对齐并留下一次时间戳跳变
+    void Loop()
+    {
+        using Clock = std::chrono::steady_clock;
+        const auto period = std::chrono::nanoseconds(static_cast<int64_t>(1e9 * bufferFrames / sampleRate));
+        const double step = kTwoPi * frequency / sampleRate;
+        auto deadline = Clock::now();
+
+        while (running.load(std::memory_order_acquire))
+        {
+            deadline += period;
+            std::this_thread::sleep_until(deadline);
+            auto now = Clock::now();
+            if (now - deadline > period)
+            {
+                position += static_cast<uint64_t>((now - deadline) / period) * bufferFrames;
+                deadline = now;
+            }
+
+            for (uint32_t i = 0; i < bufferFrames; i++)
+            {
+                float sample = 0.25f * static_cast<float>(std::sin(phase));
+                buffer[i * kChannels] = sample;
+                buffer[i * kChannels + 1] = sample;
+                phase += step;
+            }
+            phase = std::fmod(phase, kTwoPi);
+
+            CaptureSourceTime time;
+            time.sampleTimeValid = true;
+            time.sampleTime = static_cast<double>(position);
+            time.hostTimeNs = HostTimeNs();
+            callback(context, buffer.get(), bufferFrames, time);
+            position += bufferFrames;
+        }
+    }
+
+public:
+    SyntheticSource() = default;
+    SyntheticSource(const SyntheticSource &) = delete;
+    SyntheticSource &operator=(const SyntheticSource &) = delete;
+
+    ~SyntheticSource()
+    {
+        Close();
+    }
+
+    std::string Open(const CaptureSourceOptions &options, CaptureCallback captureCallback, void *callbackContext) override
+    {
+        Close();
+        callback = captureCallback;
+        context = callbackContext;
+        sampleRate = options.sampleRate > 0 ? options.sampleRate : kDefaultSampleRate;
+        bufferFrames = options.bufferFrames > 0 ? options.bufferFrames : kDefaultBufferFrames;
+        buffer = std::make_unique<float[]>(static_cast<size_t>(bufferFrames) * kChannels);
+        frequency = options.input ? 880 : 440;
+        phase = 0;
+        position = 0;
+        return std::string();
+    }
+
+    uint32_t SampleRate() const override { return sampleRate; }
+    uint32_t BufferFrames() const override { return bufferFrames; }
+
+    std::string Start() override
+    {
+        if (!running.exchange(true))
+        {
+            thread = std::thread(&SyntheticSource::Loop, this);
+        }
+        return std::string();
+    }
+
+    void Stop() override
+    {
+        if (running.exchange(false))
+        {
+            thread.join();
+        }
+    }
+
+    void Close() override
+    {
+        Stop();
+        buffer.reset();
+    }
+};
+
+std::unique_ptr<CaptureSource> CreateCaptureSource()
+{
+    return std::make_unique<SyntheticSource>();
+}
+
+std::vector<CaptureDeviceInfo> ListCaptureDevices()
+{
+    CaptureDeviceInfo info;
+    info.id = "synthetic";
+    info.uid = info.id;
+    info.name = "Synthetic 440 Hz";
+    info.inputChannels = CaptureSource::kChannels;
+    info.outputChannels = CaptureSource::kChannels;
+    info.sampleRate = 48000;
+    info.isDefaultInput = true;
+    info.isDefaultOutput = true;
+    return {info};
+}
@@ -0,0 +1,152 @@
+// thread_priority.h
+#pragma once
+#include <cstdint>
+#include <memory>
+#if defined(__APPLE__)
+#include <CoreAudio/CoreAudio.h>
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+#include "capture_stats.h"
+#include "devices.h"
+#if __has_include(<os/workgroup.h>)
+#include <os/workgroup.h>
+#define AUDIO_CAPTURE_HAS_WORKGROUP 1
+#endif
+#elif defined(_WIN32)
+#include <windows.h>
+#include <avrt.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// 设备 IO 线程的 os_workgroup（macOS 11+），空指针表示没有
+using IoWorkgroup = std::shared_ptr<void>;
+
+#if defined(__APPLE__)
+// 查询设备 IO 线程所属的 workgroup，返回的引用在最后一个持有者释放时 os_release
+inline IoWorkgroup DeviceIoWorkgroup(AudioDeviceID device)
+{
+#ifdef AUDIO_CAPTURE_HAS_WORKGROUP
+    if (__builtin_available(macOS 11.0, *))
+    {
+        os_workgroup_t workgroup = nullptr;
+        UInt32 size = sizeof(workgroup);
+        AudioObjectPropertyAddress address = DeviceAddress(kAudioDevicePropertyIOThreadOSWorkgroup);
+        if (device != kAudioObjectUnknown &&
+            AudioObjectGetPropertyData(device, &address, 0, nullptr, &size, &workgroup) == noErr && workgroup)
+        {
+            return IoWorkgroup(workgroup, [](void *object)
+                               { os_release(object); });
+        }
+    }
+#endif
+    return nullptr;
+}
+#endif
+
+// 处理线程的实时调度，只在该线程自身上调用。
+// macOS：按 IO 周期设置 time-constraint 策略并加入设备 IO 线程的 workgroup，
+// 使内核在大小核之间按 IO 截止时间调度它；Windows：加入 MMCSS "Pro Audio"；
+// Linux：尝试 SCHED_RR（需要 RLIMIT_RTPRIO 或 CAP_SYS_NICE，失败时保持默认优先级）。
+class RealtimeThread
+{
+private:
+    uint64_t periodNs = 0;
+    IoWorkgroup joined;
+#if defined(__APPLE__)
+#ifdef AUDIO_CAPTURE_HAS_WORKGROUP
+    os_workgroup_join_token_s joinToken = {};
+#endif
+#elif defined(_WIN32)
+    HANDLE mmcss = NULL;
+#else
+    bool promoted = false;
+#endif
+
+    void Join(const IoWorkgroup &workgroup)
+    {
+        if (workgroup == joined)
+        {
+            return;
+        }
+#ifdef AUDIO_CAPTURE_HAS_WORKGROUP
+        if (__builtin_available(macOS 11.0, *))
+        {
+            if (joined)
+            {
+                os_workgroup_leave(static_cast<os_workgroup_t>(joined.get()), &joinToken);
+                joined.reset();
+            }
+            if (workgroup && os_workgroup_join(static_cast<os_workgroup_t>(workgroup.get()), &joinToken) == 0)
+            {
+                joined = workgroup;
+            }
+        }
+#endif
+    }
+
+    void SetPolicy(uint64_t period)
+    {
+#if defined(__APPLE__)
+        thread_port_t thread = pthread_mach_thread_np(pthread_self());
+        if (period == 0)
+        {
+            thread_standard_policy_data_t policy = {};
+            thread_policy_set(thread, THREAD_STANDARD_POLICY, reinterpret_cast<thread_policy_t>(&policy), THREAD_STANDARD_POLICY_COUNT);
+            return;
+        }
+        // 每个周期最多占用一半的 CPU 时间，必须在一个周期内完成
+        thread_time_constraint_policy_data_t policy;
+        policy.period = static_cast<uint32_t>(NsToHostTicks(period));
+        policy.computation = static_cast<uint32_t>(NsToHostTicks(period / 2));
+        policy.constraint = static_cast<uint32_t>(NsToHostTicks(period));
+        policy.preemptible = 1;
+        thread_policy_set(thread, THREAD_TIME_CONSTRAINT_POLICY, reinterpret_cast<thread_policy_t>(&policy), THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+#elif defined(_WIN32)
+        if (period > 0 && !mmcss)
+        {
+            DWORD taskIndex = 0;
+            mmcss = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+        }
+        else if (period == 0 && mmcss)
+        {
+            AvRevertMmThreadCharacteristics(mmcss);
+            mmcss = NULL;
+        }
+#else
+        if (period > 0 && !promoted)
+        {
+            sched_param param = {};
+            param.sched_priority = sched_get_priority_min(SCHED_RR) + 10;
+            promoted = pthread_setschedparam(pthread_self(), SCHED_RR, &param) == 0;
+        }
+        else if (period == 0 && promoted)
+        {
+            sched_param param = {};
+            pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+            promoted = false;
+        }
+#endif
+    }
+
+public:
+    RealtimeThread() = default;
+    RealtimeThread(const RealtimeThread &) = delete;
+    RealtimeThread &operator=(const RealtimeThread &) = delete;
+
+    // period 为 0 时离开 workgroup 并恢复默认调度
+    void Apply(uint64_t period, const IoWorkgroup &workgroup)
+    {
+        Join(period > 0 ? workgroup : nullptr);
+        if (period != periodNs)
+        {
+            SetPolicy(period);
+            periodNs = period;
+        }
+    }
+
+    bool InWorkgroup() const { return joined != nullptr; }
+    uint64_t PeriodNs() const { return periodNs; }
+};
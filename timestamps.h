@@ -0,0 +1,77 @@
+// timestamps.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// 一块数据首帧的时间信息
+struct ChunkTime
+{
+    uint64_t frame = 0;      // 自开始采集以来的采集帧序号，出现跳变说明中间有丢帧
+    double sampleTime = 0;   // 设备采样时间（AudioTimeStamp::mSampleTime）
+    uint64_t hostTimeNs = 0; // 主机时间，mach_absolute_time 换算的纳秒，0 表示无效
+};
+
+// IO 线程每个周期记录一个锚点：写入环形缓冲区的第 ringFrame 帧对应的时间戳。
+// 投递线程按读出位置查找最近的锚点并外推，得到任意一块数据首帧的时间。
+// 单生产者/单消费者，生产者覆盖写，消费者读完后检查条目是否已被覆盖。
+class TimestampTrack
+{
+public:
+    struct Anchor
+    {
+        uint64_t ringFrame = 0;
+        ChunkTime time;
+    };
+
+private:
+    static constexpr uint32_t kAnchors = 1024;
+    static constexpr uint32_t kMask = kAnchors - 1;
+
+    Anchor anchors[kAnchors];
+    std::atomic<uint32_t> writeCount{0};
+    double nsPerFrame = 0;
+    double sampleTimePerFrame = 1;
+
+public:
+    // captureRate 为环形缓冲区中的采样率，deviceRate 为 mSampleTime 所在时钟的采样率
+    void Reset(double captureRate, double deviceRate)
+    {
+        writeCount.store(0, std::memory_order_relaxed);
+        nsPerFrame = captureRate > 0 ? 1e9 / captureRate : 0;
+        sampleTimePerFrame = captureRate > 0 && deviceRate > 0 ? deviceRate / captureRate : 1;
+    }
+
+    // 生产者（IO 线程）
+    void Push(const Anchor &anchor)
+    {
+        uint32_t w = writeCount.load(std::memory_order_relaxed);
+        anchors[w & kMask] = anchor;
+        writeCount.store(w + 1, std::memory_order_release);
+    }
+
+    // 消费者：找不到锚点（尚无时间戳或消费者落后太多）时返回 false
+    bool Lookup(uint64_t ringFrame, ChunkTime &time) const
+    {
+        uint32_t w = writeCount.load(std::memory_order_acquire);
+        uint32_t n = w < kAnchors ? w : kAnchors;
+        for (uint32_t i = 1; i <= n; i++)
+        {
+            uint32_t index = w - i;
+            Anchor anchor = anchors[index & kMask];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (writeCount.load(std::memory_order_relaxed) - index >= kAnchors)
+            {
+                return false; // 已被覆盖
+            }
+            if (anchor.ringFrame <= ringFrame)
+            {
+                uint64_t offset = ringFrame - anchor.ringFrame;
+                time.frame = anchor.time.frame + offset;
+                time.sampleTime = anchor.time.sampleTime + offset * sampleTimePerFrame;
+                time.hostTimeNs = anchor.time.hostTimeNs > 0 ? anchor.time.hostTimeNs + static_cast<uint64_t>(offset * nsPerFrame) : 0;
+                return true;
+            }
+        }
+        return false;
+    }
+};
@@ -0,0 +1,86 @@
+// wake_event.h
+#pragma once
+#include <cstdint>
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#include <climits>
+#else
+#include <semaphore.h>
+#include <cerrno>
+#include <ctime>
+#endif
+
+// 计数信号量：Signal 不加锁、不分配内存，可以在实时线程调用；Wait 可以带超时。
+// macOS 用 dispatch 信号量，Windows 用内核信号量，Linux 用 POSIX 信号量
+class WakeEvent
+{
+#if defined(__APPLE__)
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+#elif defined(_WIN32)
+    HANDLE semaphore = CreateSemaphoreW(NULL, 0, LONG_MAX, NULL);
+#else
+    sem_t semaphore;
+#endif
+
+public:
+    WakeEvent()
+    {
+#if !defined(__APPLE__) && !defined(_WIN32)
+        sem_init(&semaphore, 0, 0);
+#endif
+    }
+
+    WakeEvent(const WakeEvent &) = delete;
+    WakeEvent &operator=(const WakeEvent &) = delete;
+
+    ~WakeEvent()
+    {
+#if defined(__APPLE__)
+        dispatch_release(semaphore);
+#elif defined(_WIN32)
+        CloseHandle(semaphore);
+#else
+        sem_destroy(&semaphore);
+#endif
+    }
+
+    void Signal()
+    {
+#if defined(__APPLE__)
+        dispatch_semaphore_signal(semaphore);
+#elif defined(_WIN32)
+        ReleaseSemaphore(semaphore, 1, NULL);
+#else
+        sem_post(&semaphore);
+#endif
+    }
+
+    // 等待一次 Signal，timeoutNs < 0 时一直等待
+    void Wait(int64_t timeoutNs)
+    {
+#if defined(__APPLE__)
+        dispatch_semaphore_wait(semaphore, timeoutNs < 0 ? DISPATCH_TIME_FOREVER : dispatch_time(DISPATCH_TIME_NOW, timeoutNs));
+#elif defined(_WIN32)
+        WaitForSingleObject(semaphore, timeoutNs < 0 ? INFINITE : static_cast<DWORD>((timeoutNs + 999999) / 1000000));
+#else
+        if (timeoutNs < 0)
+        {
+            while (sem_wait(&semaphore) != 0 && errno == EINTR)
+            {
+            }
+            return;
+        }
+        // sem_timedwait 按 CLOCK_REALTIME 计算截止时间
+        timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        int64_t nsec = deadline.tv_nsec + timeoutNs;
+        deadline.tv_sec += static_cast<time_t>(nsec / 1000000000);
+        deadline.tv_nsec = static_cast<long>(nsec % 1000000000);
+        while (sem_timedwait(&semaphore, &deadline) != 0 && errno == EINTR)
+        {
+        }
+#endif
+    }
+};
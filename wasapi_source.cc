@@ -0,0 +1,461 @@
+// wasapi_source.cc
+// CoIncrementMTAUsage 需要 Windows 8 及以上的 SDK 声明
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0A00
+#include "capture_source.h"
+#include <windows.h>
+#include <mmdeviceapi.h>
+#include <audioclient.h>
+#include <functiondiscoverykeys_devpkey.h>
+#include <avrt.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+    template <typename T>
+    void SafeRelease(T *&object)
+    {
+        if (object)
+        {
+            object->Release();
+            object = nullptr;
+        }
+    }
+
+    std::string Utf8(const wchar_t *text)
+    {
+        if (!text)
+        {
+            return std::string();
+        }
+        int length = WideCharToMultiByte(CP_UTF8, 0, text, -1, NULL, 0, NULL, NULL);
+        if (length <= 1)
+        {
+            return std::string();
+        }
+        std::string result(length - 1, '\0');
+        WideCharToMultiByte(CP_UTF8, 0, text, -1, &result[0], length, NULL, NULL);
+        return result;
+    }
+
+    std::wstring Wide(const std::string &text)
+    {
+        int length = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, NULL, 0);
+        if (length <= 1)
+        {
+            return std::wstring();
+        }
+        std::wstring result(length - 1, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, &result[0], length);
+        return result;
+    }
+
+    std::string HResultError(const char *message, HRESULT hr)
+    {
+        char code[16];
+        snprintf(code, sizeof(code), "0x%08lX", static_cast<unsigned long>(hr));
+        return std::string(message) + " (HRESULT " + code + ")";
+    }
+
+    // 准备/释放在 libuv 工作线程上进行，Start/Stop 在 JS 线程上进行。
+    // 用进程级的 MTA 引用代替逐线程的 CoInitializeEx，使这些线程都能调用同一组 COM 对象
+    class MtaUsage
+    {
+        CO_MTA_USAGE_COOKIE cookie = nullptr;
+
+    public:
+        MtaUsage() = default;
+        MtaUsage(const MtaUsage &) = delete;
+        MtaUsage &operator=(const MtaUsage &) = delete;
+        ~MtaUsage() { Release(); }
+
+        HRESULT Acquire()
+        {
+            return cookie ? S_OK : CoIncrementMTAUsage(&cookie);
+        }
+
+        void Release()
+        {
+            if (cookie)
+            {
+                CoDecrementMTAUsage(cookie);
+                cookie = nullptr;
+            }
+        }
+    };
+
+    // id 为空时取 flow 方向（eRender 输出 / eCapture 输入）的默认端点
+    IMMDevice *FindDevice(IMMDeviceEnumerator *enumerator, const std::string &id, EDataFlow flow, HRESULT &hr)
+    {
+        IMMDevice *device = nullptr;
+        if (id.empty())
+        {
+            hr = enumerator->GetDefaultAudioEndpoint(flow, eConsole, &device);
+        }
+        else
+        {
+            hr = enumerator->GetDevice(Wide(id).c_str(), &device);
+        }
+        return SUCCEEDED(hr) ? device : nullptr;
+    }
+}
+
+// 共享模式环回采集默认输出设备（或指定的输出设备）的混音；input 为 true 时直接采集输入端点（麦克风）。
+// 事件驱动：音频引擎每个周期触发一次事件，采集线程以 MMCSS "Pro Audio" 优先级运行。
+// 由 AUTOCONVERTPCM 把混音格式转换为立体声 Float32 和请求的采样率。
+// 注意：没有任何程序在播放时环回流不产生数据包，这段时间表现为时间戳的跳变
+class WasapiSource : public CaptureSource
+{
+private:
+    MtaUsage mta;
+    IAudioClient *client = nullptr;
+    IAudioCaptureClient *captureClient = nullptr;
+    HANDLE audioEvent = NULL;
+    uint32_t sampleRate = 0;
+    uint32_t bufferFrames = 0;
+    std::unique_ptr<float[]> silence; // AUDCLNT_BUFFERFLAGS_SILENT 的数据包按静音处理
+
+    CaptureCallback callback = nullptr;
+    void *context = nullptr;
+    std::atomic<bool> running{false};
+    std::thread thread;
+
+    void Loop()
+    {
+        CoInitializeEx(NULL, COINIT_MULTITHREADED);
+        DWORD taskIndex = 0;
+        HANDLE task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+
+        while (running.load(std::memory_order_acquire))
+        {
+            if (WaitForSingleObject(audioEvent, 200) != WAIT_OBJECT_0)
+            {
+                continue;
+            }
+
+            UINT32 packetFrames = 0;
+            while (running.load(std::memory_order_relaxed) &&
+                   SUCCEEDED(captureClient->GetNextPacketSize(&packetFrames)) && packetFrames > 0)
+            {
+                BYTE *data = nullptr;
+                UINT32 frames = 0;
+                DWORD flags = 0;
+                UINT64 devicePosition = 0;
+                UINT64 qpcPosition = 0;
+                if (FAILED(captureClient->GetBuffer(&data, &frames, &flags, &devicePosition, &qpcPosition)))
+                {
+                    break;
+                }
+
+                // devicePosition 以帧计；qpcPosition 以 100ns 计，与 QueryPerformanceCounter 同一时钟
+                CaptureSourceTime time;
+                if (!(flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR))
+                {
+                    time.sampleTimeValid = true;
+                    time.sampleTime = static_cast<double>(devicePosition);
+                    time.hostTimeNs = qpcPosition * 100;
+                }
+
+                const float *samples = reinterpret_cast<const float *>(data);
+                if ((flags & AUDCLNT_BUFFERFLAGS_SILENT) && frames <= bufferFrames)
+                {
+                    samples = silence.get();
+                }
+                if (frames > 0)
+                {
+                    callback(context, samples, frames, time);
+                }
+                captureClient->ReleaseBuffer(frames);
+            }
+        }
+
+        if (task)
+        {
+            AvRevertMmThreadCharacteristics(task);
+        }
+        CoUninitialize();
+    }
+
+public:
+    WasapiSource() = default;
+    WasapiSource(const WasapiSource &) = delete;
+    WasapiSource &operator=(const WasapiSource &) = delete;
+
+    ~WasapiSource()
+    {
+        Close();
+    }
+
+    std::string Open(const CaptureSourceOptions &options, CaptureCallback captureCallback, void *callbackContext) override
+    {
+        Close();
+        callback = captureCallback;
+        context = callbackContext;
+
+        HRESULT hr = mta.Acquire();
+        if (FAILED(hr))
+        {
+            return HResultError("Failed to initialize COM", hr);
+        }
+
+        IMMDeviceEnumerator *enumerator = nullptr;
+        hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator), reinterpret_cast<void **>(&enumerator));
+        if (FAILED(hr))
+        {
+            Close();
+            return HResultError("Failed to create device enumerator", hr);
+        }
+
+        IMMDevice *device = FindDevice(enumerator, options.device, options.input ? eCapture : eRender, hr);
+        SafeRelease(enumerator);
+        if (!device)
+        {
+            Close();
+            if (options.input)
+            {
+                return "No usable microphone input device";
+            }
+            return options.device.empty() ? HResultError("Failed to get default output device", hr) : "Audio device '" + options.device + "' not found";
+        }
+
+        // 指定的是输入端点时直接采集，输出端点才环回
+        EDataFlow flow = options.input ? eCapture : eRender;
+        IMMEndpoint *endpoint = nullptr;
+        if (SUCCEEDED(device->QueryInterface(__uuidof(IMMEndpoint), reinterpret_cast<void **>(&endpoint))))
+        {
+            endpoint->GetDataFlow(&flow);
+            SafeRelease(endpoint);
+        }
+
+        hr = device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, NULL, reinterpret_cast<void **>(&client));
+        SafeRelease(device);
+        if (FAILED(hr))
+        {
+            Close();
+            return HResultError("Failed to activate audio client", hr);
+        }
+
+        WAVEFORMATEX *mixFormat = nullptr;
+        hr = client->GetMixFormat(&mixFormat);
+        if (FAILED(hr))
+        {
+            Close();
+            return HResultError("Failed to get mix format", hr);
+        }
+        sampleRate = options.sampleRate > 0 ? options.sampleRate : mixFormat->nSamplesPerSec;
+        CoTaskMemFree(mixFormat);
+
+        WAVEFORMATEXTENSIBLE format = {};
+        format.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+        format.Format.nChannels = kChannels;
+        format.Format.nSamplesPerSec = sampleRate;
+        format.Format.wBitsPerSample = 32;
+        format.Format.nBlockAlign = kChannels * sizeof(float);
+        format.Format.nAvgBytesPerSec = sampleRate * format.Format.nBlockAlign;
+        format.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+        format.Samples.wValidBitsPerSample = 32;
+        format.dwChannelMask = SPEAKER_FRONT_LEFT | SPEAKER_FRONT_RIGHT;
+        format.SubFormat = KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
+
+        // 缓冲区时长以 100ns 计，0 表示使用引擎默认值
+        REFERENCE_TIME duration = options.bufferFrames > 0 ? static_cast<REFERENCE_TIME>(options.bufferFrames) * 10000000 / sampleRate : 0;
+        DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK | AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM | AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY;
+        if (flow == eRender)
+        {
+            flags |= AUDCLNT_STREAMFLAGS_LOOPBACK;
+        }
+        hr = client->Initialize(AUDCLNT_SHAREMODE_SHARED, flags, duration, 0, &format.Format, NULL);
+        if (FAILED(hr))
+        {
+            Close();
+            return HResultError("Failed to initialize audio client", hr);
+        }
+
+        UINT32 frames = 0;
+        audioEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (!audioEvent)
+        {
+            Close();
+            return HResultError("Failed to create audio event", HRESULT_FROM_WIN32(GetLastError()));
+        }
+        hr = client->SetEventHandle(audioEvent);
+        if (SUCCEEDED(hr))
+        {
+            hr = client->GetBufferSize(&frames);
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = client->GetService(__uuidof(IAudioCaptureClient), reinterpret_cast<void **>(&captureClient));
+        }
+        if (FAILED(hr))
+        {
+            Close();
+            return HResultError("Failed to configure audio client", hr);
+        }
+
+        bufferFrames = frames;
+        silence = std::make_unique<float[]>(static_cast<size_t>(bufferFrames) * kChannels);
+        return std::string();
+    }
+
+    uint32_t SampleRate() const override { return sampleRate; }
+    uint32_t BufferFrames() const override { return bufferFrames; }
+
+    std::string Start() override
+    {
+        if (running.load())
+        {
+            return std::string();
+        }
+        HRESULT hr = client->Start();
+        if (FAILED(hr))
+        {
+            return HResultError("Failed to start audio client", hr);
+        }
+        running.store(true, std::memory_order_release);
+        thread = std::thread(&WasapiSource::Loop, this);
+        return std::string();
+    }
+
+    void Stop() override
+    {
+        if (!running.exchange(false))
+        {
+            return;
+        }
+        SetEvent(audioEvent);
+        thread.join();
+        client->Stop();
+    }
+
+    void Close() override
+    {
+        Stop();
+        if (client)
+        {
+            client->Reset();
+        }
+        SafeRelease(captureClient);
+        SafeRelease(client);
+        if (audioEvent)
+        {
+            CloseHandle(audioEvent);
+            audioEvent = NULL;
+        }
+        silence.reset();
+        mta.Release();
+    }
+};
+
+std::unique_ptr<CaptureSource> CreateCaptureSource()
+{
+    return std::make_unique<WasapiSource>();
+}
+
+namespace
+{
+    std::string DefaultEndpointId(IMMDeviceEnumerator *enumerator, EDataFlow flow)
+    {
+        std::string result;
+        HRESULT hr = S_OK;
+        IMMDevice *device = FindDevice(enumerator, std::string(), flow, hr);
+        if (device)
+        {
+            LPWSTR id = nullptr;
+            if (SUCCEEDED(device->GetId(&id)))
+            {
+                result = Utf8(id);
+                CoTaskMemFree(id);
+            }
+            SafeRelease(device);
+        }
+        return result;
+    }
+}
+
+// 所有活动的端点：输出设备可以环回采集，输入设备可以作为麦克风。id 为端点 ID 字符串
+std::vector<CaptureDeviceInfo> ListCaptureDevices()
+{
+    std::vector<CaptureDeviceInfo> devices;
+    MtaUsage mta;
+    IMMDeviceEnumerator *enumerator = nullptr;
+    if (FAILED(mta.Acquire()) ||
+        FAILED(CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator), reinterpret_cast<void **>(&enumerator))))
+    {
+        return devices;
+    }
+
+    std::string defaultOutput = DefaultEndpointId(enumerator, eRender);
+    std::string defaultInput = DefaultEndpointId(enumerator, eCapture);
+
+    IMMDeviceCollection *collection = nullptr;
+    UINT count = 0;
+    if (FAILED(enumerator->EnumAudioEndpoints(eAll, DEVICE_STATE_ACTIVE, &collection)) || FAILED(collection->GetCount(&count)))
+    {
+        SafeRelease(collection);
+        SafeRelease(enumerator);
+        return devices;
+    }
+
+    for (UINT i = 0; i < count; i++)
+    {
+        IMMDevice *device = nullptr;
+        if (FAILED(collection->Item(i, &device)))
+        {
+            continue;
+        }
+
+        CaptureDeviceInfo info;
+        LPWSTR id = nullptr;
+        if (SUCCEEDED(device->GetId(&id)))
+        {
+            info.id = Utf8(id);
+            CoTaskMemFree(id);
+        }
+        info.uid = info.id;
+
+        EDataFlow flow = eRender;
+        IMMEndpoint *endpoint = nullptr;
+        if (SUCCEEDED(device->QueryInterface(__uuidof(IMMEndpoint), reinterpret_cast<void **>(&endpoint))))
+        {
+            endpoint->GetDataFlow(&flow);
+            SafeRelease(endpoint);
+        }
+
+        IPropertyStore *properties = nullptr;
+        if (SUCCEEDED(device->OpenPropertyStore(STGM_READ, &properties)))
+        {
+            PROPVARIANT name;
+            PropVariantInit(&name);
+            if (SUCCEEDED(properties->GetValue(PKEY_Device_FriendlyName, &name)) && name.vt == VT_LPWSTR)
+            {
+                info.name = Utf8(name.pwszVal);
+            }
+            PropVariantClear(&name);
+            SafeRelease(properties);
+        }
+
+        IAudioClient *client = nullptr;
+        WAVEFORMATEX *mixFormat = nullptr;
+        if (SUCCEEDED(device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, NULL, reinterpret_cast<void **>(&client))) &&
+            SUCCEEDED(client->GetMixFormat(&mixFormat)))
+        {
+            (flow == eCapture ? info.inputChannels : info.outputChannels) = mixFormat->nChannels;
+            info.sampleRate = mixFormat->nSamplesPerSec;
+            CoTaskMemFree(mixFormat);
+        }
+        SafeRelease(client);
+
+        info.isDefaultInput = flow == eCapture && !info.id.empty() && info.id == defaultInput;
+        info.isDefaultOutput = flow == eRender && !info.id.empty() && info.id == defaultOutput;
+        devices.push_back(info);
+        SafeRelease(device);
+    }
+
+    SafeRelease(collection);
+    SafeRelease(enumerator);
+    return devices;
+}